@@ -5,6 +5,15 @@
  *
  * bulatov band, depending on its period
  * basicBulatovBand(map,period)
+ * basicBulatovBand(map,period,nPeriods)
+ *
+ * nPeriods: the map is a grid (identityMap) of nPeriods periods along x,
+ *     computes only the columns of the first period and copies them,
+ *     nPeriods = 0 detects the number of columns per period from the first row
+ *     columns that are not an exact repeat (shifted by period) are computed
+ *
+ * instead of an identity map takes a grid (see gridMap.h), returns a new map
+ * newMap = basicBulatovBand(identityGrid(mPixels, -w, w, -1, 1), period, 0);
  *========================================================*/
 
 #include "mex.h"
@@ -12,17 +21,61 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include "gridMap.h"
 #define PI 3.14159f
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1
+/* tolerance for repeated columns, fraction of the grid spacing,
+ * identityMap accumulates rounding errors of a tenth of the spacing*/
+#define REPEAT_TOLERANCE 0.25f
+
+/* returns the number of columns per period of a grid map, 0 if not periodic*/
+/* dx is the spacing of the columns*/
+static int columnsPerPeriod(float dx, int nX, float period, int nPeriods)
+{
+    float n;
+    if (nPeriods > 0) {
+        return ((nX % nPeriods) == 0) ? nX / nPeriods : 0;
+    }
+    if ((nX < 2) || (dx <= 0)) {
+        return 0;
+    }
+    /* isRepeat checks each column*/
+    n = floorf(period / dx + 0.5f);
+    if ((n < 1) || (n >= nX) || (fabsf(n * dx - period) > REPEAT_TOLERANCE * dx)) {
+        return 0;
+    }
+    return (int) n;
+}
+
+/* true if column repeats column source shifted by shift in x*/
+static bool isRepeat(const float *map, int nY, int nXnY, int column, int source, float shift, float tolerance)
+{
+    int k, index, sourceIndex;
+    for (k = 0; k < nY; k++){
+        index = k + nY * column;
+        sourceIndex = k + nY * source;
+        if ((fabsf(map[index] - map[sourceIndex] - shift) > tolerance)
+                || (fabsf(map[index + nXnY] - map[sourceIndex + nXnY]) > tolerance)
+                || (map[index + 2 * nXnY] != map[sourceIndex + 2 * nXnY])) {
+            return false;
+        }
+    }
+    return true;
+}
 
 void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     const mwSize *dims, *aDims;
     int i, nParams;
-    int nX, nY, nXnY, nXnY2, index;
+    int nX, nY, nXnY, nXnY2, index, column, k, nColumns, nPeriodsIn;
+    mwSize gridDims[3];
+    grid inGrid;
+    bool isGridInput;
+    float dx;
+    int *sources = NULL;
     float inverted;
     float x, y;
     float period, nPeriods, piA2, iTanPiA4, exp2x, base;
@@ -33,26 +86,45 @@ void mexFunction( int nlhs, mxArray *plhs[],
     if(nrhs < 2) {
         mexErrMsgIdAndTxt("transformMap:nrhs","A map input and period required.");
     }
-    /* check number of dimensions of the map*/
-    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
-        mexErrMsgIdAndTxt("transformMap:mapDims","The map has to have three dimensions.");
-    }
-    dims = mxGetDimensions(prhs[0]);
-    if(dims[2] != 3) {
-        mexErrMsgIdAndTxt("transformMap:map3rdDimension","The map's third dimension has to be three.");
+    isGridInput = isGrid(prhs[0]);
+    if (isGridInput) {
+        getGrid(prhs[0], &inGrid, gridDims);
+        dims = gridDims;
+        if (nlhs != 1) {
+            mexErrMsgIdAndTxt("transformMap:nlhs","Returns a new map for a grid.");
+        }
+    } else {
+        /* check number of dimensions of the map*/
+        if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
+            mexErrMsgIdAndTxt("transformMap:mapDims","The map has to have three dimensions.");
+        }
+        dims = mxGetDimensions(prhs[0]);
+        if(dims[2] != 3) {
+            mexErrMsgIdAndTxt("transformMap:map3rdDimension","The map's third dimension has to be three.");
+        }
     }
     /* check that no or one output is expected*/
     if (nlhs > 1) {
         mexErrMsgIdAndTxt("transformMap:nlhs","Has zero or one return parameter.");
     }
     /* get the map*/
+    inMap = NULL;
+    if (!isGridInput) {
 #if MX_HAS_INTERLEAVED_COMPLEX
-    inMap = mxGetSingles(prhs[0]);
+        inMap = mxGetSingles(prhs[0]);
 #else
-    inMap = (float *) mxGetPr(prhs[0]);
-#endif   
+        inMap = (float *) mxGetPr(prhs[0]);
+#endif
+    }
     /* get period */
     period = (float) mxGetScalar(prhs[1]);
+    nPeriodsIn = -1;
+    if (nrhs > 2) {
+        nPeriodsIn = (int) mxGetScalar(prhs[2]);
+        if (nPeriodsIn < 0) {
+            mexErrMsgIdAndTxt("transformMap:nPeriods","The number of periods has to be positive, or 0 to detect it.");
+        }
+    }
    /* left hand side */
     if (nlhs == 0){
         outMap = inMap;
@@ -74,26 +146,72 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nY = dims[0];
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
-    for (index = 0; index < nXnY; index++){
-        inverted = inMap[index + nXnY2];
-        /* do only transform if pixel is valid*/
-        if (inverted < -0.1f) {
-            if (returnsMap){
-                /* set element only if new output map*/
-                outMap[index] = INVALID;
-                outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID;  
+    /* columns to copy: sources[column] is the column of the first period, or -1*/
+    if (nPeriodsIn >= 0) {
+        if (isGridInput) {
+            dx = inGrid.dx;
+        } else {
+            /* the mean spacing of the first row, single differences are imprecise*/
+            dx = (nX > 1) ? (inMap[nY * (nX - 1)] - inMap[0]) / (nX - 1) : 0;
+        }
+        nColumns = columnsPerPeriod(dx, nX, period, nPeriodsIn);
+        if ((nPeriodsIn > 0) && (nColumns == 0)) {
+            mexErrMsgIdAndTxt("transformMap:nPeriods","The number of columns has to be a multiple of nPeriods.");
+        }
+        if (nColumns > 0) {
+            sources = (int *) mxMalloc(nX * sizeof(int));
+            /* check before the map is overwritten*/
+            for (column = 0; column < nX; column++){
+                k = column % nColumns;
+                if (column < nColumns) {
+                    sources[column] = -1;
+                } else if (isGridInput) {
+                    /* the shift of the grid differs from the periods by the error of the spacing*/
+                    sources[column] = ((column / nColumns) * fabsf(nColumns * dx - period)
+                            <= REPEAT_TOLERANCE * dx) ? k : -1;
+                } else {
+                    sources[column] = isRepeat(inMap, nY, nXnY, column, k, period * (column / nColumns),
+                            REPEAT_TOLERANCE * period / nColumns) ? k : -1;
+                }
             }
+        }
+    }
+    for (index = 0; index < nXnY; index++){
+        column = index / nY;
+        if ((sources != NULL) && (sources[column] >= 0)) {
+            /* the first period is done*/
+            k = index - nY * (column - sources[column]);
+            outMap[index] = outMap[k];
+            outMap[index + nXnY] = outMap[k + nXnY];
+            outMap[index + nXnY2] = outMap[k + nXnY2];
             continue;
         }
-        y = inMap[index + nXnY];
+        if (isGridInput) {
+            /* all pixels of the grid are valid*/
+            inverted = 0;
+            x = gridX(&inGrid, column);
+            y = gridY(&inGrid, index - nY * column);
+        } else {
+            inverted = inMap[index + nXnY2];
+            /* do only transform if pixel is valid*/
+            if (inverted < -0.1f) {
+                if (returnsMap){
+                    /* set element only if new output map*/
+                    outMap[index] = INVALID;
+                    outMap[index + nXnY] = INVALID;
+                    outMap[index + nXnY2] = INVALID;  
+                }
+                continue;
+            }
+            x = inMap[index];
+            y = inMap[index + nXnY];
+        }
         if (fabsf(y) > 1){
             outMap[index] = INVALID;
             outMap[index + nXnY] = INVALID;
             outMap[index + nXnY2] = INVALID;
             continue;  
         }
-        x = inMap[index];
         nPeriods = floorf(x / period);
         x = piA2 * (x - period * nPeriods);
         y *= piA2;
@@ -103,4 +221,7 @@ void mexFunction( int nlhs, mxArray *plhs[],
         outMap[index + nXnY] = 2 * sinf(y) * base;
         outMap[index + nXnY2] = inverted;
     }
+    if (sources != NULL) {
+        mxFree(sources);
+    }
 }
\ No newline at end of file
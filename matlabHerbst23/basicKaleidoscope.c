@@ -8,6 +8,7 @@
  * basicKaleidoscope(map, k, m , n);
  * basicKaleidoscope(map, k, m , n, maxRange);
  * basicKaleidoscope(map, k, m , n, maxRange, minRange);
+ * basicKaleidoscope(map, k, m , n, maxRange, minRange, seeding);
  *
  * Input:
  * first the map. 
@@ -37,6 +38,15 @@
  * optional parameters: 
  *    maxRange (maximum number of iterations, default value is 1000)
  *    minRange (minimum number of iterations, values > 0 make a hole, default is 0)
+ *    seeding (default 0, values > 0 predict the rotations of each pixel from its neighbour)
+ *
+ * seeding: neighbouring pixels usually need the same sequence of inversions and rotations.
+ *    The sector of each rotation is predicted from the same step of the preceding pixel of the column.
+ *    It is taken without atan2f if the point lies inside the predicted sector, away from its sides
+ *    by a margin much larger than the rounding errors of atan2f, else atan2f decides as without seeding.
+ *    The steps are the same as without seeding, the results are identical (maps, tiles and jacobian).
+ *    Saves most of the calls of atan2f, about 3 to 6 times faster (single core, 1000x1000 pixels).
+ *    basicKaleidoscopeSeedingTest.m compares the results and times.
  *
  * returns nothing and modifies the map argument if used as a procedure:
  *   basicKaleidoscope(map, k, m, n);
@@ -44,151 +54,263 @@
  * returns a modified map and does not change the map argument if used as a function:
  *  newMap = basicKaleidoscope(map, k, m, n);
  *
+ * returns additionally the tiles as a uint32 array of size (nY, nX, 2):
+ *  [newMap, tiles] = basicKaleidoscope(map, k, m, n);
+ *     tiles(h,k,1) = length of the word of reflections that maps the pixel into the basic triangle
+ *                    (number of mirror lines crossed, the dihedral steps are reduced)
+ *     tiles(h,k,2) = hash of the word, the same for all pixels of a tile and for each call
+ *     invalid pixels have length 0 and hash 0, the basic triangle has length 0 and hash 2166136261
+ *     use it to color the tiles without doing the kaleidoscope again
+ *
+ * stacks of maps and parameter sets, all frames are done in one call:
+ *  the map may be an array of size (nY, nX, 3, nFrames), a stack of maps
+ *  k, m and n may be vectors with a value for each frame, scalars are used for all frames
+ *  for a single map and vectors of parameters a stack of new maps is returned:
+ *  newMaps = basicKaleidoscope(map, 5, 4, [2 3 4 5]);
+ *  the tiles are then of size (nY, nX, 2, nFrames)
+ *
+ * writes the result into a destination map of the right size, for animations without allocation
+ *  basicKaleidoscope(map, destination, k, m, n);
+ *  the destination is a single array with the rows and columns of the map (not a scalar parameter)
+ *  the destination is modified in place, it may be the map itself
+ *
+ * the geometry (rotations, inverting circle) is kept between calls for the same k, m and n
+ * the mex file is locked to keep it, unlock before compiling again:
+ *  basicKaleidoscope('unlock');
+ *
+ * a map with 7 layers carries its jacobian (see matlabKaleidoscope/jacobian.h):
+ *     map(h,k,3:6) = dx/du, dy/du, dx/dv, dy/dv for column index u and row index v
+ *  the rotations, mirrorings and inversions of each pixel are applied to it,
+ *  the jacobian is exact at the borders of the tiles
+ *
+ * instead of an identity map takes a grid (see gridMap.h), returns a new map:
+ *  newMap = basicKaleidoscope(identityGrid(mPixels, -1, 1), k, m, n);
+ *  the pixel coordinates are made in the loop, no identity map is written and read
+ *
+ * compile with openMP to use all cores (see compile.m), columns are done in parallel
+ *
  *========================================================*/
 
 #include "mex.h"
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
+#include "gridMap.h"
 #define PI 3.14159f
 #define INVALID -1
+#define HASH_START 2166136261u
+#define HASH_PRIME 16777619u
+#define SECTOR_MARGIN 0.001
+#define SEED_LENGTH 256
+#define JACOBIAN_LAYERS 7
+#define PARALLEL_MIN 10000
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 
-void mexFunction( int nlhs, mxArray *plhs[],
-        int nrhs, const mxArray *prhs[])
-{
-    const mwSize *dims;
-    int maxIterations, minIterations, iterations;
-    int nX, nY, nXnY, nXnY2, nXnY3, index, i;
-    float inverted, x, y;
-    float *inMap, *outMap;
-    bool returnsMap, success;
-    int k, m, n, k2;
-    enum geometryType {elliptic, euklidic, hyperbolic};
+/* the jacobian of a pixel, tangent vectors (dx/du, dy/du) and (dx/dv, dy/dv)*/
+typedef struct {
+    float xu, yu, xv, yv;
+} jacobian;
+
+/* the word of reflections of a pixel, its length and FNV-1a hash*/
+typedef struct {
+    uint32_t length, hash;
+} tileWord;
+
+static void setEmptyWord(tileWord *w){
+    w->length = 0;
+    w->hash = HASH_START;
+}
+
+/* append an element of the dihedral group: rotation by j sectors and mirroring at the x-axis if flip*/
+/* t = 2j - flip is the number of mirror lines crossed (with sign), zero for the identity*/
+static void appendDihedral(tileWord *w, int j, bool flip){
+    int t = 2 * j - (flip ? 1: 0);
+    if (t != 0){
+        w->length += abs(t);
+        w->hash = (w->hash ^ (uint32_t) (t + 128)) * HASH_PRIME;
+    }
+}
+
+/* append the inversion at the circle or mirroring at the third side*/
+static void appendReflection(tileWord *w){
+    w->length += 1;
+    w->hash = w->hash * HASH_PRIME;
+}
+
+/* rotation (x,y) -> (cosine * x + sine * y, -sine * x + cosine * y)*/
+static void rotateJacobian(jacobian *j, float cosine, float sine){
+    float h;
+    h = cosine * j->xu + sine * j->yu;
+    j->yu = -sine * j->xu + cosine * j->yu;
+    j->xu = h;
+    h = cosine * j->xv + sine * j->yv;
+    j->yv = -sine * j->xv + cosine * j->yv;
+    j->xv = h;
+}
+
+/* mirroring at the x-axis*/
+static void conjugateJacobian(jacobian *j){
+    j->yu = -j->yu;
+    j->yv = -j->yv;
+}
+
+/* mirroring at a line with unit normal (normalX, normalY)*/
+static void reflectJacobian(jacobian *j, float normalX, float normalY){
+    float d;
+    d = 2 * (normalX * j->xu + normalY * j->yu);
+    j->xu -= d * normalX;
+    j->yu -= d * normalY;
+    d = 2 * (normalX * j->xv + normalY * j->yv);
+    j->xv -= d * normalX;
+    j->yv -= d * normalY;
+}
+
+/* inversion at a circle, (dx, dy) from the center to the point, d2 its square and factor = radius2 / d2*/
+/* derivative factor * (1 - 2 * (dx, dy)^T (dx, dy) / d2)*/
+static void invertJacobian(jacobian *j, float dx, float dy, float d2, float factor){
+    float d;
+    d = 2 * (dx * j->xu + dy * j->yu) / d2;
+    j->xu = factor * (j->xu - d * dx);
+    j->yu = factor * (j->yu - d * dy);
+    d = 2 * (dx * j->xv + dy * j->yv) / d2;
+    j->xv = factor * (j->xv - d * dx);
+    j->yv = factor * (j->yv - d * dy);
+}
+
+static void loadJacobian(jacobian *j, const float *map, int index, int nXnY){
+    j->xu = map[index + 3 * nXnY];
+    j->yu = map[index + 4 * nXnY];
+    j->xv = map[index + 5 * nXnY];
+    j->yv = map[index + 6 * nXnY];
+}
+
+static void storeJacobian(const jacobian *j, float *map, int index, int nXnY){
+    map[index + 3 * nXnY] = j->xu;
+    map[index + 4 * nXnY] = j->yu;
+    map[index + 5 * nXnY] = j->xv;
+    map[index + 6 * nXnY] = j->yv;
+}
+
+/* invalid pixels get a zero jacobian*/
+static void clearJacobian(float *map, int index, int nXnY){
+    map[index + 3 * nXnY] = 0;
+    map[index + 4 * nXnY] = 0;
+    map[index + 5 * nXnY] = 0;
+    map[index + 6 * nXnY] = 0;
+}
+
+enum geometryType {elliptic, euklidic, hyperbolic};
+
+/* the geometry of the kaleidoscope, depends only on k, m and n*/
+/* it is kept between calls, animations call the kaleidoscope many times with the same geometry*/
+typedef struct {
+    int k, m, n;
+    bool triangle;
     enum geometryType geometry;
-    float alpha, beta ,gamma, iGamma2, kPlus05, angleSum;
-    float sines[200], cosines[200], dAngle;
-    int rotation;
-    float sine, cosine, h;
+    float iGamma2, kPlus05;
+    float sines[200], cosines[200];
     float mirrorX, mirrorNormalX, mirrorNormalY;
     float circleCenterX, circleCenterY, circleRadius2;
-    float centerX, centerY, factor;
-    /* check for proper number of arguments (else crash)*/
-    /* checking for presence of a map*/
-    if(nrhs < 4) {
-        mexErrMsgIdAndTxt("basicKaleidoscope:nrhs","A map input plus 3 geometry params required.");
-    }
-    /* check number of dimensions of the map (array)*/
-    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
-        mexErrMsgIdAndTxt("basicKaleidoscope:mapDims","The map has to have three dimensions.");
-    }
-    dims = mxGetDimensions(prhs[0]);
-    if(dims[2] != 3) {
-        mexErrMsgIdAndTxt("basicKaleidoscope:map3rdDimension","The map's third dimension has to be three.");
-    }
-    /* check that no or one output is expected*/
-    if (nlhs > 1) {
-        mexErrMsgIdAndTxt("basicKaleidoscope:nlhs","Has zero or one return parameter.");
-    }
-    /* get the map*/
-#if MX_HAS_INTERLEAVED_COMPLEX
-    inMap = mxGetSingles(prhs[0]);
-#else
-    inMap = (float *) mxGetPr(prhs[0]);
-#endif
-    if (nlhs == 0){
-        returnsMap = false;
-        outMap = inMap;
-    } else {
-        /* create output map*/
-        returnsMap = true;
-        plhs[0] = mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
-#if MX_HAS_INTERLEAVED_COMPLEX
-        outMap = mxGetSingles(plhs[0]);
-#else
-        outMap = (float *) mxGetPr(plhs[0]);
-#endif
-    }
-    /* get geometry parameters*/
-    k = (int) mxGetScalar(prhs[1]);
-    m = (int) mxGetScalar(prhs[2]);
-    n = (int) mxGetScalar(prhs[3]);
-    /* limit k */
-    if (k > 100){
-        k = 100;
+    /* for seeding: the sectors without their margins, given by the directions of their sides*/
+    /* sectors across the negative x-axis are not predicted, atan2f jumps there*/
+    bool predictable[200];
+    float sectorStartX[200], sectorStartY[200], sectorEndX[200], sectorEndY[200];
+} kaleidoscopeGeometry;
+
+/* the sectors of the rotations of the preceding pixel predict the sectors of the next pixel*/
+typedef struct {
+    uint8_t sectors[2][SEED_LENGTH];
+    uint8_t *current, *previous;
+    int length, previousLength;
+} sectorSeed;
+
+/* the maps and the parameters of the iteration*/
+typedef struct {
+    float *inMap, *outMap;
+    /* a grid instead of the input map, or NULL*/
+    const grid *inGrid;
+    uint32_t *tiles;
+    int nY, nXnY;
+    bool returnsMap, seeding, jacobian;
+    int maxIterations, minIterations;
+} mapping;
+
+/* the cached geometry, valid after the first call, the mex file is then locked*/
+static kaleidoscopeGeometry cachedGeometry;
+static bool hasCachedGeometry = false;
+/* memory for the geometries of parameter vectors, kept between calls*/
+static kaleidoscopeGeometry *geometryPool = NULL;
+static int geometryPoolSize = 0;
+static bool hasExitFunction = false;
+
+static void freeGeometryPool(void){
+    if (geometryPool != NULL){
+        mxFree(geometryPool);
     }
-    /* limits for iteration*/    
-    if (nrhs >= 5){
-        maxIterations = (int) mxGetScalar(prhs[4]);
-    } else {
-        maxIterations = 100;
+    geometryPool = NULL;
+    geometryPoolSize = 0;
+}
+
+/* get memory for n geometries, grows if needed*/
+static kaleidoscopeGeometry *getGeometries(int n){
+    if (!hasExitFunction){
+        mexAtExit(freeGeometryPool);
+        hasExitFunction = true;
     }
-    if (nrhs >= 6){
-        minIterations = (int) mxGetScalar(prhs[5]);
-    } else {
-        minIterations = 0;
+    if (geometryPoolSize < n){
+        freeGeometryPool();
+        geometryPool = (kaleidoscopeGeometry *) mxMalloc(n * sizeof(kaleidoscopeGeometry));
+        mexMakeMemoryPersistent(geometryPool);
+        geometryPoolSize = n;
     }
-    
+    return geometryPool;
+}
+
+/* set up the geometry for 1 <= k <= 100*/
+static void setupGeometry(kaleidoscopeGeometry *g, int k, int m, int n){
+    int i, k2;
+    float alpha, beta, gamma, angleSum, dAngle;
+    float centerX, centerY, factor;
+    double start, end, margin;
+    g->k = k;
+    g->m = m;
+    g->n = n;
     /* k<1  identity map*/
     if (k < 1){
-        if (returnsMap){
-            nXnY3 = 3 * dims[0] * dims[1];
-            for (index = 0; index < nXnY3; index++){
-                outMap[index] = inMap[index];
-            }
-        }
+        g->triangle = false;
         return;
     }
-    
     /* the rotations of the dihedral group, order k*/
     dAngle = 2.0f * PI / k;
-    k2 = 2 * k;
+    /* sectors 0 ... 2k-1, for k=1 atan2f gives sector 2 at the negative x-axis*/
+    k2 = (k == 1) ? 3 : 2 * k;
     for (i = 0; i < k2; i++){
-        sines[i] = sinf(i*dAngle);
-        cosines[i] = cosf(i*dAngle);
+        g->sines[i] = sinf(i*dAngle);
+        g->cosines[i] = cosf(i*dAngle);
     }
     gamma = PI / k;
-    iGamma2 = 0.5f / gamma;
-    kPlus05 = k + 0.5f;
+    g->iGamma2 = 0.5f / gamma;
+    g->kPlus05 = k + 0.5f;
+    /* sector i has the angles of floorf(atan2f(y, x) * iGamma2 + kPlus05) == i*/
+    /* the margin is much larger than the rounding errors of atan2f and of this expression*/
+    margin = SECTOR_MARGIN / g->iGamma2;
+    for (i = 0; i < k2; i++){
+        start = (i - (double) g->kPlus05) / g->iGamma2 + margin;
+        end = (i + 1 - (double) g->kPlus05) / g->iGamma2 - margin;
+        g->predictable[i] = (k >= 2) && (start > -M_PI) && (end < M_PI);
+        g->sectorStartX[i] = (float) cos(start);
+        g->sectorStartY[i] = (float) sin(start);
+        g->sectorEndX[i] = (float) cos(end);
+        g->sectorEndY[i] = (float) sin(end);
+    }
 
-    /* catch case that there is no triangle*/
     /* m<=1 or n<=1: simple dihedral group of order k*/
-    if ((m < 2)||(n<2)){
-        /* do the map*/
-        /* row first order*/
-        nX = dims[1];
-        nY = dims[0];
-        nXnY = nX * nY;
-        nXnY2 = 2 * nXnY;
-        for (index = 0; index < nXnY; index++){
-            inverted = inMap[index + nXnY2];
-            /* do only transform if pixel is valid*/
-            if (inverted < -0.1f) {
-                if (returnsMap){
-                    /* set element only if new output map*/
-                    outMap[index] = INVALID;
-                    outMap[index + nXnY] = INVALID;
-                    outMap[index + nXnY2] = INVALID;           
-                }
-                continue;
-            }
-            x = inMap[index];
-            y = inMap[index + nXnY];
-            /* make dihedral map to put point in first sector*/
-            rotation = (int) floorf(atan2f(y, x) * iGamma2 + kPlus05);
-            cosine = cosines[rotation];
-            sine = sines[rotation];
-            h = cosine * x + sine * y;
-            y = -sine * x + cosine * y;
-            x = h;
-            if (y < 0){
-                y = -y;
-                inverted = 1 - inverted;
-            }
-            outMap[index] = x;
-            outMap[index + nXnY] = y;
-            outMap[index + nXnY2] = inverted;
-        }        
+    g->triangle = (m >= 2) && (n >= 2);
+    if (!g->triangle){
         return;
     }
     
@@ -197,17 +319,17 @@ void mexFunction( int nlhs, mxArray *plhs[],
     beta = PI / m;
     angleSum = 1.0f / k + 1.0f / n + 1.0f / m;
     if (angleSum > 1.001){
-        geometry = elliptic;
+        g->geometry = elliptic;
     }
     else if (angleSum > 0.999){
-        geometry = euklidic;
+        g->geometry = euklidic;
     }
     else{
-        geometry = hyperbolic;
+        g->geometry = hyperbolic;
     }
 
     /* define the inverting circle/mirror line*/
-    switch (geometry){
+    switch (g->geometry){
         case hyperbolic:
             /* hyperbolic geometry with inverting circle*/
             /* calculation of center for circle radius=1*/
@@ -215,9 +337,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
             centerX = centerY / tanf(gamma) + cosf(beta) / sinf(gamma);
             /* hyperbolic geometry: renormalize for poincare radius=1*/
             factor = 1 / sqrt(centerX * centerX + centerY * centerY - 1);
-            circleCenterX = factor * centerX;
-            circleCenterY = factor * centerY;
-            circleRadius2 = factor * factor;
+            g->circleCenterX = factor * centerX;
+            g->circleCenterY = factor * centerY;
+            g->circleRadius2 = factor * factor;
             break;
         case elliptic:
             /* calculation of center for circle radius=1*/
@@ -225,56 +347,195 @@ void mexFunction( int nlhs, mxArray *plhs[],
             centerX = - (centerY / tanf(gamma) + cosf(beta) / sinf(gamma));
             /* renormalize to get equator radius of 1 in stereographic projection*/
             factor = 1 / sqrt(1-centerX*centerX-centerY*centerY);
-            circleCenterX = factor * centerX;
-            circleCenterY = factor * centerY;
-            circleRadius2 = factor * factor;
+            g->circleCenterX = factor * centerX;
+            g->circleCenterY = factor * centerY;
+            g->circleRadius2 = factor * factor;
             break;
         case euklidic:
             /* euklidic geometry with mirror line*/
             /* mirror position is arbitrary, mirror line passes through (mirrorX,0)*/
-            mirrorX = 0.5f;
+            g->mirrorX = 0.5f;
             /* normal vector to the mirror line, pointing outside*/
-            mirrorNormalX = sinf(alpha);
-            mirrorNormalY = cosf(alpha);
+            g->mirrorNormalX = sinf(alpha);
+            g->mirrorNormalY = cosf(alpha);
             break;
     }
-    /* do the map*/
-    /* row first order*/
-    nX = dims[1];
-    nY = dims[0];
-    nXnY = nX * nY;
-    nXnY2 = 2 * nXnY;
-    for (index = 0; index < nXnY; index++){
-        inverted = inMap[index + nXnY2];
+}
+
+/* coordinates of an input pixel, returns its parity, from the grid all pixels are valid*/
+static inline float loadPixel(const mapping *p, int index, float *x, float *y){
+    if (p->inGrid != NULL){
+        gridPixel(p->inGrid, index, x, y);
+        return 0;
+    }
+    *x = p->inMap[index];
+    *y = p->inMap[index + p->nXnY];
+    return p->inMap[index + 2 * p->nXnY];
+}
+
+/* simple dihedral group, map one pixel*/
+static void dihedralPixel(const kaleidoscopeGeometry *g, const mapping *p, int index){
+    int nXnY = p->nXnY;
+    int nXnY2 = 2 * nXnY;
+    int rotation;
+    float inverted, x, y, h, cosine, sine;
+    tileWord word;
+    jacobian j;
+    inverted = loadPixel(p, index, &x, &y);
+    /* do only transform if pixel is valid*/
+    if (inverted < -0.1f) {
+        if (p->returnsMap){
+            /* set element only if new output map*/
+            p->outMap[index] = INVALID;
+            p->outMap[index + nXnY] = INVALID;
+            p->outMap[index + nXnY2] = INVALID;           
+            if (p->jacobian){
+                clearJacobian(p->outMap, index, nXnY);
+            }
+        }
+        return;
+    }
+    /* make dihedral map to put point in first sector*/
+    rotation = (int) floorf(atan2f(y, x) * g->iGamma2 + g->kPlus05);
+    cosine = g->cosines[rotation];
+    sine = g->sines[rotation];
+    h = cosine * x + sine * y;
+    y = -sine * x + cosine * y;
+    x = h;
+    if (p->jacobian){
+        loadJacobian(&j, p->inMap, index, nXnY);
+        rotateJacobian(&j, cosine, sine);
+        if (y < 0){
+            conjugateJacobian(&j);
+        }
+        storeJacobian(&j, p->outMap, index, nXnY);
+    }
+    if (p->tiles != NULL){
+        setEmptyWord(&word);
+        appendDihedral(&word, rotation - g->k, y < 0);
+        p->tiles[index] = word.length;
+        p->tiles[index + nXnY] = word.hash;
+    }
+    if (y < 0){
+        y = -y;
+        inverted = 1 - inverted;
+    }
+    p->outMap[index] = x;
+    p->outMap[index + nXnY] = y;
+    p->outMap[index + nXnY2] = inverted;
+}
+
+/* the sector of (x,y) for the rotation of the dihedral group, without seeding as floorf(atan2f(...))*/
+/* with seeding the sector of the same step of the preceding pixel is checked first:*/
+/* if (x,y) lies inside it, away from its sides by the margin, atan2f would give the same sector*/
+static inline int getSector(const kaleidoscopeGeometry *g, sectorSeed *s, bool seeding, float x, float y){
+    int sector, predicted;
+    if (!seeding){
+        return (int) floorf(atan2f(y, x) * g->iGamma2 + g->kPlus05);
+    }
+    predicted = (s->length < s->previousLength) ? s->previous[s->length] : -1;
+    if ((predicted >= 0) && g->predictable[predicted]
+            && (g->sectorStartX[predicted] * y - g->sectorStartY[predicted] * x > 0)
+            && (x * g->sectorEndY[predicted] - y * g->sectorEndX[predicted] > 0)){
+        sector = predicted;
+    } else {
+        sector = (int) floorf(atan2f(y, x) * g->iGamma2 + g->kPlus05);
+    }
+    if (s->length < SEED_LENGTH){
+        s->current[s->length] = (uint8_t) sector;
+        s->length++;
+    }
+    return sector;
+}
+
+/* the sectors of a pixel become the prediction for the next pixel, an invalid pixel predicts nothing*/
+static void nextSeed(sectorSeed *s, bool valid){
+    uint8_t *h;
+    if (valid){
+        h = s->previous;
+        s->previous = s->current;
+        s->current = h;
+        s->previousLength = s->length;
+    } else {
+        s->previousLength = 0;
+    }
+    s->length = 0;
+}
+
+/* triangle kaleidoscope, map one column of pixels*/
+/* seeds only from the preceding pixel in the same column, columns are independent*/
+static void triangleColumn(const kaleidoscopeGeometry *g, const mapping *p, int column){
+    int nY = p->nY;
+    int nXnY = p->nXnY;
+    int nXnY2 = 2 * nXnY;
+    int k = g->k;
+    enum geometryType geometry = g->geometry;
+    float *outMap = p->outMap;
+    uint32_t *tiles = p->tiles;
+    bool seeding = p->seeding;
+    bool hasJacobian = p->jacobian;
+    int maxIterations = p->maxIterations;
+    int index, iterations, rotation;
+    float inverted, x, y, h, cosine, sine;
+    bool success;
+    jacobian j;
+    tileWord word;
+    sectorSeed seed;
+    seed.current = seed.sectors[0];
+    seed.previous = seed.sectors[1];
+    seed.length = 0;
+    seed.previousLength = 0;
+    for (index = column * nY; index < (column + 1) * nY; index++){
+        inverted = loadPixel(p, index, &x, &y);
         /* do only transform if pixel is valid*/
         if (inverted < -0.1f) {
-            if (returnsMap){
+            if (p->returnsMap){
                 /* set element only if new output map*/
                 outMap[index] = INVALID;
                 outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID;           }
+                outMap[index + nXnY2] = INVALID;
+                if (hasJacobian){
+                    clearJacobian(outMap, index, nXnY);
+                }
+            }
+            nextSeed(&seed, false);
             continue;
         }
-        x = inMap[index];
-        y = inMap[index + nXnY];
         /* invalid if outside of poincare disc for hyperbolic kaleidoscope*/
         if ((geometry == hyperbolic) && (x * x + y * y >= 1)){
             outMap[index] = INVALID;
             outMap[index + nXnY] = INVALID;
             outMap[index + nXnY2] = INVALID;
+            if (hasJacobian){
+                clearJacobian(outMap, index, nXnY);
+            }
+            nextSeed(&seed, false);
             continue;
         }
+        setEmptyWord(&word);
+        if (hasJacobian){
+            loadJacobian(&j, p->inMap, index, nXnY);
+        }
         /* make dihedral map to put point in first sector*/
         /* and thus be able to use inversion/mirror as first step in iterated mapping*/
-        rotation = (int) floorf(atan2f(y, x) * iGamma2 + kPlus05);
-        cosine = cosines[rotation];
-        sine = sines[rotation];
+        rotation = getSector(g, &seed, seeding, x, y);
+        cosine = g->cosines[rotation];
+        sine = g->sines[rotation];
         h = cosine * x + sine * y;
         y = -sine * x + cosine * y;
         x = h;
+        if (hasJacobian){
+            rotateJacobian(&j, cosine, sine);
+        }
+        if (tiles != NULL){
+            appendDihedral(&word, rotation - k, y < 0);
+        }
         if (y < 0){
             y = -y;
             inverted = 1 - inverted;
+            if (hasJacobian){
+                conjugateJacobian(&j);
+            }
         }
         /* repeat inversion and dihedral group until success*/
         success = false;
@@ -285,16 +546,22 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 case hyperbolic:
                     /* inversion inside-out at circle*/
                     /* if no mapping we have finished*/
-                    dx = x - circleCenterX;
-                    dy = y - circleCenterY;
+                    dx = x - g->circleCenterX;
+                    dy = y - g->circleCenterY;
                     d2 = dx * dx + dy * dy;
                     /* d2 always larger than zero, because only points inside th Poincare disc*/
                     /* are considered, center of inverting sphere lies outside */
-                    if (d2 < circleRadius2){
+                    if (d2 < g->circleRadius2){
                         inverted = 1 - inverted;
-                        factor = circleRadius2 / d2;
-                        x = circleCenterX + factor * dx;
-                        y = circleCenterY + factor * dy;
+                        factor = g->circleRadius2 / d2;
+                        if (hasJacobian){
+                            invertJacobian(&j, dx, dy, d2, factor);
+                        }
+                        x = g->circleCenterX + factor * dx;
+                        y = g->circleCenterY + factor * dy;
+                        if (tiles != NULL){
+                            appendReflection(&word);
+                        }
                     }
                     else {
                         success = true;
@@ -303,14 +570,20 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 case elliptic:
                     /* inversion outside-in at circle,*/
                     /* if no mapping we have finished*/
-                    dx = x - circleCenterX;
-                    dy = y - circleCenterY;
+                    dx = x - g->circleCenterX;
+                    dy = y - g->circleCenterY;
                     d2 = dx * dx + dy * dy;
-                    if (d2 > circleRadius2){
+                    if (d2 > g->circleRadius2){
                         inverted = 1 - inverted;
-                        factor = circleRadius2 / d2;
-                        x = circleCenterX + factor * dx;
-                        y = circleCenterY + factor * dy;
+                        factor = g->circleRadius2 / d2;
+                        if (hasJacobian){
+                            invertJacobian(&j, dx, dy, d2, factor);
+                        }
+                        x = g->circleCenterX + factor * dx;
+                        y = g->circleCenterY + factor * dy;
+                        if (tiles != NULL){
+                            appendReflection(&word);
+                        }
                     } else {
                         success = true;
                     }
@@ -318,29 +591,44 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 case euklidic:
                     /* reflect point at mirror line if it is at the right hand side*/
                     /* if no mapping we have finished*/
-                    d = (x - mirrorX) * mirrorNormalX + y * mirrorNormalY;
+                    d = (x - g->mirrorX) * g->mirrorNormalX + y * g->mirrorNormalY;
                     if (d > 0){
                         inverted = 1 - inverted;
                         d = d + d;
-                        x = x - d * mirrorNormalX;
-                        y = y - d * mirrorNormalY;
+                        x = x - d * g->mirrorNormalX;
+                        y = y - d * g->mirrorNormalY;
+                        if (hasJacobian){
+                            reflectJacobian(&j, g->mirrorNormalX, g->mirrorNormalY);
+                        }
+                        if (tiles != NULL){
+                            appendReflection(&word);
+                        }
                     } else {
                         success = true;
                     }
                     break;
             }
             /* dihedral symmetry, if no mapping we have finished*/
-            rotation = (int) floorf(atan2f(y, x) * iGamma2 + kPlus05);
+            rotation = getSector(g, &seed, seeding, x, y);
             if (rotation != k){
                 /* we have a rotation and can't return*/
-                cosine = cosines[rotation];
-                sine = sines[rotation];
+                cosine = g->cosines[rotation];
+                sine = g->sines[rotation];
                 h = cosine * x + sine * y;
                 y = -sine * x + cosine * y;
                 x = h;
+                if (hasJacobian){
+                    rotateJacobian(&j, cosine, sine);
+                }
+                if (tiles != NULL){
+                    appendDihedral(&word, rotation - k, y < 0);
+                }
                 if (y < 0){
                     y = -y;
                     inverted = 1 - inverted;
+                    if (hasJacobian){
+                        conjugateJacobian(&j);
+                    }
                 }
             } else {
                 /* no rotation*/
@@ -348,6 +636,12 @@ void mexFunction( int nlhs, mxArray *plhs[],
                     /* mirror symmetry at the x-axis, not finished*/
                     y = -y;
                     inverted = 1 - inverted;
+                    if (hasJacobian){
+                        conjugateJacobian(&j);
+                    }
+                    if (tiles != NULL){
+                        appendDihedral(&word, 0, true);
+                    }
                 } else {
                     /* no mapping, it's finished*/
                     success = true;
@@ -355,20 +649,315 @@ void mexFunction( int nlhs, mxArray *plhs[],
             }
             iterations+=1;
         }
+        if (seeding){
+            nextSeed(&seed, true);
+        }
         /* fail after doing maximum repetitions or less than minimum iterations*/
-        if ((success) && (iterations > minIterations)) {
+        if ((success) && (iterations > p->minIterations)) {
             /* be safe: do not get points outside the poincare disc*/
             if ((geometry == hyperbolic) && (x * x + y * y >= 1)){
-                outMap[index + nXnY2] = -1;
+                outMap[index] = INVALID;
+                outMap[index + nXnY] = INVALID;
+                outMap[index + nXnY2] = INVALID;
+                if (hasJacobian){
+                    clearJacobian(outMap, index, nXnY);
+                }
             } else {
                 outMap[index] = x;
                 outMap[index + nXnY] = y;
                 outMap[index + nXnY2] = inverted;
+                if (hasJacobian){
+                    storeJacobian(&j, outMap, index, nXnY);
+                }
+                if (tiles != NULL){
+                    tiles[index] = word.length;
+                    tiles[index + nXnY] = word.hash;
+                }
             }
         } else {
             outMap[index] = INVALID;
             outMap[index + nXnY] = INVALID;
             outMap[index + nXnY2] = INVALID;
+            if (hasJacobian){
+                clearJacobian(outMap, index, nXnY);
+            }
+        }
+    }
+}
+
+/* identity map for k<1, one column of pixels*/
+static void identityColumn(const mapping *p, int column){
+    int index, layer;
+    int nXnY = p->nXnY;
+    int layers = p->jacobian ? JACOBIAN_LAYERS : 3;
+    float x, y;
+    for (index = column * p->nY; index < (column + 1) * p->nY; index++){
+        if (p->inGrid != NULL){
+            p->outMap[index + 2 * nXnY] = loadPixel(p, index, &x, &y);
+            p->outMap[index] = x;
+            p->outMap[index + nXnY] = y;
+        } else if (p->returnsMap){
+            for (layer = 0; layer < layers; layer++){
+                p->outMap[index + layer * nXnY] = p->inMap[index + layer * nXnY];
+            }
+        }
+        if ((p->tiles != NULL) && ((p->inGrid != NULL) || (p->inMap[index + 2 * nXnY] > -0.1f))){
+            p->tiles[index + nXnY] = HASH_START;
+        }
+    }
+}
+
+/* map one column of pixels of a frame*/
+static void mapColumn(const kaleidoscopeGeometry *g, const mapping *p, int column){
+    int index;
+    if (g->k < 1){
+        identityColumn(p, column);
+    } else if (!g->triangle){
+        for (index = column * p->nY; index < (column + 1) * p->nY; index++){
+            dihedralPixel(g, p, index);
+        }
+    } else {
+        triangleColumn(g, p, column);
+    }
+}
+
+/* get the value of a geometry parameter for a frame, scalars are used for all frames*/
+static int getParameter(const mxArray *parameter, int frame){
+    if (mxGetNumberOfElements(parameter) == 1){
+        return (int) mxGetScalar(parameter);
+    }
+#if MX_HAS_INTERLEAVED_COMPLEX
+    return (int) mxGetDoubles(parameter)[frame];
+#else
+    return (int) mxGetPr(parameter)[frame];
+#endif
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *dims;
+    mwSize outDims[4], tileDims[4], gridDims[3];
+    grid inGrid;
+    bool isGridInput;
+    int nX, nY, nXnY, nMapFrames, nParameterSets, nFrames, frame, i;
+    ptrdiff_t task, nTasks;
+    float *inMap, *outMap;
+    uint32_t *tiles;
+    bool returnsMap;
+    int k, m, n;
+    mapping p;
+    kaleidoscopeGeometry *geometries;
+    const mxArray **parameters;
+    int nParameters, layers;
+    bool hasDestination;
+    /* unlock the mex file and forget the cached geometry*/
+    if ((nrhs == 1) && mxIsChar(prhs[0])){
+        if (mexIsLocked()){
+            mexUnlock();
+        }
+        hasCachedGeometry = false;
+        freeGeometryPool();
+        return;
+    }
+    /* check for proper number of arguments (else crash)*/
+    /* checking for presence of a map*/
+    if(nrhs < 4) {
+        mexErrMsgIdAndTxt("basicKaleidoscope:nrhs","A map input plus 3 geometry params required.");
+    }
+    isGridInput = isGrid(prhs[0]);
+    if (isGridInput){
+        getGrid(prhs[0], &inGrid, gridDims);
+        dims = gridDims;
+    } else {
+        /* check number of dimensions of the map (array), a stack of maps has four*/
+        if((mxGetNumberOfDimensions(prhs[0]) != 3) && (mxGetNumberOfDimensions(prhs[0]) != 4)) {
+            mexErrMsgIdAndTxt("basicKaleidoscope:mapDims","The map has to have three or four dimensions.");
+        }
+        dims = mxGetDimensions(prhs[0]);
+        if((dims[2] != 3) && (dims[2] != JACOBIAN_LAYERS)) {
+            mexErrMsgIdAndTxt("basicKaleidoscope:map3rdDimension","The map's third dimension has to be three (or seven with jacobian).");
+        }
+    }
+    /* a single array with the rows and columns of the map as second argument is the destination map*/
+    /* geometry parameters may be single scalars*/
+    hasDestination = mxIsSingle(prhs[1]) && (mxGetNumberOfDimensions(prhs[1]) >= 3)
+            && (mxGetDimensions(prhs[1])[0] == dims[0]) && (mxGetDimensions(prhs[1])[1] == dims[1]);
+    parameters = hasDestination ? prhs + 2 : prhs + 1;
+    nParameters = hasDestination ? nrhs - 2 : nrhs - 1;
+    if(nParameters < 3) {
+        mexErrMsgIdAndTxt("basicKaleidoscope:nrhs","A map input, a destination plus 3 geometry params required.");
+    }
+    if (isGridInput && (nlhs == 0) && !hasDestination){
+        mexErrMsgIdAndTxt("basicKaleidoscope:nlhs","Returns a new map for a grid.");
+    }
+    layers = dims[2];
+    nMapFrames = (!isGridInput && (mxGetNumberOfDimensions(prhs[0]) == 4)) ? dims[3] : 1;
+    /* geometry parameters are scalars or vectors with a value for each frame*/
+    nParameterSets = 1;
+    for (i = 0; i < 3; i++){
+        int nValues = mxGetNumberOfElements(parameters[i]);
+        if ((nValues > 1) && !mxIsDouble(parameters[i])){
+            mexErrMsgIdAndTxt("basicKaleidoscope:parameterClass","Vectors of geometry parameters have to be double.");
+        }
+        if ((nValues != 1) && (nParameterSets != 1) && (nValues != nParameterSets)){
+            mexErrMsgIdAndTxt("basicKaleidoscope:parameterLength","The geometry parameter vectors need the same length.");
+        }
+        if (nValues != 1){
+            nParameterSets = nValues;
+        }
+    }
+    if ((nMapFrames > 1) && (nParameterSets > 1) && (nMapFrames != nParameterSets)){
+        mexErrMsgIdAndTxt("basicKaleidoscope:frames","Need as many parameter values as maps.");
+    }
+    nFrames = (nMapFrames > 1) ? nMapFrames : nParameterSets;
+    /* check that no, one or two outputs are expected*/
+    if (nlhs > 2) {
+        mexErrMsgIdAndTxt("basicKaleidoscope:nlhs","Has zero, one or two return parameters.");
+    }
+    /* several parameter sets for one map make a stack of new maps*/
+    if ((nlhs == 0) && (nFrames > nMapFrames) && !hasDestination){
+        mexErrMsgIdAndTxt("basicKaleidoscope:nlhs","Returns a stack of maps for a vector of parameters.");
+    }
+    if (hasDestination){
+        const mwSize *destinationDims = mxGetDimensions(prhs[1]);
+        if ((mxGetNumberOfDimensions(prhs[1]) < 3) || (destinationDims[0] != dims[0]) || (destinationDims[1] != dims[1]) || (destinationDims[2] != (mwSize) layers)
+                || (mxGetNumberOfElements(prhs[1]) != layers * dims[0] * dims[1] * nFrames)){
+            mexErrMsgIdAndTxt("basicKaleidoscope:destination","The destination has to have the size of the new map.");
+        }
+        if (nlhs > 0){
+            mexErrMsgIdAndTxt("basicKaleidoscope:nlhs","Returns nothing if there is a destination map.");
+        }
+    }
+    /* get the map*/
+    inMap = NULL;
+    if (!isGridInput){
+#if MX_HAS_INTERLEAVED_COMPLEX
+        inMap = mxGetSingles(prhs[0]);
+#else
+        inMap = (float *) mxGetPr(prhs[0]);
+#endif
+    }
+    if (hasDestination){
+        /* write into the destination, if it is the map itself this is the procedure*/
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outMap = mxGetSingles(prhs[1]);
+#else
+        outMap = (float *) mxGetPr(prhs[1]);
+#endif
+        returnsMap = (outMap != inMap);
+    } else if (nlhs == 0){
+        returnsMap = false;
+        outMap = inMap;
+    } else {
+        /* create output map*/
+        returnsMap = true;
+        outDims[0] = dims[0];
+        outDims[1] = dims[1];
+        outDims[2] = layers;
+        outDims[3] = nFrames;
+        plhs[0] = mxCreateNumericArray((nFrames > 1) ? 4 : 3, outDims, mxSINGLE_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outMap = mxGetSingles(plhs[0]);
+#else
+        outMap = (float *) mxGetPr(plhs[0]);
+#endif
+    }
+    /* create the tiles, initialized to zero (invalid)*/
+    tiles = NULL;
+    if (nlhs == 2){
+        tileDims[0] = dims[0];
+        tileDims[1] = dims[1];
+        tileDims[2] = 2;
+        tileDims[3] = nFrames;
+        plhs[1] = mxCreateNumericArray((nFrames > 1) ? 4 : 3, tileDims, mxUINT32_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        tiles = mxGetUint32s(plhs[1]);
+#else
+        tiles = (uint32_t *) mxGetData(plhs[1]);
+#endif
+    }
+    /* limits for iteration*/    
+    if (nParameters >= 4){
+        p.maxIterations = (int) mxGetScalar(parameters[3]);
+    } else {
+        p.maxIterations = 100;
+    }
+    if (nParameters >= 5){
+        p.minIterations = (int) mxGetScalar(parameters[4]);
+    } else {
+        p.minIterations = 0;
+    }
+    p.seeding = false;
+    if (nParameters >= 6){
+        p.seeding = (mxGetScalar(parameters[5]) > 0);
+    }
+    
+    /* set up the geometries, for one parameter set only if the parameters change*/
+    /* lock the mex file to keep the geometry, basicKaleidoscope('unlock') releases it*/
+    geometries = NULL;
+    for (frame = 0; frame < nParameterSets; frame++){
+        /* get geometry parameters*/
+        k = getParameter(parameters[0], frame);
+        m = getParameter(parameters[1], frame);
+        n = getParameter(parameters[2], frame);
+        /* limit k */
+        if (k > 100){
+            k = 100;
+        }
+        if (nParameterSets == 1){
+            if (!hasCachedGeometry || (cachedGeometry.k != k) || (cachedGeometry.m != m) || (cachedGeometry.n != n)){
+                setupGeometry(&cachedGeometry, k, m, n);
+                hasCachedGeometry = true;
+            }
+        } else {
+            if (geometries == NULL){
+                geometries = getGeometries(nParameterSets);
+            }
+            /* animations often change only some of the parameters*/
+            if ((frame > 0) && (geometries[frame - 1].k == k) && (geometries[frame - 1].m == m) && (geometries[frame - 1].n == n)){
+                geometries[frame] = geometries[frame - 1];
+            } else {
+                setupGeometry(&geometries[frame], k, m, n);
+            }
+        }
+    }
+    if (!mexIsLocked()){
+        mexLock();
+    }
+
+    /* do the map*/
+    /* row first order*/
+    /* indices inside a frame are int, offsets of frames are size_t*/
+    if ((double) dims[0] * dims[1] * layers > INT_MAX){
+        mexErrMsgIdAndTxt("basicKaleidoscope:mapSize","A single map can have at most %d elements.", INT_MAX);
+    }
+    nX = dims[1];
+    nY = dims[0];
+    nXnY = nX * nY;
+    p.inMap = inMap;
+    p.inGrid = isGridInput ? &inGrid : NULL;
+    p.outMap = outMap;
+    p.tiles = tiles;
+    p.nY = nY;
+    p.nXnY = nXnY;
+    p.returnsMap = returnsMap;
+    p.jacobian = (layers == JACOBIAN_LAYERS);
+    /* the threads of openMP stay alive between calls*/
+    /* all columns of all frames are done in parallel*/
+    /* columns near the boundary of the Poincare disc take much more time*/
+    nTasks = (ptrdiff_t) nFrames * nX;
+    #pragma omp parallel for schedule(dynamic) if ((size_t) nXnY * nFrames > PARALLEL_MIN)
+    for (task = 0; task < nTasks; task++){
+        int taskFrame = (int) (task / nX);
+        mapping framePart = p;
+        if (inMap != NULL){
+            framePart.inMap = inMap + (size_t) ((nMapFrames > 1) ? taskFrame : 0) * layers * nXnY;
+        }
+        framePart.outMap = outMap + (size_t) taskFrame * layers * nXnY;
+        if (tiles != NULL){
+            framePart.tiles = tiles + (size_t) taskFrame * 2 * nXnY;
         }
+        mapColumn((geometries == NULL) ? &cachedGeometry : &geometries[taskFrame], &framePart, (int) (task % nX));
     }
 }
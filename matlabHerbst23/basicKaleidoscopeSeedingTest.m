@@ -0,0 +1,38 @@
+% compares the basic kaleidoscope with and without seeding
+% shows the times, the results have to be identical
+
+% first use compile.m to compile the files
+
+function basicKaleidoscopeSeedingTest()
+% test of seeding for the basic kaleidoscope
+% hyperbolic tiling, most pixels near the boundary need many iterations
+% shows pattern of inversions, using seeding
+
+s = 1000;
+mPix=s*s/1e6;
+r=1;
+map=identityMap(mPix,-r,r,-r,r);
+
+%params k,m,n: euklidic, elliptic and hyperbolic kaleidoscopes, the last one is shown
+kaleidoscopes=[4,4,2;3,3,3;3,3,2;4,4,4;7,3,2;5,4,2];
+for i=1:size(kaleidoscopes,1)
+    k=kaleidoscopes(i,1);
+    m=kaleidoscopes(i,2);
+    n=kaleidoscopes(i,3);
+    fprintf('kaleidoscope %d %d %d\n',k,m,n);
+    %params map,k,m,n,maxRange,minRange,seeding
+    tic;
+    [outMap,tiles] = basicKaleidoscope(map,k,m,n,1000,0,0);
+    fprintf('without seeding %.3f s\n',toc);
+    tic;
+    [seededMap,seededTiles] = basicKaleidoscope(map,k,m,n,1000,0,1);
+    fprintf('with seeding %.3f s\n',toc);
+    if ~isequal(outMap,seededMap) || ~isequal(tiles,seededTiles)
+        error('basicKaleidoscopeSeedingTest:different','Seeding changes the result for %d %d %d.',k,m,n);
+    end
+    fprintf('identical results\n');
+end
+
+im=createStructureImage(seededMap);
+imshow(im);
+end
@@ -0,0 +1,28 @@
+% makes a sweep of basic kaleidoscopes in one call
+% vectors of parameters give a stack of maps
+
+% first use compile.m to compile the files
+
+function basicKaleidoscopeSweepTest()
+% test of parameter vectors for the basic kaleidoscope
+% n changes from frame to frame, k and m are the same for all frames
+% shows the pattern of inversions of the frames one after the other
+
+s = 500;
+mPix=s*s/1e6;
+r=1;
+map=identityMap(mPix,-r,r,-r,r);
+
+%params map,k,m,n as vector
+n=2:7;
+tic;
+outMaps = basicKaleidoscope(map,5,4,n);
+fprintf('%d frames in %.3f s\n',numel(n),toc);
+
+for frame=1:numel(n)
+    im=createStructureImage(outMaps(:,:,:,frame));
+    imshow(im);
+    title(sprintf('k=5, m=4, n=%d',n(frame)));
+    pause(1);
+end
+end
@@ -0,0 +1,31 @@
+% colors the tiles of the basic kaleidoscope
+% uses the tiles output, no second kaleidoscope pass
+
+% first use compile.m to compile the files
+
+function basicKaleidoscopeTilesTest()
+% test of the tiles output of the basic kaleidoscope
+% each tile gets a random color from the hash of its word
+% the brightness decreases with the word length
+
+s = 1000;
+mPix=s*s/1e6;
+r=1;
+map=identityMap(mPix,-r,r,-r,r);
+
+%params map,k,m,n
+[outMap,tiles] = basicKaleidoscope(map,5,4,2);
+
+hash=tiles(:,:,2);
+wordLength=double(tiles(:,:,1));
+valid=hash>0;
+% a color for each different hash, one lookup per pixel
+[~,~,tileIndex]=unique(hash(valid));
+colors=0.3+0.7*rand(max(tileIndex),3);
+brightness=1./(1+0.05*wordLength(valid));
+im=zeros(size(hash,1)*size(hash,2),3);
+im(valid,:)=colors(tileIndex,:).*brightness;
+im=reshape(im,size(hash,1),size(hash,2),3);
+
+imshow(im);
+end
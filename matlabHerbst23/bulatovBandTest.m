@@ -12,13 +12,17 @@ period=getBulatovPeriod(k,m,2);
 % y range always -1 to +1 for Bulatov band
 h=1;
 % x range contains given number of periods of bulatov band
-nPeriods=4;
+nPeriods=20;
 w=0.5*nPeriods*period;
 
 % create corresponding map with bulatov band
-map=identityMap(mPix,-w,w,-h,h);
-basicBulatovBand(map,period);
-map = basicKaleidoscope(map,k,m,2);
+% the band is periodic: do the kernels only for one period and copy its columns,
+% a banner of 20 periods costs about one period
+% the band starts from a grid, no identity map
+onePeriod=basicBulatovBand(identityGrid(mPix/nPeriods,-w,-w+period,-h,h),period);
+onePeriod = basicKaleidoscope(onePeriod,k,m,2);
+map=repmat(onePeriod,1,nPeriods);
+% for a map of all periods basicBulatovBand(map,period,0) copies the repeated columns
 
 
 % set range of x- and y-values, for reuse in other cases
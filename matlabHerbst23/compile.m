@@ -9,7 +9,9 @@ cd /home/peter/images/matlabHerbst23
 % mex -v CFLAGS='$CFLAGS -Wall' whatever.c 
 % https://gcc.gnu.org/onlinedocs/gcc-3.4.6/gcc/Optimize-Options.html
 mex identityMap.c
-mex basicKaleidoscope.c
+% with openMP for using all cores
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' basicKaleidoscope.c
+mex CFLAGS='$CFLAGS -O3 -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' formulaTransform.c
 %mex poincarePlaneToDisc.c
 mex createStructureImage.c
 mex getRangeMap.c
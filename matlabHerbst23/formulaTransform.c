@@ -0,0 +1,651 @@
+/*==========================================================
+ * formulaTransform: transform a map with a formula given as a string,
+ * no need to change c-code and recompile for new transforms
+ * Input: the map has for each pixel (h,k):
+ * map(h,k,0) = x, map(h,k,1) = y, map(h,k,2) = 0 (number of inversions)
+ *
+ * formulaTransform(map, formula);
+ * formulaTransform(map, formula, a);
+ *
+ * formula: a string with a complex expression, for example
+ *     'z^2', '(z-i)/(z+i)', 'exp(a1*log(z))', 'z+a1*conj(z)^3', 'x+i*sin(y)'
+ * with
+ *     variables: z = x + i*y, x, y (real and imaginary part of z)
+ *     constants: numbers (1, 0.5, 2e-3), i, pi, e
+ *     parameters: a1 ... a10, from the optional array a, default 0
+ *     operators: + - * / ^ and parentheses
+ *     functions: exp, log, sqrt, sin, cos, tan, sinh, cosh, tanh,
+ *                conj, abs, arg, real, imag, pow(u,v)
+ * the formula is compiled once into a register bytecode, with
+ * constant parts already evaluated and integer powers done by multiplication,
+ * then the bytecode runs over blocks of pixels, the loops of the
+ * arithmetic operations over a block vectorize
+ *
+ * the parity map(h,k,2) does not change, as in complexTransform
+ *
+ * modifies the map, returns nothing if used as a procedure
+ * formulaTransform(map, formula, a);
+ * does not change the map and returns a modified map if used as  a function
+ * newMap = formulaTransform(map, formula, a);
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <complex.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#define INVALID -1
+#define MAX_FORMULA 1000
+#define MAX_REGISTERS 64
+#define MAX_INSTRUCTIONS 64
+/* pixels done together by each instruction*/
+#define BLOCK 64
+/* maximum integer power done by multiplication*/
+#define MAX_INTEGER_POWER 64
+#define PARALLEL_MIN 10000
+
+/* registers 0, 1, 2 hold z, x and y of the pixels*/
+#define REGISTER_Z 0
+#define REGISTER_X 1
+#define REGISTER_Y 2
+
+enum opCode {ADD, SUB, MUL, DIV, NEG, INTEGER_POWER, POW, EXP, LOG, SQRT,
+        SIN, COS, TAN, SINH, COSH, TANH, CONJ, ABS, ARG, REAL, IMAG};
+
+static const char *functionNames[] = {"exp", "log", "sqrt", "sin", "cos", "tan",
+        "sinh", "cosh", "tanh", "conj", "abs", "arg", "real", "imag"};
+static const enum opCode functionCodes[] = {EXP, LOG, SQRT, SIN, COS, TAN,
+        SINH, COSH, TANH, CONJ, ABS, ARG, REAL, IMAG};
+#define N_FUNCTIONS 14
+
+typedef struct {
+    enum opCode op;
+    int result, a, b;
+    /* exponent of INTEGER_POWER*/
+    int n;
+} instruction;
+
+typedef struct {
+    instruction instructions[MAX_INSTRUCTIONS];
+    int nInstructions;
+    int nRegisters;
+    /* registers with constant values, set once*/
+    int constantRegisters[MAX_REGISTERS];
+    float complex constants[MAX_REGISTERS];
+    int nConstants;
+    /* register of the result, or constant result*/
+    int result;
+    bool isConstant;
+    float complex constant;
+} program;
+
+/* a value during compilation, either known constant or in a register*/
+typedef struct {
+    bool isConstant;
+    float complex value;
+    int reg;
+} operand;
+
+typedef struct {
+    const char *text;
+    int position;
+    float parameters[10];
+    program *code;
+} parser;
+
+/* the operations for a single value, for constants and transcendental functions*/
+static float complex applyOperation(enum opCode op, float complex u, float complex v, int n)
+{
+    float complex result;
+    int m;
+    switch (op) {
+        case ADD: return u + v;
+        case SUB: return u - v;
+        case MUL: return u * v;
+        case DIV: return u / v;
+        case NEG: return -u;
+        case INTEGER_POWER:
+            result = 1;
+            m = abs(n);
+            while (m > 0) {
+                if (m & 1) {
+                    result *= u;
+                }
+                u *= u;
+                m >>= 1;
+            }
+            return (n < 0) ? 1 / result : result;
+        case POW: return cexpf(v * clogf(u));
+        case EXP: return cexpf(u);
+        case LOG: return clogf(u);
+        case SQRT: return csqrtf(u);
+        case SIN: return csinf(u);
+        case COS: return ccosf(u);
+        case TAN: return ctanf(u);
+        case SINH: return csinhf(u);
+        case COSH: return ccoshf(u);
+        case TANH: return ctanhf(u);
+        case CONJ: return conjf(u);
+        case ABS: return cabsf(u);
+        case ARG: return cargf(u);
+        case REAL: return crealf(u);
+        default: return cimagf(u);
+    }
+}
+
+static void syntaxError(parser *p, const char *message)
+{
+    mexErrMsgIdAndTxt("formulaTransform:syntax", "%s at position %d of '%s'.",
+            message, p->position + 1, p->text);
+}
+
+static void skipSpaces(parser *p)
+{
+    while (isspace((unsigned char) p->text[p->position])) {
+        p->position++;
+    }
+}
+
+static int newRegister(parser *p)
+{
+    if (p->code->nRegisters >= MAX_REGISTERS) {
+        syntaxError(p, "Formula too long");
+    }
+    return p->code->nRegisters++;
+}
+
+/* put a constant into a register, if it is used with a variable*/
+static int getRegister(parser *p, operand u)
+{
+    program *code = p->code;
+    if (!u.isConstant) {
+        return u.reg;
+    }
+    u.reg = newRegister(p);
+    code->constantRegisters[code->nConstants] = u.reg;
+    code->constants[code->nConstants] = u.value;
+    code->nConstants++;
+    return u.reg;
+}
+
+/* emit an instruction, or evaluate it if all operands are constant*/
+static operand emit(parser *p, enum opCode op, operand u, operand v, int n)
+{
+    operand result;
+    instruction *in;
+    bool isBinary = (op == ADD) || (op == SUB) || (op == MUL) || (op == DIV) || (op == POW);
+    if (u.isConstant && (v.isConstant || !isBinary)) {
+        result.isConstant = true;
+        result.value = applyOperation(op, u.value, v.value, n);
+        result.reg = -1;
+        return result;
+    }
+    if (p->code->nInstructions >= MAX_INSTRUCTIONS) {
+        syntaxError(p, "Formula too long");
+    }
+    in = &p->code->instructions[p->code->nInstructions++];
+    in->op = op;
+    in->a = getRegister(p, u);
+    in->b = isBinary ? getRegister(p, v) : in->a;
+    in->n = n;
+    in->result = newRegister(p);
+    result.isConstant = false;
+    result.value = 0;
+    result.reg = in->result;
+    return result;
+}
+
+static operand constantOperand(float complex value)
+{
+    operand result;
+    result.isConstant = true;
+    result.value = value;
+    result.reg = -1;
+    return result;
+}
+
+static operand registerOperand(int reg)
+{
+    operand result;
+    result.isConstant = false;
+    result.value = 0;
+    result.reg = reg;
+    return result;
+}
+
+static operand parseExpression(parser *p);
+static operand parseUnary(parser *p);
+
+static void expect(parser *p, char c)
+{
+    skipSpaces(p);
+    if (p->text[p->position] != c) {
+        syntaxError(p, (c == ')') ? "Missing ')'" : "Missing ','");
+    }
+    p->position++;
+}
+
+static operand parsePrimary(parser *p)
+{
+    char name[16];
+    char *end;
+    int length, i;
+    float value;
+    operand u, v;
+    skipSpaces(p);
+    if (p->text[p->position] == '(') {
+        p->position++;
+        u = parseExpression(p);
+        expect(p, ')');
+        return u;
+    }
+    if (isdigit((unsigned char) p->text[p->position]) || (p->text[p->position] == '.')) {
+        value = strtof(p->text + p->position, &end);
+        if (end == p->text + p->position) {
+            syntaxError(p, "Bad number");
+        }
+        p->position = end - p->text;
+        return constantOperand(value);
+    }
+    if (!isalpha((unsigned char) p->text[p->position])) {
+        syntaxError(p, "Number, name or '(' expected");
+    }
+    length = 0;
+    while (isalnum((unsigned char) p->text[p->position])) {
+        if (length < 15) {
+            name[length++] = p->text[p->position];
+        }
+        p->position++;
+    }
+    name[length] = '\0';
+    if (strcmp(name, "z") == 0) {
+        return registerOperand(REGISTER_Z);
+    }
+    if (strcmp(name, "x") == 0) {
+        return registerOperand(REGISTER_X);
+    }
+    if (strcmp(name, "y") == 0) {
+        return registerOperand(REGISTER_Y);
+    }
+    if (strcmp(name, "i") == 0) {
+        return constantOperand(I);
+    }
+    if (strcmp(name, "pi") == 0) {
+        return constantOperand(3.14159265f);
+    }
+    if (strcmp(name, "e") == 0) {
+        return constantOperand(2.71828183f);
+    }
+    /* a parameter: 'a' followed only by digits, "a2x" is an unknown name*/
+    if ((name[0] == 'a') && (name[1] != '\0') && (strspn(name + 1, "0123456789") == strlen(name + 1))) {
+        /* longer numbers are no parameter, atoi might overflow*/
+        i = (strlen(name + 1) <= 2) ? atoi(name + 1) : 0;
+        if ((i < 1) || (i > 10)) {
+            syntaxError(p, "Parameters are a1 ... a10");
+        }
+        return constantOperand(p->parameters[i - 1]);
+    }
+    skipSpaces(p);
+    if (p->text[p->position] != '(') {
+        syntaxError(p, "Unknown name");
+    }
+    p->position++;
+    u = parseExpression(p);
+    if (strcmp(name, "pow") == 0) {
+        expect(p, ',');
+        v = parseExpression(p);
+        expect(p, ')');
+        return emit(p, POW, u, v, 0);
+    }
+    expect(p, ')');
+    for (i = 0; i < N_FUNCTIONS; i++){
+        if (strcmp(name, functionNames[i]) == 0) {
+            return emit(p, functionCodes[i], u, u, 0);
+        }
+    }
+    syntaxError(p, "Unknown function");
+    return u;
+}
+
+/* u^n by repeated squaring, vectorizing multiplications instead of exp and log*/
+static operand integerPower(parser *p, operand u, int n)
+{
+    operand result;
+    bool hasResult;
+    int m;
+    if (u.isConstant) {
+        return emit(p, INTEGER_POWER, u, u, n);
+    }
+    m = abs(n);
+    hasResult = false;
+    result = constantOperand(1);
+    while (m > 0) {
+        if (m & 1) {
+            result = hasResult ? emit(p, MUL, result, u, 0) : u;
+            hasResult = true;
+        }
+        m >>= 1;
+        if (m > 0) {
+            u = emit(p, MUL, u, u, 0);
+        }
+    }
+    if (n < 0) {
+        result = emit(p, DIV, constantOperand(1), result, 0);
+    }
+    return result;
+}
+
+/* power is right associative*/
+static operand parsePower(parser *p)
+{
+    operand u, v;
+    float n;
+    u = parsePrimary(p);
+    skipSpaces(p);
+    if (p->text[p->position] != '^') {
+        return u;
+    }
+    p->position++;
+    v = parseUnary(p);
+    if (v.isConstant && (cimagf(v.value) == 0)) {
+        n = crealf(v.value);
+        if ((n == floorf(n)) && (fabsf(n) <= MAX_INTEGER_POWER)) {
+            return integerPower(p, u, (int) n);
+        }
+    }
+    return emit(p, POW, u, v, 0);
+}
+
+static operand parseUnary(parser *p)
+{
+    operand u;
+    skipSpaces(p);
+    if (p->text[p->position] == '-') {
+        p->position++;
+        u = parseUnary(p);
+        return emit(p, NEG, u, u, 0);
+    }
+    if (p->text[p->position] == '+') {
+        p->position++;
+        return parseUnary(p);
+    }
+    return parsePower(p);
+}
+
+static operand parseTerm(parser *p)
+{
+    operand u, v;
+    char c;
+    u = parseUnary(p);
+    for (;;) {
+        skipSpaces(p);
+        c = p->text[p->position];
+        if ((c != '*') && (c != '/')) {
+            return u;
+        }
+        p->position++;
+        v = parseUnary(p);
+        u = emit(p, (c == '*') ? MUL : DIV, u, v, 0);
+    }
+}
+
+static operand parseExpression(parser *p)
+{
+    operand u, v;
+    char c;
+    u = parseTerm(p);
+    for (;;) {
+        skipSpaces(p);
+        c = p->text[p->position];
+        if ((c != '+') && (c != '-')) {
+            return u;
+        }
+        p->position++;
+        v = parseTerm(p);
+        u = emit(p, (c == '+') ? ADD : SUB, u, v, 0);
+    }
+}
+
+static void compile(program *code, const char *text, const float *parameters)
+{
+    parser p;
+    operand result;
+    int i;
+    p.text = text;
+    p.position = 0;
+    p.code = code;
+    for (i = 0; i < 10; i++){
+        p.parameters[i] = parameters[i];
+    }
+    code->nInstructions = 0;
+    code->nRegisters = 3;
+    code->nConstants = 0;
+    result = parseExpression(&p);
+    skipSpaces(&p);
+    if (p.text[p.position] != '\0') {
+        syntaxError(&p, "Unexpected character");
+    }
+    code->isConstant = result.isConstant;
+    code->constant = result.value;
+    code->result = result.reg;
+}
+
+/* run the program for a block of n pixels, registers as separate real and imaginary arrays*/
+static void run(const program *code, float re[][BLOCK], float im[][BLOCK], int n)
+{
+    int i, k;
+    const instruction *in;
+    float *ra, *ia, *rb, *ib, *rr, *ir;
+    float den, u, v;
+    float complex w;
+    for (i = 0; i < code->nInstructions; i++){
+        in = &code->instructions[i];
+        ra = re[in->a];
+        ia = im[in->a];
+        rb = re[in->b];
+        ib = im[in->b];
+        rr = re[in->result];
+        ir = im[in->result];
+        switch (in->op) {
+            case ADD:
+                for (k = 0; k < n; k++){
+                    rr[k] = ra[k] + rb[k];
+                    ir[k] = ia[k] + ib[k];
+                }
+                break;
+            case SUB:
+                for (k = 0; k < n; k++){
+                    rr[k] = ra[k] - rb[k];
+                    ir[k] = ia[k] - ib[k];
+                }
+                break;
+            case MUL:
+                for (k = 0; k < n; k++){
+                    u = ra[k] * rb[k] - ia[k] * ib[k];
+                    v = ra[k] * ib[k] + ia[k] * rb[k];
+                    rr[k] = u;
+                    ir[k] = v;
+                }
+                break;
+            case DIV:
+                for (k = 0; k < n; k++){
+                    den = 1.0f / (rb[k] * rb[k] + ib[k] * ib[k]);
+                    u = (ra[k] * rb[k] + ia[k] * ib[k]) * den;
+                    v = (ia[k] * rb[k] - ra[k] * ib[k]) * den;
+                    rr[k] = u;
+                    ir[k] = v;
+                }
+                break;
+            case NEG:
+                for (k = 0; k < n; k++){
+                    rr[k] = -ra[k];
+                    ir[k] = -ia[k];
+                }
+                break;
+            case CONJ:
+                for (k = 0; k < n; k++){
+                    rr[k] = ra[k];
+                    ir[k] = -ia[k];
+                }
+                break;
+            case REAL:
+                for (k = 0; k < n; k++){
+                    rr[k] = ra[k];
+                    ir[k] = 0;
+                }
+                break;
+            case IMAG:
+                for (k = 0; k < n; k++){
+                    rr[k] = ia[k];
+                    ir[k] = 0;
+                }
+                break;
+            case ABS:
+                for (k = 0; k < n; k++){
+                    rr[k] = sqrtf(ra[k] * ra[k] + ia[k] * ia[k]);
+                    ir[k] = 0;
+                }
+                break;
+            default:
+                for (k = 0; k < n; k++){
+                    w = applyOperation(in->op, ra[k] + I * ia[k], rb[k] + I * ib[k], in->n);
+                    rr[k] = crealf(w);
+                    ir[k] = cimagf(w);
+                }
+                break;
+        }
+    }
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *dims, *aDims;
+    float a[10];
+    double *doubleA;
+    int i, nParams;
+    int nX, nY, nXnY, nXnY2, start, n, k, index;
+    float *inMap, *outMap;
+    char formula[MAX_FORMULA];
+    program code;
+    bool returnsMap = false;
+    /* default value for parameters a is 0 */
+    for (i=0;i<10;i++){
+        a[i]=0;
+    }
+    /* check for proper number of arguments (else crash)*/
+    /* checking for presence of a map and formula*/
+    if(nrhs < 2) {
+        mexErrMsgIdAndTxt("formulaTransform:nrhs","A map input and a formula string required.");
+    }
+    /* check number of dimensions of the map*/
+    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
+        mexErrMsgIdAndTxt("formulaTransform:mapDims","The map has to have three dimensions.");
+    }
+    dims = mxGetDimensions(prhs[0]);
+    if(dims[2] != 3) {
+        mexErrMsgIdAndTxt("formulaTransform:map3rdDimension","The map's third dimension has to be three.");
+    }
+    /* check that no or one output is expected*/
+    if (nlhs > 1) {
+        mexErrMsgIdAndTxt("formulaTransform:nlhs","Has zero or one return parameter.");
+    }
+    if (!mxIsChar(prhs[1]) || (mxGetString(prhs[1], formula, MAX_FORMULA) != 0)) {
+        mexErrMsgIdAndTxt("formulaTransform:formula","The formula has to be a string of less than 1000 characters.");
+    }
+    /* get the map*/
+#if MX_HAS_INTERLEAVED_COMPLEX
+    inMap = mxGetSingles(prhs[0]);
+#else
+    inMap = (float *) mxGetPr(prhs[0]);
+#endif
+    /* load the parameters, if present */
+    if(nrhs > 2) {
+        aDims = mxGetDimensions(prhs[2]);
+        if((mxGetNumberOfDimensions(prhs[2]) !=2)||(aDims[0] >1)) {
+            mexErrMsgIdAndTxt("formulaTransform:dims","The array for parameters has to have 1 dimension.");
+        }
+        if(aDims[1] >10) {
+            mexErrMsgIdAndTxt("formulaTransform:dims","Too many parameters, maximum 10 exceeded.");
+        }
+        nParams = aDims[1];
+        #if MX_HAS_INTERLEAVED_COMPLEX
+            doubleA = mxGetDoubles(prhs[2]);
+        #else
+            doubleA = (double *) mxGetPr(prhs[2]);
+        #endif
+        for (i=0;i<nParams;i++){
+             a[i] = (float) doubleA[i];
+        }
+    }
+    compile(&code, formula, a);
+    /* left hand side */
+    if (nlhs == 0){
+        outMap = inMap;
+    } else {
+        /* create output map*/
+        returnsMap = true;
+        plhs[0]=mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outMap = mxGetSingles(plhs[0]);
+#else
+        outMap = (float *) mxGetPr(plhs[0]);
+#endif
+    }
+    /* do the map*/
+    /* row first order, blocks of pixels*/
+    nX = dims[1];
+    nY = dims[0];
+    nXnY = nX * nY;
+    nXnY2 = 2 * nXnY;
+#pragma omp parallel for private(n, k, index, i) schedule(static) if (nXnY > PARALLEL_MIN)
+    for (start = 0; start < nXnY; start += BLOCK){
+        float re[MAX_REGISTERS][BLOCK], im[MAX_REGISTERS][BLOCK];
+        float *rz, *iz;
+        n = (nXnY - start < BLOCK) ? nXnY - start : BLOCK;
+        for (k = 0; k < n; k++){
+            index = start + k;
+            re[REGISTER_Z][k] = inMap[index];
+            im[REGISTER_Z][k] = inMap[index + nXnY];
+            re[REGISTER_X][k] = inMap[index];
+            im[REGISTER_X][k] = 0;
+            re[REGISTER_Y][k] = inMap[index + nXnY];
+            im[REGISTER_Y][k] = 0;
+        }
+        for (i = 0; i < code.nConstants; i++){
+            for (k = 0; k < n; k++){
+                re[code.constantRegisters[i]][k] = crealf(code.constants[i]);
+                im[code.constantRegisters[i]][k] = cimagf(code.constants[i]);
+            }
+        }
+        run(&code, re, im, n);
+        if (!code.isConstant) {
+            rz = re[code.result];
+            iz = im[code.result];
+        }
+        for (k = 0; k < n; k++){
+            index = start + k;
+            /* do only transform if pixel is valid*/
+            if (inMap[index + nXnY2] < -0.1f) {
+                if (returnsMap){
+                    /* set element only if new output map*/
+                    outMap[index] = INVALID;
+                    outMap[index + nXnY] = INVALID;
+                    outMap[index + nXnY2] = INVALID;
+                }
+                continue;
+            }
+            if (code.isConstant) {
+                outMap[index] = crealf(code.constant);
+                outMap[index + nXnY] = cimagf(code.constant);
+            } else {
+                outMap[index] = rz[k];
+                outMap[index + nXnY] = iz[k];
+            }
+            outMap[index + nXnY2] = inMap[index + nXnY2];
+        }
+    }
+}
@@ -0,0 +1,54 @@
+% compares formulaTransform with the hand written transforms
+% shows times and maximum differences, then an image of a formula
+
+% first use compile.m to compile the files
+
+function formulaTransformTest()
+% benchmark of the formula bytecode against compiled c-code
+% complexTransform does z*z, cayleyTransform does (z-i)/(z+i)
+
+s = 2000;
+mPix=s*s/1e6;
+r=2;
+map=identityMap(mPix,-r,r,-r,r);
+repeats=10;
+
+tic;
+for i=1:repeats
+    handMap=complexTransform(map);
+end
+handTime=toc/repeats;
+tic;
+for i=1:repeats
+    formulaMap=formulaTransform(map,'z*z');
+end
+formulaTime=toc/repeats;
+fprintf('z*z:         complexTransform %.1f ms, formulaTransform %.1f ms, max difference %g\n',...
+    1000*handTime,1000*formulaTime,maxDifference(handMap,formulaMap));
+
+tic;
+for i=1:repeats
+    handMap=cayleyTransform(map);
+end
+handTime=toc/repeats;
+tic;
+for i=1:repeats
+    formulaMap=formulaTransform(map,'(z-i)/(z+i)');
+end
+formulaTime=toc/repeats;
+fprintf('(z-i)/(z+i): cayleyTransform %.1f ms, formulaTransform %.1f ms, max difference %g\n',...
+    1000*handTime,1000*formulaTime,maxDifference(handMap,formulaMap));
+
+% a formula with parameters, no recompilation needed for changes
+outMap=formulaTransform(map,'z+a1*conj(z)^3+a2*sin(z)',[0.1,0.2]);
+outMap = basicKaleidoscope(outMap,5,4,2);
+im=createStructureImage(outMap);
+imshow(im);
+end
+
+function difference = maxDifference(mapA,mapB)
+% maximum difference of the coordinates of valid pixels
+valid=mapA(:,:,3)>-0.1;
+difference=abs(mapA(:,:,1:2)-mapB(:,:,1:2));
+difference=max(difference(repmat(valid,1,1,2)));
+end
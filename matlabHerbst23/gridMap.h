@@ -0,0 +1,80 @@
+/*==========================================================
+ * gridMap.h: kernels that start from a grid instead of an identity map
+ *
+ * grid = identityGrid(mPixels, xMin, xMax, yMin, yMax);
+ * is a double vector [nY, nX, xMin, dx, yMax, dy], it describes the map
+ * of createIdentityMap(mPixels, xMin, xMax, yMin, yMax) without creating it:
+ *     map(k,j,0) = xMin + (j + 0.5) * dx, column j
+ *     map(k,j,1) = yMax - (k + 0.5) * dy, row k (the y-axis is inverted)
+ *     map(k,j,2) = 0, all pixels are valid
+ * equal to createIdentityMap up to its accumulated rounding: it adds dx and dy
+ * pixel after pixel in single precision, its coordinates differ by up to some 0.1 * dx
+ *
+ * a kernel that accepts a grid makes the coordinates in its loop,
+ * writing the identity map and reading it again is not needed:
+ *     newMap = moebiusTransformMap(grid, params);
+ * there is nothing to modify, kernels return a new map of 3 layers
+ *
+ *========================================================*/
+
+#ifndef GRID_MAP_H
+#define GRID_MAP_H
+
+#include <stdbool.h>
+#define GRID_ELEMENTS 6
+
+typedef struct {
+    int nX, nY;
+    float xMin, dx, yMax, dy;
+} grid;
+
+/* a grid is a double vector of 6 elements, maps are single arrays*/
+static inline bool isGrid(const mxArray *input)
+{
+    return mxIsDouble(input) && (mxGetNumberOfDimensions(input) == 2)
+            && (mxGetNumberOfElements(input) == GRID_ELEMENTS);
+}
+
+/* read the grid, dims get the size of the map it describes*/
+static void getGrid(const mxArray *input, grid *g, mwSize *dims)
+{
+    double *values;
+#if MX_HAS_INTERLEAVED_COMPLEX
+    values = mxGetDoubles(input);
+#else
+    values = mxGetPr(input);
+#endif
+    if ((values[0] < 1) || (values[1] < 1) || (values[0] != floor(values[0])) || (values[1] != floor(values[1]))) {
+        mexErrMsgIdAndTxt("gridMap:size","The grid [nY, nX, xMin, dx, yMax, dy] needs positive integer nY and nX.");
+    }
+    g->nY = (int) values[0];
+    g->nX = (int) values[1];
+    g->xMin = (float) values[2];
+    g->dx = (float) values[3];
+    g->yMax = (float) values[4];
+    g->dy = (float) values[5];
+    dims[0] = (mwSize) g->nY;
+    dims[1] = (mwSize) g->nX;
+    dims[2] = 3;
+}
+
+/* x of a column, y of a row*/
+static inline float gridX(const grid *g, int column)
+{
+    return g->xMin + (column + 0.5f) * g->dx;
+}
+
+static inline float gridY(const grid *g, int row)
+{
+    return g->yMax - (row + 0.5f) * g->dy;
+}
+
+/* both coordinates of a pixel, for kernels that loop over the index only*/
+static inline void gridPixel(const grid *g, int index, float *x, float *y)
+{
+    int column = index / g->nY;
+    *x = gridX(g, column);
+    *y = gridY(g, index - column * g->nY);
+}
+
+#endif
@@ -0,0 +1,113 @@
+function [image, edges] = adaptiveSupersample(map, chain, colorize, nSub, jumpRatio, withTiles)
+% anti-aliased image, supersampling only the pixels at edges
+%   image=adaptiveSupersample(map,chain,colorize);
+%   image=adaptiveSupersample(map,chain,colorize,nSub,jumpRatio,withTiles);
+%   [image,edges]=adaptiveSupersample(...);
+%
+% map: the initial map on a regular grid, from createIdentityMap,
+%      may have the jacobian (7 layers)
+% chain: function handle newMap=chain(map), does the kernels of the image,
+%      for example @(m) basicKaleidoscope(m,7,3,2), has to return a new map
+% colorize: function handle image=colorize(newMap), the colors of the pixels,
+%      for example @(m) createColorImage(m,'parity',[1 1 0;0 0 1])
+%      or @(m) sampleImage(inputImage,a*m(:,:,1)+b,a*m(:,:,2)+c)
+%      chain and colorize have to do each pixel on its own, they get a map
+%      of the subsamples (makeOutputImageFitMapToInput does not work,
+%      it fits the range of the map)
+% nSub: subsamples per side of an edge pixel, default 4 (16 subsamples)
+% jumpRatio: a pixel is an edge if the distance of its (x,y) to a neighbour
+%      is more than jumpRatio times the distance to the opposite neighbour, default 4
+% withTiles: if true calls [newMap,tiles]=chain(map) for the centres and
+%      pixels where the tile hash tiles(:,:,2) changes are edges, default false
+%
+% the chain runs once for the pixel centres, edges are pixels with a neighbour
+% of other parity or validity (or tile) and pixels with a jump of the coordinates
+% then the chain runs again only for the nSub*nSub subsamples of the edges
+% and their colors are averaged, edges is the logical matrix of these pixels
+% usually less than 10% of the pixels are edges
+
+if nargin < 4
+    nSub=4;
+end
+if nargin < 5
+    jumpRatio=4;
+end
+if nargin < 6
+    withTiles=false;
+end
+[nY,nX,nLayers]=size(map);
+nXnY=nX*nY;
+% the pixel centres
+if withTiles
+    [newMap,tiles]=chain(map);
+else
+    newMap=chain(map);
+end
+image=colorize(newMap);
+
+% edges: changes of parity and validity, all invalid pixels are the same
+parity=newMap(:,:,3);
+parity(parity<-0.1)=-1;
+edges=differsFromNeighbour(parity);
+if withTiles
+    edges=edges|differsFromNeighbour(tiles(:,:,2));
+end
+% edges: jumps of the coordinates, the distance to one neighbour is much larger
+% than to the opposite one, anisotropic maps have different distances along rows and columns
+x=newMap(:,:,1);
+y=newMap(:,:,2);
+distances=NaN(nY,nX,2,'single');
+d=hypot(diff(x,1,2),diff(y,1,2));
+distances(:,1:end-1,1)=d;
+distances(:,2:end,2)=d;
+jumps=max(distances,[],3)>jumpRatio*min(distances,[],3);
+d=hypot(diff(x,1,1),diff(y,1,1));
+distances(:)=NaN;
+distances(1:end-1,:,1)=d;
+distances(2:end,:,2)=d;
+jumps=jumps|(max(distances,[],3)>jumpRatio*min(distances,[],3));
+edges=edges|(jumps&(parity>-0.1));
+indices=find(edges);
+nEdges=numel(indices);
+if nEdges==0
+    return
+end
+
+% subsamples of the edge pixels, one column for each, as a map of size (nSub*nSub, nEdges)
+% offsets along the columns (u) and rows (v) of the grid, works also for rotated grids
+dxdu=map(1,min(2,nX),1)-map(1,1,1);
+dydu=map(1,min(2,nX),2)-map(1,1,2);
+dxdv=map(min(2,nY),1,1)-map(1,1,1);
+dydv=map(min(2,nY),1,2)-map(1,1,2);
+offsets=((1:nSub)-0.5)/nSub-0.5;
+[offsetU,offsetV]=meshgrid(offsets);
+offsetU=offsetU(:);
+offsetV=offsetV(:);
+subMap=zeros(nSub*nSub,nEdges,nLayers,'single');
+xCentre=map(indices)';
+yCentre=map(indices+nXnY)';
+subMap(:,:,1)=xCentre+offsetU*dxdu+offsetV*dxdv;
+subMap(:,:,2)=yCentre+offsetU*dydu+offsetV*dydv;
+subMap(:,:,3)=repmat(map(indices+2*nXnY)',nSub*nSub,1);
+% the jacobian of a subsample grid is smaller by nSub
+for layer=4:nLayers
+    subMap(:,:,layer)=repmat(map(indices+(layer-1)*nXnY)'/nSub,nSub*nSub,1);
+end
+subImage=colorize(chain(subMap));
+% average of the subsamples, rounded to the class of the image
+colors=mean(single(subImage),1);
+for layer=1:size(image,3)
+    image(indices+(layer-1)*nXnY)=colors(1,:,layer);
+end
+end
+
+% true for pixels with a 4-neighbour of different value
+function edges=differsFromNeighbour(values)
+edges=false(size(values));
+d=values(:,1:end-1)~=values(:,2:end);
+edges(:,1:end-1)=edges(:,1:end-1)|d;
+edges(:,2:end)=edges(:,2:end)|d;
+d=values(1:end-1,:)~=values(2:end,:);
+edges(1:end-1,:)=edges(1:end-1,:)|d;
+edges(2:end,:)=edges(2:end,:)|d;
+end
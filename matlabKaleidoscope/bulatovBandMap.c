@@ -11,11 +11,16 @@
  * does not change the map and returns a modified map if used as  a function
  * newMap = transform(map, ....);
  *
+ * instead of an identity map takes a grid (see gridMap.h), returns a new map
+ * newMap = bulatovBandMap(identityGrid(mPixels, xMin, xMax, -1, 1), a);
+ *
  *========================================================*/
 
 #include "mex.h"
 #include <math.h>
 #include <stdbool.h>
+#include "fastMath.h"
+#include "gridMap.h"
 #define PI 3.14159f
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
@@ -25,33 +30,49 @@ void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     const mwSize *dims;
-    int nX, nY, nXnY, nXnY2, index;
+    mwSize gridDims[3];
+    grid inGrid;
+    bool isGridInput;
+    int nX, nY, nXnY, nXnY2, index, column, row;
     float inverted, x, y;
-    float *inMap, *outMap, a, piA2, iTanPiA4, exp2x, base;
+    float *inMap, *outMap, a, piA2, iTanPiA4, exp2x, base, sinY, cosY;
+    bool invalid;
     bool returnsMap = false;
     /* check for proper number of arguments (else crash)*/
     /* checking for presence of a map*/
     if(nrhs == 0) {
         mexErrMsgIdAndTxt("bulatovBandMap:nrhs","A map input required.");
     }
-    /* check number of dimensions of the map*/
-    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
-        mexErrMsgIdAndTxt("bulatovBandMap:mapDims","The map has to have three dimensions.");
-    }
-    dims = mxGetDimensions(prhs[0]);
-    if(dims[2] != 3) {
-        mexErrMsgIdAndTxt("bulatovBandMap:map3rdDimension","The map's third dimension has to be three.");
+    isGridInput = isGrid(prhs[0]);
+    if (isGridInput) {
+        getGrid(prhs[0], &inGrid, gridDims);
+        dims = gridDims;
+        if (nlhs != 1) {
+            mexErrMsgIdAndTxt("bulatovBandMap:nlhs","Returns a new map for a grid.");
+        }
+    } else {
+        /* check number of dimensions of the map*/
+        if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
+            mexErrMsgIdAndTxt("bulatovBandMap:mapDims","The map has to have three dimensions.");
+        }
+        dims = mxGetDimensions(prhs[0]);
+        if(dims[2] != 3) {
+            mexErrMsgIdAndTxt("bulatovBandMap:map3rdDimension","The map's third dimension has to be three.");
+        }
     }
     /* check that no or one output is expected*/
     if (nlhs > 1) {
         mexErrMsgIdAndTxt("bulatovBandMap:nlhs","Has zero or one return parameter.");
     }
     /* get the map*/
+    inMap = NULL;
+    if (!isGridInput) {
 #if MX_HAS_INTERLEAVED_COMPLEX
-    inMap = mxGetSingles(prhs[0]);
+        inMap = mxGetSingles(prhs[0]);
 #else
-    inMap = (float *) mxGetPr(prhs[0]);
+        inMap = (float *) mxGetPr(prhs[0]);
 #endif
+    }
     if (nlhs == 0){
         outMap = inMap;
     } else {
@@ -77,24 +98,39 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nY = dims[0];
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
+    if (isGridInput) {
+        /* all pixels of the grid are valid, parity 0, the columns vectorize*/
+        for (column = 0; column < nX; column++){
+            exp2x = fastExpf(piA2 * gridX(&inGrid, column));
+            for (row = 0; row < nY; row++){
+                index = row + nY * column;
+                fastSincosf(piA2 * gridY(&inGrid, row), &sinY, &cosY);
+                base = iTanPiA4 / (exp2x + 1.0f / exp2x + 2 * cosY);
+                outMap[index] = (exp2x - 1.0f / exp2x) * base;
+                outMap[index + nXnY] = 2 * sinY * base;
+                outMap[index + nXnY2] = 0;
+            }
+        }
+        return;
+    }
+    /* without branches, vectorizes*/
     for (index = 0; index < nXnY; index++){
         inverted = inMap[index + nXnY2];
-        /* do only transform if pixel is valid*/
-        if (inverted < -0.1f) {
-            if (returnsMap){
-                /* set element only if new output map*/
-                outMap[index] = INVALID;
-                outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID; 
-            }
-            continue;
+        x = inMap[index];
+        y = inMap[index + nXnY];
+        exp2x = fastExpf(piA2 * x);
+        fastSincosf(piA2 * y, &sinY, &cosY);
+        base = iTanPiA4 / (exp2x + 1.0f / exp2x + 2 * cosY);
+        /* transform only valid pixels, invalid pixels of a new output map get INVALID*/
+        invalid = (inverted < -0.1f);
+        outMap[index] = invalid ? (returnsMap ? INVALID : x) : (exp2x - 1.0f / exp2x) * base;
+        outMap[index + nXnY] = invalid ? (returnsMap ? INVALID : y) : 2 * sinY * base;
+    }
+    /* the parities change only in a new output map*/
+    if (returnsMap){
+        for (index = 0; index < nXnY; index++){
+            inverted = inMap[index + nXnY2];
+            outMap[index + nXnY2] = (inverted < -0.1f) ? INVALID : inverted;
         }
-        x = piA2 * inMap[index];
-        y = piA2 * inMap[index + nXnY];
-        exp2x = expf(x);
-        base = iTanPiA4 / (exp2x + 1.0f / exp2x + 2 * cosf(y));
-        outMap[index] = (exp2x - 1.0f / exp2x) * base;
-        outMap[index + nXnY] = 2 * sinf(y) * base;
-        outMap[index + nXnY2] = inverted;
     }
 }
\ No newline at end of file
@@ -0,0 +1,379 @@
+/*==========================================================
+ * circlesInversionMap: repeated inversions at many circles,
+ *     for circle packings (Apollonian gaskets) and limit sets of Kleinian groups
+ *
+ * circlesInversionMap(map, circles);
+ * circlesInversionMap(map, circles, maxIterations);
+ *
+ * Input:
+ * first the map.
+ *     It has for each pixel (h,k):
+ *     map(h,k,0) = x, map(h,k,1) = y
+ *     map(h,k,2) = 0, 1 for image pixels, parity, number of inversions % 2
+ *     map(h,k,2) < 0 for invalid pixels, not part of the image
+ *
+ * additional parameter: circles
+ *     double precision array, one row for each circle (nCircles x 3 or nCircles x 4)
+ *     circles(i,:) = [centerX, centerY, radius, insideOut]
+ *     insideOut > 0.5 inverts points inside the circle to the outside (default)
+ *     insideOut <= 0.5 inverts points outside the circle to the inside
+ *     (as in universalInversionMap)
+ *
+ * optional parameter: maxIterations (default 100), a finite number from 0 to INT_MAX
+ *     points that are still mapped after maxIterations are invalid
+ *
+ * repeats inversions until no circle maps the point
+ * the inside out circles are sorted into a uniform grid of cells covering them,
+ * at each step only the circles overlapping the cell of the point are tested,
+ * outside in circles are always tested (they should be few, such as an enclosing circle)
+ *
+ * modifies the map, returns nothing if used as a procedure
+ * circlesInversionMap(map, circles);
+ * does not change the map and returns a modified map if used as  a function
+ * newMap = circlesInversionMap(map, circles);
+ * writes the result into a destination map of the same size, for animations without allocation
+ * circlesInversionMap(map, destination, circles);
+ * the destination is a single array with the rows and columns of the map
+ * the destination is modified in place, it may be the map itself
+ *
+ * the memory for the circles and the grid is kept between calls
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdbool.h>
+#include <limits.h>
+#define PRINTI(n) printf(#n " = %d\n", n)
+#define PRINTF(n) printf(#n " = %f\n", n)
+#define INVALID -1000
+#define MAXGRID 512
+
+typedef struct {
+    float x, y, radius2;
+} circle;
+
+/* scratch memory kept between calls, grows if needed, freed when the mex file is cleared*/
+#define N_SCRATCH 5
+static void *scratch[N_SCRATCH] = {NULL, NULL, NULL, NULL, NULL};
+static size_t scratchSize[N_SCRATCH] = {0, 0, 0, 0, 0};
+static bool hasExitFunction = false;
+
+static void freeScratch(void){
+    int i;
+    for (i = 0; i < N_SCRATCH; i++){
+        if (scratch[i] != NULL){
+            mxFree(scratch[i]);
+        }
+        scratch[i] = NULL;
+        scratchSize[i] = 0;
+    }
+}
+
+/* get scratch memory number i with at least size bytes, its content is undefined*/
+static void *getScratch(int i, size_t size){
+    if (!hasExitFunction){
+        mexAtExit(freeScratch);
+        hasExitFunction = true;
+    }
+    if (scratchSize[i] < size){
+        if (scratch[i] != NULL){
+            mxFree(scratch[i]);
+        }
+        scratch[i] = NULL;
+        scratchSize[i] = 0;
+        scratch[i] = mxMalloc(size);
+        mexMakeMemoryPersistent(scratch[i]);
+        scratchSize[i] = size;
+    }
+    return scratch[i];
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *dims, *cDims;
+    const mxArray *circlesArray;
+    bool hasDestination;
+    int nX, nY, nXnY, nXnY2, index;
+    float inverted, x, y, dx, dy, d2, factor;
+    float *inMap, *outMap;
+    double *circleData;
+    bool returnsMap = false;
+    bool mapped;
+    int nCircles, nInsideOut, nOutsideIn, nColumns, i, j, c;
+    circle *insideOutCircles, *outsideInCircles, *theCircle;
+    float radius, insideOut;
+    int maxIterations, iterations;
+    const mxArray *iterationsArray;
+    double iterationsValue;
+    /* the grid of cells, each cell has a list of circles that overlap it*/
+    float gridXMin, gridYMin, gridXMax, gridYMax, cellSize, iCellSize;
+    int nGrid, nCells, cell, iMin, iMax, jMin, jMax;
+    int *cellStart, *cellCount, *cellCircles;
+    /* check for proper number of arguments (else crash)*/
+    /* checking for presence of a map*/
+    if(nrhs < 2) {
+        mexErrMsgIdAndTxt("circlesInversionMap:nrhs","A map input and an array of circles required.");
+    }
+    /* check number of dimensions of the map*/
+    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
+        mexErrMsgIdAndTxt("circlesInversionMap:mapDims","The map has to have three dimensions.");
+    }
+    dims = mxGetDimensions(prhs[0]);
+    if(dims[2] != 3) {
+        mexErrMsgIdAndTxt("circlesInversionMap:map3rdDimension","The map's third dimension has to be three.");
+    }
+    /* check that no or one output is expected*/
+    if (nlhs > 1) {
+        mexErrMsgIdAndTxt("circlesInversionMap:nlhs","Has zero or one return parameter.");
+    }
+    /* a single array with the rows and columns of the map as second argument is the destination map*/
+    hasDestination = mxIsSingle(prhs[1]) && (mxGetNumberOfDimensions(prhs[1]) >= 3)
+            && (mxGetDimensions(prhs[1])[0] == dims[0]) && (mxGetDimensions(prhs[1])[1] == dims[1]);
+    if (hasDestination){
+        if ((mxGetNumberOfDimensions(prhs[1]) != 3) || (mxGetDimensions(prhs[1])[2] != 3)){
+            mexErrMsgIdAndTxt("circlesInversionMap:destination","The destination has to have the size of the map.");
+        }
+        if (nlhs > 0){
+            mexErrMsgIdAndTxt("circlesInversionMap:nlhs","Returns nothing if there is a destination map.");
+        }
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("circlesInversionMap:nrhs","A map input, a destination and an array of circles required.");
+        }
+        circlesArray = prhs[2];
+    } else {
+        circlesArray = prhs[1];
+    }
+    /* check the circles*/
+    if((mxGetNumberOfDimensions(circlesArray) != 2) || !mxIsDouble(circlesArray)) {
+        mexErrMsgIdAndTxt("circlesInversionMap:circles","The circles have to be a two-dimensional double array.");
+    }
+    cDims = mxGetDimensions(circlesArray);
+    nCircles = cDims[0];
+    nColumns = cDims[1];
+    if((nColumns < 3) || (nColumns > 4)) {
+        mexErrMsgIdAndTxt("circlesInversionMap:circles","Each circle needs centerX, centerY, radius and optional insideOut.");
+    }
+    /* check the limit of the iterations, before making the output*/
+    maxIterations = 100;
+    iterationsArray = NULL;
+    if (hasDestination && (nrhs >= 4)){
+        iterationsArray = prhs[3];
+    } else if (!hasDestination && (nrhs >= 3)){
+        iterationsArray = prhs[2];
+    }
+    if (iterationsArray != NULL){
+        iterationsValue = mxGetScalar(iterationsArray);
+        if (!isfinite(iterationsValue) || (iterationsValue < 0) || (iterationsValue > INT_MAX)) {
+            mexErrMsgIdAndTxt("circlesInversionMap:maxIterations","maxIterations has to be a finite number from 0 to %d.", INT_MAX);
+        }
+        maxIterations = (int) iterationsValue;
+    }
+    /* get the map*/
+#if MX_HAS_INTERLEAVED_COMPLEX
+    inMap = mxGetSingles(prhs[0]);
+    circleData = mxGetDoubles(circlesArray);
+#else
+    inMap = (float *) mxGetPr(prhs[0]);
+    circleData = mxGetPr(circlesArray);
+#endif
+    if (hasDestination){
+        /* write into the destination, if it is the map itself this is the procedure*/
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outMap = mxGetSingles(prhs[1]);
+#else
+        outMap = (float *) mxGetPr(prhs[1]);
+#endif
+        returnsMap = (outMap != inMap);
+    } else if (nlhs == 0){
+        outMap = inMap;
+    } else {
+        /* create output map*/
+        returnsMap = true;
+        plhs[0]=mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outMap = mxGetSingles(plhs[0]);
+#else
+        outMap = (float *) mxGetPr(plhs[0]);
+#endif
+    }
+    /* sort the circles, matlab arrays are column first*/
+    insideOutCircles = (circle *) getScratch(0, (nCircles + 1) * sizeof(circle));
+    outsideInCircles = (circle *) getScratch(1, (nCircles + 1) * sizeof(circle));
+    nInsideOut = 0;
+    nOutsideIn = 0;
+    gridXMin = 1e30f;
+    gridYMin = 1e30f;
+    gridXMax = -1e30f;
+    gridYMax = -1e30f;
+    for (i = 0; i < nCircles; i++){
+        radius = (float) circleData[i + 2 * nCircles];
+        insideOut = 1;
+        if (nColumns == 4){
+            insideOut = (float) circleData[i + 3 * nCircles];
+        }
+        if (insideOut > 0.5f){
+            theCircle = insideOutCircles + nInsideOut;
+            nInsideOut++;
+        } else {
+            theCircle = outsideInCircles + nOutsideIn;
+            nOutsideIn++;
+        }
+        theCircle->x = (float) circleData[i];
+        theCircle->y = (float) circleData[i + nCircles];
+        theCircle->radius2 = radius * radius;
+        if (insideOut > 0.5f){
+            gridXMin = fminf(gridXMin, theCircle->x - radius);
+            gridXMax = fmaxf(gridXMax, theCircle->x + radius);
+            gridYMin = fminf(gridYMin, theCircle->y - radius);
+            gridYMax = fmaxf(gridYMax, theCircle->y + radius);
+        }
+    }
+
+    /* the grid: square cells, about 4 cells per circle*/
+    nGrid = 2 * (int) ceilf(sqrtf((float) nInsideOut));
+    if (nGrid > MAXGRID){
+        nGrid = MAXGRID;
+    }
+    if (nGrid < 1){
+        nGrid = 1;
+    }
+    cellSize = fmaxf(gridXMax - gridXMin, gridYMax - gridYMin) / nGrid;
+    if (!(cellSize > 0)){
+        cellSize = 1;
+    }
+    iCellSize = 1.0f / cellSize;
+    nCells = nGrid * nGrid;
+    /* count the circles overlapping each cell, then fill the lists (cell c uses cellStart[c]...cellStart[c+1]-1)*/
+    cellStart = (int *) getScratch(2, (nCells + 1) * sizeof(int));
+    cellCount = (int *) getScratch(4, nCells * sizeof(int));
+    for (cell = 0; cell < nCells; cell++){
+        cellStart[cell] = 0;
+        cellCount[cell] = 0;
+    }
+    cellStart[nCells] = 0;
+    for (c = 0; c < nInsideOut; c++){
+        theCircle = insideOutCircles + c;
+        radius = sqrtf(theCircle->radius2);
+        iMin = (int) floorf((theCircle->x - radius - gridXMin) * iCellSize);
+        iMax = (int) floorf((theCircle->x + radius - gridXMin) * iCellSize);
+        jMin = (int) floorf((theCircle->y - radius - gridYMin) * iCellSize);
+        jMax = (int) floorf((theCircle->y + radius - gridYMin) * iCellSize);
+        iMin = iMin < 0 ? 0 : iMin;
+        jMin = jMin < 0 ? 0 : jMin;
+        iMax = iMax >= nGrid ? nGrid - 1 : iMax;
+        jMax = jMax >= nGrid ? nGrid - 1 : jMax;
+        for (j = jMin; j <= jMax; j++){
+            for (i = iMin; i <= iMax; i++){
+                cellStart[i + nGrid * j + 1]++;
+            }
+        }
+    }
+    for (cell = 0; cell < nCells; cell++){
+        cellStart[cell + 1] += cellStart[cell];
+    }
+    cellCircles = (int *) getScratch(3, (cellStart[nCells] + 1) * sizeof(int));
+    for (c = 0; c < nInsideOut; c++){
+        theCircle = insideOutCircles + c;
+        radius = sqrtf(theCircle->radius2);
+        iMin = (int) floorf((theCircle->x - radius - gridXMin) * iCellSize);
+        iMax = (int) floorf((theCircle->x + radius - gridXMin) * iCellSize);
+        jMin = (int) floorf((theCircle->y - radius - gridYMin) * iCellSize);
+        jMax = (int) floorf((theCircle->y + radius - gridYMin) * iCellSize);
+        iMin = iMin < 0 ? 0 : iMin;
+        jMin = jMin < 0 ? 0 : jMin;
+        iMax = iMax >= nGrid ? nGrid - 1 : iMax;
+        jMax = jMax >= nGrid ? nGrid - 1 : jMax;
+        for (j = jMin; j <= jMax; j++){
+            for (i = iMin; i <= iMax; i++){
+                cell = i + nGrid * j;
+                cellCircles[cellStart[cell] + cellCount[cell]] = c;
+                cellCount[cell]++;
+            }
+        }
+    }
+    gridXMax = gridXMin + nGrid * cellSize;
+    gridYMax = gridYMin + nGrid * cellSize;
+
+    /* do the map*/
+    /* row first order*/
+    nX = dims[1];
+    nY = dims[0];
+    nXnY = nX * nY;
+    nXnY2 = 2 * nXnY;
+    for (index = 0; index < nXnY; index++){
+        inverted = inMap[index + nXnY2];
+        /* do only transform if pixel is valid*/
+        if (inverted < -0.1f) {
+            if (returnsMap){
+                /* set element only if new output map*/
+                outMap[index] = INVALID;
+                outMap[index + nXnY] = INVALID;
+                outMap[index + nXnY2] = INVALID;
+            }
+            continue;
+        }
+        x = inMap[index];
+        y = inMap[index + nXnY];
+        /* repeat inversions until no circle maps the point*/
+        mapped = true;
+        iterations = 0;
+        while (mapped && (iterations < maxIterations)){
+            mapped = false;
+            /* inside out circles: only candidates of the cell containing the point*/
+            /* points outside the grid cannot lie inside any of these circles*/
+            if ((x >= gridXMin) && (x < gridXMax) && (y >= gridYMin) && (y < gridYMax)){
+                i = (int) ((x - gridXMin) * iCellSize);
+                j = (int) ((y - gridYMin) * iCellSize);
+                i = i >= nGrid ? nGrid - 1 : i;
+                j = j >= nGrid ? nGrid - 1 : j;
+                cell = i + nGrid * j;
+                for (c = cellStart[cell]; c < cellStart[cell + 1]; c++){
+                    theCircle = insideOutCircles + cellCircles[c];
+                    dx = x - theCircle->x;
+                    dy = y - theCircle->y;
+                    d2 = dx * dx + dy * dy;
+                    if (d2 < theCircle->radius2){
+                        /* the center goes to infinity, make it a far away point*/
+                        d2 = fmaxf(d2, 1e-12f);
+                        factor = theCircle->radius2 / d2;
+                        x = theCircle->x + factor * dx;
+                        y = theCircle->y + factor * dy;
+                        inverted = 1 - inverted;
+                        mapped = true;
+                        break;
+                    }
+                }
+            }
+            /* outside in circles*/
+            if (!mapped){
+                for (c = 0; c < nOutsideIn; c++){
+                    theCircle = outsideInCircles + c;
+                    dx = x - theCircle->x;
+                    dy = y - theCircle->y;
+                    d2 = dx * dx + dy * dy;
+                    if (d2 > theCircle->radius2){
+                        factor = theCircle->radius2 / d2;
+                        x = theCircle->x + factor * dx;
+                        y = theCircle->y + factor * dy;
+                        inverted = 1 - inverted;
+                        mapped = true;
+                        break;
+                    }
+                }
+            }
+            iterations++;
+        }
+        /* fail after doing maximum repetitions*/
+        if (mapped){
+            outMap[index] = INVALID;
+            outMap[index + nXnY] = INVALID;
+            outMap[index + nXnY2] = INVALID;
+        } else {
+            outMap[index] = x;
+            outMap[index + nXnY] = y;
+            outMap[index + nXnY2] = inverted;
+        }
+    }
+}
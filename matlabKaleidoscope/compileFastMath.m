@@ -0,0 +1,16 @@
+% compile the c-codes that use fastMath.h
+% first set the working directory to the folder where the c-code is:
+% you need to change the folder path
+cd /home/peter/images/matlabKaleidoscope
+% compile
+% -O3 -fno-trapping-math lets gcc vectorize the loops with the fastMath functions
+mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' createPhaseImage.c
+mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' parametersLogSpiralMap.c
+mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' tanMap.c
+mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' cosMap.c
+mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' bulatovBandMap.c
+% accuracy and speed compared with libm, run
+% >>fastMathTest;
+mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' fastMathTest.c
+% RGB images, with openMP for using all cores
+mex CFLAGS='$CFLAGS -O3 -fno-trapping-math -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' createColorImage.c
@@ -0,0 +1,276 @@
+/*==========================================================
+ * createColorImage: create an RGB image of a map in one pass,
+ * coloring with a palette, no further processing in matlab needed
+ *
+ * image = createColorImage(map, mode);
+ * image = createColorImage(map, mode, palette);
+ * image = createColorImage(map, mode, palette, tiles);
+ *
+ * Input:
+ * first the map.
+ *     It has for each pixel (h,k):
+ *     map(h,k,0) = x, map(h,k,1) = y
+ *     map(h,k,2) = 0, 1 for image pixels, parity, number of inversions % 2
+ *     map(h,k,2) < 0 for invalid pixels, not part of the image
+ *
+ * mode, a string:
+ *     'parity': palette row 1 for parity 0, row 2 for parity 1,
+ *               as createStructureImage
+ *     'phase':  the angle of (x,y) from -pi to pi goes through the palette,
+ *               interpolated smoothly, as createPhaseImage
+ *     'tile':   each tile gets a palette row from its hash,
+ *               tiles is the uint32 array of basicKaleidoscope or fractoscope
+ *     'count':  palette row from tiles(h,k,1) modulo the number of rows,
+ *               the word length of the tiles or any other count,
+ *               tiles may also be a single or double matrix of counts
+ *
+ * palette: matrix of colors, one color per row, with values in [0,1]
+ *     as the colormaps of matlab (gray(256), parula(64), ...)
+ *     or as uint8 in [0,255], default is gray with 2 rows for 'parity'
+ *     and 256 rows for the other modes
+ *
+ * returns the image as an (nY, nX, 3) uint8 array,
+ * invalid pixels are grey (128, 128, 128)
+ *
+ * use imshow(image), no conversion needed
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "fastMath.h"
+#define INVALID_COLOR 128
+#define MAX_PALETTE 65536
+/* entries of the lookup table for smooth phases*/
+#define PHASE_TABLE 1024
+#define IPI2 0.159154943f
+#define PARALLEL_MIN 10000
+
+enum colorMode {PARITY, PHASE, TILE, COUNT};
+
+/* the palette as uint8 table with nColors rows of r, g, b*/
+static uint8_t table[3 * MAX_PALETTE];
+
+static uint8_t toByte(double value)
+{
+    value = 255.0 * value + 0.5;
+    return (uint8_t) ((value < 0) ? 0 : (value > 255) ? 255 : value);
+}
+
+/* read the palette into the table, returns number of rows*/
+static int setTable(const mxArray *palette)
+{
+    const mwSize *dims;
+    int nColors, i, c;
+    double *doubles;
+    uint8_t *bytes;
+    dims = mxGetDimensions(palette);
+    if ((mxGetNumberOfDimensions(palette) != 2) || (dims[1] != 3) || (dims[0] < 1)) {
+        mexErrMsgIdAndTxt("createColorImage:palette","The palette has to be a matrix with rows of 3 color components.");
+    }
+    nColors = dims[0];
+    if (nColors > MAX_PALETTE) {
+        mexErrMsgIdAndTxt("createColorImage:palette","Too many colors, maximum 65536 exceeded.");
+    }
+    if (mxIsDouble(palette)) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        doubles = mxGetDoubles(palette);
+#else
+        doubles = mxGetPr(palette);
+#endif
+        for (i = 0; i < nColors; i++){
+            for (c = 0; c < 3; c++){
+                table[3 * i + c] = toByte(doubles[i + c * nColors]);
+            }
+        }
+    } else if (mxIsUint8(palette)) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        bytes = mxGetUint8s(palette);
+#else
+        bytes = (uint8_t *) mxGetData(palette);
+#endif
+        for (i = 0; i < nColors; i++){
+            for (c = 0; c < 3; c++){
+                table[3 * i + c] = bytes[i + c * nColors];
+            }
+        }
+    } else {
+        mexErrMsgIdAndTxt("createColorImage:palette","The palette has to be double or uint8.");
+    }
+    return nColors;
+}
+
+/* gray scale from black to white*/
+static int setGrayTable(int nColors)
+{
+    int i, c;
+    for (i = 0; i < nColors; i++){
+        for (c = 0; c < 3; c++){
+            table[3 * i + c] = toByte((double) i / (nColors - 1));
+        }
+    }
+    return nColors;
+}
+
+/* smooth phase colors: interpolate the palette linearly into PHASE_TABLE rows*/
+static void interpolateTable(int nColors)
+{
+    static uint8_t palette[3 * MAX_PALETTE];
+    int i, c, low, high;
+    float t;
+    memcpy(palette, table, 3 * nColors);
+    for (i = 0; i < PHASE_TABLE; i++){
+        t = (float) i * (nColors - 1) / (PHASE_TABLE - 1);
+        low = (int) t;
+        high = (low + 1 < nColors) ? low + 1 : low;
+        t -= low;
+        for (c = 0; c < 3; c++){
+            table[3 * i + c] = (uint8_t) ((1 - t) * palette[3 * low + c] + t * palette[3 * high + c] + 0.5f);
+        }
+    }
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *dims, *tileDims;
+    mwSize imageDims[3];
+    int nX, nY, nXnY, nXnY2, index, nColors, color;
+    enum colorMode mode = PARITY;
+    char modeName[16];
+    float inverted, phase;
+    float *map, *counts = NULL;
+    double *doubleCounts = NULL;
+    uint32_t *tiles = NULL;
+    uint8_t *image;
+    /* check for proper number of arguments (else crash)*/
+    if(nrhs < 2) {
+        mexErrMsgIdAndTxt("createColorImage:nrhs","A map input and a mode required.");
+    }
+    /* check number of dimensions of the map*/
+    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
+        mexErrMsgIdAndTxt("createColorImage:mapDims","The map has to have three dimensions.");
+    }
+    dims = mxGetDimensions(prhs[0]);
+    if(dims[2] != 3) {
+        mexErrMsgIdAndTxt("createColorImage:map3rdDimension","The map's third dimension has to be three.");
+    }
+    /* check that output is possible*/
+    if (nlhs != 1) {
+        mexErrMsgIdAndTxt("createColorImage:nlhs","One output array for the image required.");
+    }
+    if (!mxIsChar(prhs[1]) || (mxGetString(prhs[1], modeName, sizeof(modeName)) != 0)) {
+        mexErrMsgIdAndTxt("createColorImage:mode","The mode has to be 'parity', 'phase', 'tile' or 'count'.");
+    }
+    if (strcmp(modeName, "parity") == 0) {
+        mode = PARITY;
+    } else if (strcmp(modeName, "phase") == 0) {
+        mode = PHASE;
+    } else if (strcmp(modeName, "tile") == 0) {
+        mode = TILE;
+    } else if (strcmp(modeName, "count") == 0) {
+        mode = COUNT;
+    } else {
+        mexErrMsgIdAndTxt("createColorImage:mode","The mode has to be 'parity', 'phase', 'tile' or 'count'.");
+    }
+    /* the palette*/
+    if ((nrhs > 2) && !mxIsEmpty(prhs[2])) {
+        nColors = setTable(prhs[2]);
+    } else {
+        nColors = setGrayTable((mode == PARITY) ? 2 : 256);
+    }
+    if (mode == PHASE) {
+        interpolateTable(nColors);
+    }
+    /* the tiles or counts*/
+    if ((mode == TILE) || (mode == COUNT)) {
+        if (nrhs < 4) {
+            mexErrMsgIdAndTxt("createColorImage:nrhs","The tiles are required for modes 'tile' and 'count'.");
+        }
+        tileDims = mxGetDimensions(prhs[3]);
+        if ((tileDims[0] != dims[0]) || (tileDims[1] != dims[1])) {
+            mexErrMsgIdAndTxt("createColorImage:tiles","The tiles have to be of the same size as the map.");
+        }
+        if (mxIsUint32(prhs[3])) {
+            if ((mode == TILE) && ((mxGetNumberOfDimensions(prhs[3]) < 3) || (tileDims[2] < 2))) {
+                mexErrMsgIdAndTxt("createColorImage:tiles","The tiles need lengths and hashes, size (nY, nX, 2).");
+            }
+#if MX_HAS_INTERLEAVED_COMPLEX
+            tiles = mxGetUint32s(prhs[3]);
+#else
+            tiles = (uint32_t *) mxGetData(prhs[3]);
+#endif
+        } else if ((mode == COUNT) && mxIsSingle(prhs[3])) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+            counts = mxGetSingles(prhs[3]);
+#else
+            counts = (float *) mxGetData(prhs[3]);
+#endif
+        } else if ((mode == COUNT) && mxIsDouble(prhs[3])) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+            doubleCounts = mxGetDoubles(prhs[3]);
+#else
+            doubleCounts = mxGetPr(prhs[3]);
+#endif
+        } else {
+            mexErrMsgIdAndTxt("createColorImage:tiles","The tiles have to be uint32, counts may also be single or double.");
+        }
+    }
+    imageDims[0] = dims[0];
+    imageDims[1] = dims[1];
+    imageDims[2] = 3;
+    plhs[0]=mxCreateNumericArray(3, imageDims, mxUINT8_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+    map = mxGetSingles(prhs[0]);
+    image = mxGetUint8s(plhs[0]);
+#else
+    map = (float *) mxGetPr(prhs[0]);
+    image = (uint8_t *) mxGetData(plhs[0]);
+#endif
+    /* do the image*/
+    /* row first order*/
+    nX = dims[1];
+    nY = dims[0];
+    nXnY = nX * nY;
+    nXnY2 = 2 * nXnY;
+#pragma omp parallel for private(inverted, phase, color) if (nXnY > PARALLEL_MIN)
+    for (index = 0; index < nXnY; index++){
+        inverted = map[index + nXnY2];
+        if (inverted < 0) {
+            image[index] = INVALID_COLOR;
+            image[index + nXnY] = INVALID_COLOR;
+            image[index + nXnY2] = INVALID_COLOR;
+            continue;
+        }
+        switch (mode) {
+            case PARITY:
+                color = (inverted > 0.5f) ? 1 : 0;
+                color = (color < nColors) ? color : nColors - 1;
+                break;
+            case PHASE:
+                phase = 0.5f + IPI2 * fastAtan2f(map[index + nXnY], map[index]);
+                color = (int) (phase * (PHASE_TABLE - 1) + 0.5f);
+                color = (color < 0) ? 0 : (color >= PHASE_TABLE) ? PHASE_TABLE - 1 : color;
+                break;
+            case TILE:
+                color = tiles[index + nXnY] % nColors;
+                break;
+            default:
+                if (tiles != NULL) {
+                    color = tiles[index] % nColors;
+                } else if (counts != NULL) {
+                    color = ((int) counts[index]) % nColors;
+                } else {
+                    color = ((int) doubleCounts[index]) % nColors;
+                }
+                color = (color < 0) ? color + nColors : color;
+                break;
+        }
+        image[index] = table[3 * color];
+        image[index + nXnY] = table[3 * color + 1];
+        image[index + nXnY2] = table[3 * color + 2];
+    }
+}
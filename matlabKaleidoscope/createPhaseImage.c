@@ -22,16 +22,17 @@
 
 #include "mex.h"
 #include <math.h>
+#include "fastMath.h"
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
-#define IPI2 0.15915
+#define IPI2 0.15915f
 
 void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     const mwSize *dims;
     int nX, nY, nXnY, nXnY2, index;
-    float inverted;
+    float inverted, phase;
     float *image, *map;
     /* check for proper number of arguments (else crash)*/
     if(nrhs != 1) {
@@ -65,11 +66,8 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nXnY2 = 2 * nXnY;
     for (index = 0; index < nXnY; index++){
         inverted = map[index + nXnY2];
-        if (inverted < 0) {
-            inverted=0.5f;
-        } else {
-            inverted = 0.5 + IPI2 * atan2f(map[index + nXnY], map[index]);
-        }
-        image[index] = inverted;
+        /* without branches, vectorizes*/
+        phase = 0.5f + IPI2 * fastAtan2f(map[index + nXnY], map[index]);
+        image[index] = (inverted < 0) ? 0.5f : phase;
     }
 }
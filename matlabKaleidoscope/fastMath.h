@@ -0,0 +1,221 @@
+/*==========================================================
+ * fastMath.h: fast float functions for the map kernels
+ *
+ * replacements for the libm functions used in the pixel loops,
+ * inline and without branches (selects only), so that the compiler
+ * can vectorize the loops of the kernels, compile with
+ * mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' kernel.c
+ * (without -fno-trapping-math gcc does not vectorize the selects)
+ *
+ * maximum errors measured against double precision with fastMathTest:
+ *
+ * fastAtan2f(y, x)     all finite x, y                    4 ULP
+ * fastLogf(x)          positive normal x                  1 ULP
+ *                      x = 0 gives about -88 instead of -inf
+ * fastExpf(x)          -87 < x < 88                       1 ULP
+ *                      clamped outside, no inf or 0
+ * fastSincosf(x, &s, &c), fastSinf(x), fastCosf(x)
+ *                      |x| < pi/4                         1 ULP
+ *                      |x| < 2048                         1e-7 absolute
+ * fastTanhf(x)         all finite x                       2 ULP
+ *
+ * complex functions, error relative to the modulus of the result,
+ * absolute error if the modulus is less than 1:
+ * fastCexpf(z)                                            2e-7
+ * fastClogf(z)         1e-19 < |z| < 1e19                 2e-7
+ * fastCcosf(z), fastCtanf(z)  |re z| < 2048               4e-7
+ *
+ * outside of these ranges the results are wrong, there are no checks,
+ * cosMap and tanMap use libm instead for maps with |x| >= FAST_TRIG_LIMIT
+ *
+ *========================================================*/
+
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <math.h>
+#include <complex.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FAST_PI 3.14159265358979f
+#define FAST_PI2 1.57079632679490f
+#define FAST_PI4 0.785398163397448f
+#define FAST_LN2_HI 6.9313812256e-01f
+#define FAST_LN2_LO 9.0580006145e-06f
+#define FAST_LOG2E 1.44269504089f
+/* adding and subtracting this rounds to the nearest integer*/
+#define FAST_ROUND 12582912.0f
+/* the limit of the arguments of fastSincosf, fastCcosf and fastCtanf*/
+#define FAST_TRIG_LIMIT 2048.0f
+
+static inline uint32_t fastFloatBits(float x)
+{
+    uint32_t i;
+    memcpy(&i, &x, sizeof(i));
+    return i;
+}
+
+static inline float fastBitsFloat(uint32_t i)
+{
+    float x;
+    memcpy(&x, &i, sizeof(x));
+    return x;
+}
+
+/* arctangent of a in [0, 1]*/
+static inline float fastAtanUnit(float a)
+{
+    float z, r, offset;
+    /* reduce to [-tan(pi/8), tan(pi/8)]*/
+    offset = (a > 0.414213562f) ? FAST_PI4 : 0.0f;
+    a = (a > 0.414213562f) ? (a - 1.0f) / (a + 1.0f) : a;
+    z = a * a;
+    r = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z
+            - 3.33329491539e-1f) * z * a + a;
+    return offset + r;
+}
+
+static inline float fastAtan2f(float y, float x)
+{
+    float ax, ay, mini, maxi, r;
+    ax = fabsf(x);
+    ay = fabsf(y);
+    mini = (ax < ay) ? ax : ay;
+    maxi = (ax < ay) ? ay : ax;
+    r = fastAtanUnit((maxi > 0.0f) ? mini / maxi : 0.0f);
+    r = (ay > ax) ? FAST_PI2 - r : r;
+    r = (x < 0.0f) ? FAST_PI - r : r;
+    return copysignf(r, y);
+}
+
+static inline float fastLogf(float x)
+{
+    uint32_t i;
+    int k;
+    float f, s, z, w, r, hfsq, dk;
+    /* x = 2^k * m, with m in [sqrt(1/2), sqrt(2)]*/
+    i = fastFloatBits(x) + (0x3f800000 - 0x3f3504f3);
+    k = (int) (i >> 23) - 0x7f;
+    x = fastBitsFloat((i & 0x007fffff) + 0x3f3504f3);
+    f = x - 1.0f;
+    s = f / (2.0f + f);
+    z = s * s;
+    w = z * z;
+    r = z * (0.66666662693f + w * 0.28498786688f) + w * (0.40000972152f + w * 0.24279078841f);
+    hfsq = 0.5f * f * f;
+    dk = (float) k;
+    return s * (hfsq + r) + dk * FAST_LN2_LO - hfsq + f + dk * FAST_LN2_HI;
+}
+
+static inline float fastExpf(float x)
+{
+    float n, r, p;
+    x = (x < -87.0f) ? -87.0f : x;
+    x = (x > 88.0f) ? 88.0f : x;
+    /* x = n * ln2 + r, with |r| < ln2 / 2*/
+    n = (x * FAST_LOG2E + FAST_ROUND) - FAST_ROUND;
+    r = x - n * 0.693145751953125f - n * 1.428606765330187e-6f;
+    p = ((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r
+            + 4.1665795894e-2f) * r + 1.6666665459e-1f) * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+    return p * fastBitsFloat((uint32_t) ((int) n + 127) << 23);
+}
+
+static inline void fastSincosf(float x, float *sinX, float *cosX)
+{
+    float j, r, z, s, c;
+    int quadrant;
+    /* x = j * pi / 2 + r, with |r| < pi / 4*/
+    j = (x * 0.636619772f + FAST_ROUND) - FAST_ROUND;
+    r = x - j * 1.5703125f - j * 4.837512969970703125e-4f - j * 7.54978995489188216e-8f;
+    quadrant = (int) j & 3;
+    z = r * r;
+    s = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    c = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z
+            - 0.5f * z + 1.0f;
+    *sinX = (quadrant & 1) ? c : s;
+    *cosX = (quadrant & 1) ? s : c;
+    *sinX = (quadrant & 2) ? -*sinX : *sinX;
+    *cosX = ((quadrant + 1) & 2) ? -*cosX : *cosX;
+}
+
+static inline float fastSinf(float x)
+{
+    float s, c;
+    fastSincosf(x, &s, &c);
+    return s;
+}
+
+static inline float fastCosf(float x)
+{
+    float s, c;
+    fastSincosf(x, &s, &c);
+    return c;
+}
+
+static inline float fastTanhf(float x)
+{
+    float ax, z, small, e, large;
+    ax = fabsf(x);
+    z = x * x;
+    small = ((((-5.70498872745e-3f * z + 2.06390887954e-2f) * z - 5.37397155531e-2f) * z
+            + 1.33314422036e-1f) * z - 3.33332819422e-1f) * z * x + x;
+    e = fastExpf(2.0f * ax);
+    large = copysignf(1.0f - 2.0f / (e + 1.0f), x);
+    return (ax < 0.625f) ? small : large;
+}
+
+static inline float complex fastCexpf(float complex z)
+{
+    float e, s, c;
+    e = fastExpf(crealf(z));
+    fastSincosf(cimagf(z), &s, &c);
+    return e * c + I * (e * s);
+}
+
+static inline float complex fastClogf(float complex z)
+{
+    float x, y;
+    x = crealf(z);
+    y = cimagf(z);
+    return 0.5f * fastLogf(x * x + y * y) + I * fastAtan2f(y, x);
+}
+
+/* sinh and cosh, series for small y keeps sinh accurate near 0*/
+static inline void fastSinhCoshf(float y, float *sinhY, float *coshY)
+{
+    float e, iE, z, small;
+    e = fastExpf(y);
+    iE = 1.0f / e;
+    z = y * y;
+    small = ((z * 1.98412698e-4f + 8.33333333e-3f) * z + 1.66666667e-1f) * z * y + y;
+    *sinhY = (fabsf(y) < 0.5f) ? small : 0.5f * (e - iE);
+    *coshY = 0.5f * (e + iE);
+}
+
+/* cos(x + i y) = cos x cosh y - i sin x sinh y*/
+static inline float complex fastCcosf(float complex z)
+{
+    float s, c, sh, ch;
+    fastSincosf(crealf(z), &s, &c);
+    fastSinhCoshf(cimagf(z), &sh, &ch);
+    return c * ch - I * (s * sh);
+}
+
+/* tan(x + i y) = (sin x cos x + i sinh y cosh y) / (cos x cos x + sinh y sinh y)
+ * without cancellation near the poles*/
+static inline float complex fastCtanf(float complex z)
+{
+    float s, c, y, sh, ch, iDen;
+    fastSincosf(crealf(z), &s, &c);
+    /* tanh saturates, avoids inf / inf*/
+    y = cimagf(z);
+    y = (y < -20.0f) ? -20.0f : y;
+    y = (y > 20.0f) ? 20.0f : y;
+    fastSinhCoshf(y, &sh, &ch);
+    iDen = 1.0f / (c * c + sh * sh);
+    return s * c * iDen + I * (sh * ch * iDen);
+}
+
+#endif
@@ -0,0 +1,271 @@
+/*==========================================================
+ * fastMathTest: accuracy and speed of the functions in fastMath.h
+ * compared with libm
+ *
+ * fastMathTest;
+ * fastMathTest(n);
+ * results = fastMathTest(n);
+ *
+ * Input:
+ * optional number of sample points per function (default 1000000)
+ *
+ * prints for each function the maximum error with respect to double
+ * precision (as documented in fastMath.h: in ULP, for sin and cos
+ * absolute, for complex functions relative to the modulus of the result),
+ * and the time per call for libm and fastMath
+ *
+ * compile with the same flags as the kernels:
+ * mex CFLAGS='$CFLAGS -O3 -fno-trapping-math' fastMathTest.c
+ *
+ * returns a matrix with one row per function:
+ * [maximum error, libm time, fastMath time] (times in ns per call)
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <complex.h>
+#include <time.h>
+#include <float.h>
+#include <stdbool.h>
+#include "fastMath.h"
+#define N_FUNCTIONS 11
+#define DEFAULT_SAMPLES 1000000
+
+static const char *names[N_FUNCTIONS] = {"atan2", "log", "exp", "sin", "cos", "tanh",
+        "cexp", "clog", "ccos", "ctan", "atan2 phase"};
+
+/* error of a float result in units of the last place of the exact result*/
+static double ulpError(float result, double exact)
+{
+    float exactFloat, ulp;
+    exactFloat = fabsf((float) exact);
+    if (exactFloat < FLT_MIN) {
+        exactFloat = FLT_MIN;
+    }
+    ulp = nextafterf(exactFloat, INFINITY) - exactFloat;
+    return fabs(result - exact) / ulp;
+}
+
+static double complexError(float complex result, double complex exact)
+{
+    return cabs((double complex) result - exact) / fmax(cabs(exact), 1.0);
+}
+
+static double seconds(void)
+{
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+/* sample points in the ranges of the functions*/
+static void setArguments(int function, float *x, float *y, int n)
+{
+    int i;
+    float t;
+    for (i = 0; i < n; i++){
+        t = (float) i / (float) (n - 1);
+        /* spiral covering all directions and radii over many octaves*/
+        switch (function) {
+            case 0:
+            case 7:
+            case 10:
+                x[i] = expf(40.0f * t - 20.0f) * cosf(6283.0f * t);
+                y[i] = expf(40.0f * t - 20.0f) * sinf(6283.0f * t);
+                break;
+            case 1:
+                x[i] = expf(170.0f * t - 85.0f);
+                y[i] = 0;
+                break;
+            case 2:
+                x[i] = 174.0f * t - 86.9f;
+                y[i] = 0;
+                break;
+            case 3:
+            case 4:
+                x[i] = 4096.0f * t - 2048.0f;
+                y[i] = 0;
+                break;
+            case 5:
+                x[i] = 20.0f * t - 10.0f;
+                y[i] = 0;
+                break;
+            default:
+                x[i] = 100.0f * t - 50.0f;
+                y[i] = 20.0f * cosf(3163.0f * t);
+                break;
+        }
+    }
+}
+
+static double maximumError(int function, const float *x, const float *y, int n)
+{
+    int i;
+    double error, maxi;
+    double complex z;
+    maxi = 0;
+    for (i = 0; i < n; i++){
+        z = x[i] + I * y[i];
+        switch (function) {
+            case 0:
+                error = ulpError(fastAtan2f(y[i], x[i]), atan2(y[i], x[i]));
+                break;
+            case 1:
+                error = ulpError(fastLogf(x[i]), log(x[i]));
+                break;
+            case 2:
+                error = ulpError(fastExpf(x[i]), exp(x[i]));
+                break;
+            /* absolute error, the ULP error grows near the zeros*/
+            case 3:
+                error = fabs(fastSinf(x[i]) - sin(x[i]));
+                break;
+            case 4:
+                error = fabs(fastCosf(x[i]) - cos(x[i]));
+                break;
+            case 5:
+                error = ulpError(fastTanhf(x[i]), tanh(x[i]));
+                break;
+            case 6:
+                error = complexError(fastCexpf(x[i] + I * y[i]), cexp(z));
+                break;
+            case 7:
+                error = complexError(fastClogf(x[i] + I * y[i]), clog(z));
+                break;
+            case 8:
+                error = complexError(fastCcosf(x[i] + I * y[i]), ccos(z));
+                break;
+            case 9:
+                error = complexError(fastCtanf(x[i] + I * y[i]), ctan(z));
+                break;
+            default:
+                /* absolute error of the phase as used in createPhaseImage*/
+                error = fabs(fastAtan2f(y[i], x[i]) - atan2(y[i], x[i]));
+                break;
+        }
+        if (error > maxi) {
+            maxi = error;
+        }
+    }
+    return maxi;
+}
+
+/* time per call in ns, the loops have the same form as in the kernels*/
+static double timeCalls(int function, bool fast, const float *x, const float *y,
+        float *u, float *v, int n)
+{
+    int i;
+    float complex z;
+    double start;
+    start = seconds();
+    if (fast) {
+        switch (function) {
+            case 0:
+            case 10:
+                for (i = 0; i < n; i++) u[i] = fastAtan2f(y[i], x[i]);
+                break;
+            case 1:
+                for (i = 0; i < n; i++) u[i] = fastLogf(x[i]);
+                break;
+            case 2:
+                for (i = 0; i < n; i++) u[i] = fastExpf(x[i]);
+                break;
+            case 3:
+                for (i = 0; i < n; i++) u[i] = fastSinf(x[i]);
+                break;
+            case 4:
+                for (i = 0; i < n; i++) u[i] = fastCosf(x[i]);
+                break;
+            case 5:
+                for (i = 0; i < n; i++) u[i] = fastTanhf(x[i]);
+                break;
+            default:
+                for (i = 0; i < n; i++){
+                    z = x[i] + I * y[i];
+                    z = (function == 6) ? fastCexpf(z) : (function == 7) ? fastClogf(z)
+                            : (function == 8) ? fastCcosf(z) : fastCtanf(z);
+                    u[i] = crealf(z);
+                    v[i] = cimagf(z);
+                }
+                break;
+        }
+    } else {
+        switch (function) {
+            case 0:
+            case 10:
+                for (i = 0; i < n; i++) u[i] = atan2f(y[i], x[i]);
+                break;
+            case 1:
+                for (i = 0; i < n; i++) u[i] = logf(x[i]);
+                break;
+            case 2:
+                for (i = 0; i < n; i++) u[i] = expf(x[i]);
+                break;
+            case 3:
+                for (i = 0; i < n; i++) u[i] = sinf(x[i]);
+                break;
+            case 4:
+                for (i = 0; i < n; i++) u[i] = cosf(x[i]);
+                break;
+            case 5:
+                for (i = 0; i < n; i++) u[i] = tanhf(x[i]);
+                break;
+            default:
+                for (i = 0; i < n; i++){
+                    z = x[i] + I * y[i];
+                    z = (function == 6) ? cexpf(z) : (function == 7) ? clogf(z)
+                            : (function == 8) ? ccosf(z) : ctanf(z);
+                    u[i] = crealf(z);
+                    v[i] = cimagf(z);
+                }
+                break;
+        }
+    }
+    return 1e9 * (seconds() - start) / n;
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    int n, function;
+    float *x, *y, *u, *v;
+    double *results;
+    double error, libmTime, fastTime;
+    /* check that no or one output is expected*/
+    if (nlhs > 1) {
+        mexErrMsgIdAndTxt("fastMathTest:nlhs","Has zero or one return parameter.");
+    }
+    if (nrhs > 0) {
+        n = (int) mxGetScalar(prhs[0]);
+    } else {
+        n = DEFAULT_SAMPLES;
+    }
+    if (n < 2) {
+        mexErrMsgIdAndTxt("fastMathTest:n","At least two sample points required.");
+    }
+    plhs[0] = mxCreateDoubleMatrix(N_FUNCTIONS, 3, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+    results = mxGetDoubles(plhs[0]);
+#else
+    results = mxGetPr(plhs[0]);
+#endif
+    x = (float *) mxMalloc(n * sizeof(float));
+    y = (float *) mxMalloc(n * sizeof(float));
+    u = (float *) mxMalloc(n * sizeof(float));
+    v = (float *) mxMalloc(n * sizeof(float));
+    mexPrintf("%-12s %14s %12s %12s %8s\n", "function", "max error", "libm ns", "fast ns", "speedup");
+    for (function = 0; function < N_FUNCTIONS; function++){
+        setArguments(function, x, y, n);
+        error = maximumError(function, x, y, n);
+        libmTime = timeCalls(function, false, x, y, u, v, n);
+        fastTime = timeCalls(function, true, x, y, u, v, n);
+        mexPrintf("%-12s %14.3g %12.2f %12.2f %8.2f\n", names[function], error,
+                libmTime, fastTime, libmTime / fmax(fastTime, 1e-3));
+        results[function] = error;
+        results[function + N_FUNCTIONS] = libmTime;
+        results[function + 2 * N_FUNCTIONS] = fastTime;
+    }
+    mxFree(x);
+    mxFree(y);
+    mxFree(u);
+    mxFree(v);
+}
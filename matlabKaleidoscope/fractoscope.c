@@ -25,16 +25,53 @@
  * returns a modified map and does not change the map argument if used as a function:
  *  newMap = fractoscope(map, k, inside, outside);
  *
+ * returns additionally the tiles as a uint32 array of size (nY, nX, 2):
+ *  [newMap, tiles] = fractoscope(map, k, inside, outside);
+ *     tiles(h,k,1) = length of the word of reflections and inversions that maps the pixel
+ *                    (number of mirror lines and circles crossed, the dihedral steps are reduced)
+ *     tiles(h,k,2) = hash of the word, the same for all pixels of a tile and for each call
+ *     invalid pixels have length 0 and hash 0
+ *
  *========================================================*/
 
 #include "mex.h"
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #define PI 3.14159f
 #define INVALID -10000
+#define HASH_START 2166136261u
+#define HASH_PRIME 16777619u
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 
+/* the word of reflections of a pixel, its length and FNV-1a hash*/
+typedef struct {
+    uint32_t length, hash;
+} tileWord;
+
+static void setEmptyWord(tileWord *w){
+    w->length = 0;
+    w->hash = HASH_START;
+}
+
+/* append an element of the dihedral group: rotation by j sectors and mirroring at the x-axis if flip*/
+/* t = 2j - flip is the number of mirror lines crossed (with sign), zero for the identity*/
+static void appendDihedral(tileWord *w, int j, bool flip){
+    int t = 2 * j - (flip ? 1: 0);
+    if (t != 0){
+        w->length += abs(t);
+        w->hash = (w->hash ^ (uint32_t) (t + 128)) * HASH_PRIME;
+    }
+}
+
+/* append the inversion at the first (circle=0) or second (circle=1) circle*/
+static void appendInversion(tileWord *w, int circle){
+    w->length += 1;
+    w->hash = (w->hash ^ (uint32_t) circle) * HASH_PRIME;
+}
+
 void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
@@ -43,6 +80,8 @@ void mexFunction( int nlhs, mxArray *plhs[],
     int nX, nY, nXnY, nXnY2, nXnY3, index, i;
     float inverted, x, y;
     float *inMap, *outMap;
+    uint32_t *tiles;
+    tileWord word;
     bool returnsMap, success;
     int k, k2;
     int inside, outside;
@@ -68,9 +107,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
     if(dims[2] != 3) {
         mexErrMsgIdAndTxt("fractoscope:map3rdDimension","The map's third dimension has to be three.");
     }
-    /* check that no or one output is expected*/
-    if (nlhs > 1) {
-        mexErrMsgIdAndTxt("fractoscope:nlhs","Has zero or one return parameter.");
+    /* check that no, one or two outputs are expected*/
+    if (nlhs > 2) {
+        mexErrMsgIdAndTxt("fractoscope:nlhs","Has zero, one or two return parameters.");
     }
     /* get the map*/
 #if MX_HAS_INTERLEAVED_COMPLEX
@@ -89,6 +128,17 @@ void mexFunction( int nlhs, mxArray *plhs[],
         outMap = mxGetSingles(plhs[0]);
 #else
         outMap = (float *) mxGetPr(plhs[0]);
+#endif
+    }
+    /* create the tiles, initialized to zero (invalid)*/
+    tiles = NULL;
+    if (nlhs == 2){
+        mwSize tileDims[3] = {dims[0], dims[1], 2};
+        plhs[1] = mxCreateNumericArray(3, tileDims, mxUINT32_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        tiles = mxGetUint32s(plhs[1]);
+#else
+        tiles = (uint32_t *) mxGetData(plhs[1]);
 #endif
     }
     /* get geometry parameters*/
@@ -118,6 +168,14 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 outMap[index] = inMap[index];
             }
         }
+        if (tiles != NULL){
+            nXnY = dims[0] * dims[1];
+            for (index = 0; index < nXnY; index++){
+                if (inMap[index + 2 * nXnY] > -0.1f){
+                    tiles[index + nXnY] = HASH_START;
+                }
+            }
+        }
         return;
     }
     
@@ -173,6 +231,10 @@ void mexFunction( int nlhs, mxArray *plhs[],
         h = cosine * x + sine * y;
         y = -sine * x + cosine * y;
         x = h;
+        if (tiles != NULL){
+            setEmptyWord(&word);
+            appendDihedral(&word, rotation - k, y < 0);
+        }
         if (y < 0){
             y = -y;
             inverted = 1 - inverted;
@@ -191,6 +253,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 y = factor * y;
                 inverted = 1 - inverted;
                 success = false;
+                if (tiles != NULL){
+                    appendInversion(&word, 0);
+                }
             }
             if (!success){
             /* dihedral symmetry*/
@@ -202,6 +267,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                     h = cosine * x + sine * y;
                     y = -sine * x + cosine * y;
                     x = h;
+                    if (tiles != NULL){
+                        appendDihedral(&word, rotation - k, y < 0);
+                    }
                     if (y < 0){
                         y = -y;
                         inverted = 1 - inverted;
@@ -212,6 +280,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                         /* mirror symmetry at the x-axis, not finished*/
                         y = -y;
                         inverted = 1 - inverted;
+                        if (tiles != NULL){
+                            appendDihedral(&word, 0, true);
+                        }
                     } 
                 }
             }
@@ -226,6 +297,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 y = y2 + factor * dy;
                 inverted = 1 - inverted;
                 success = false;
+                if (tiles != NULL){
+                    appendInversion(&word, 1);
+                }
             }
             
             if (!success){
@@ -238,6 +312,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                     h = cosine * x + sine * y;
                     y = -sine * x + cosine * y;
                     x = h;
+                    if (tiles != NULL){
+                        appendDihedral(&word, rotation - k, y < 0);
+                    }
                     if (y < 0){
                         y = -y;
                         inverted = 1 - inverted;
@@ -248,6 +325,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                         /* mirror symmetry at the x-axis, not finished*/
                         y = -y;
                         inverted = 1 - inverted;
+                        if (tiles != NULL){
+                            appendDihedral(&word, 0, true);
+                        }
                     } 
                 }
             }
@@ -275,6 +355,10 @@ void mexFunction( int nlhs, mxArray *plhs[],
             outMap[index] = x;
             outMap[index + nXnY] = y;
             outMap[index + nXnY2] = inverted;
+            if (tiles != NULL){
+                tiles[index] = word.length;
+                tiles[index + nXnY] = word.hash;
+            }
         } else {
             outMap[index] = INVALID;
             outMap[index + nXnY] = INVALID;
@@ -25,6 +25,12 @@
  * does not change the map and returns a modified map if used as  a function
  * newMap = transform(map, ....);
  *
+ * a map with 7 layers carries its jacobian (see jacobian.h),
+ * multiplied by the derivative factor * (1 - 2 * power * (x,y)^T (x,y) / (x*x+y*y))
+ *
+ * instead of an identity map takes a grid (see gridMap.h), returns a new map
+ * newMap = inversionMap(identityGrid(mPixels, xMin, xMax), limit);
+ *
  *========================================================*/
 
 #include "mex.h"
@@ -32,6 +38,8 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include "jacobian.h"
+#include "gridMap.h"
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1000
@@ -40,34 +48,51 @@ void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     const mwSize *dims;
-    int nX, nY, nXnY, nXnY2, index;
+    mwSize gridDims[3];
+    grid inGrid;
+    bool isGridInput;
+    int nX, nY, nXnY, nXnY2, index, column, row;
     float inverted;
     float *inMap, *outMap;
-    float r, phi, limit, limit2, power, r2, factor, x, y;
+    float r, phi, limit, limit2, power, r2, factor, x, y, g;
     bool returnsMap = false;
+    bool jacobian;
     /* check for proper number of arguments (else crash)*/
     /* checking for presence of a map*/
     if(nrhs < 2) {
         mexErrMsgIdAndTxt("rescaleMap:nrhs","A map input and (scalar) limit required.");
     }
-    /* check number of dimensions of the map*/
-    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
-        mexErrMsgIdAndTxt("rescaleMap:mapDims","The map has to have three dimensions.");
-    }
-    dims = mxGetDimensions(prhs[0]);
-    if(dims[2] != 3) {
-        mexErrMsgIdAndTxt("rescaleMap:map3rdDimension","The map's third dimension has to be three.");
+    isGridInput = isGrid(prhs[0]);
+    if (isGridInput) {
+        getGrid(prhs[0], &inGrid, gridDims);
+        dims = gridDims;
+        if (nlhs != 1) {
+            mexErrMsgIdAndTxt("rescaleMap:nlhs","Returns a new map for a grid.");
+        }
+    } else {
+        /* check number of dimensions of the map*/
+        if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
+            mexErrMsgIdAndTxt("rescaleMap:mapDims","The map has to have three dimensions.");
+        }
+        dims = mxGetDimensions(prhs[0]);
+        if(!isMapLayers(dims[2])) {
+            mexErrMsgIdAndTxt("rescaleMap:map3rdDimension","The map's third dimension has to be three (or seven with jacobian).");
+        }
     }
+    jacobian = (dims[2] == JACOBIAN_LAYERS);
     /* check that no or one output is expected*/
     if (nlhs > 1) {
         mexErrMsgIdAndTxt("rescaleMap:nlhs","Has zero or one return parameter.");
     }
     /* get the map*/
+    inMap = NULL;
+    if (!isGridInput) {
 #if MX_HAS_INTERLEAVED_COMPLEX
-    inMap = mxGetSingles(prhs[0]);
+        inMap = mxGetSingles(prhs[0]);
 #else
-    inMap = (float *) mxGetPr(prhs[0]);
+        inMap = (float *) mxGetPr(prhs[0]);
 #endif
+    }
     if (nlhs == 0){
         outMap = inMap;
     } else {
@@ -92,7 +117,29 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nY = dims[0];
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
-    
+
+    if (isGridInput) {
+        /* all pixels of the grid are valid, parity 0*/
+        for (column = 0; column < nX; column++){
+            for (row = 0; row < nY; row++){
+                index = row + nY * column;
+                x = gridX(&inGrid, column);
+                y = gridY(&inGrid, row);
+                r2 = x * x + y * y;
+                inverted = 0;
+                if (r2 > limit2) {
+                    factor = (fabsf(power - 1) < 0.001) ? limit2 / r2 : powf(limit2 / r2, power);
+                    x *= factor;
+                    y *= factor;
+                    inverted = 1;
+                }
+                outMap[index] = x;
+                outMap[index + nXnY] = y;
+                outMap[index + nXnY2] = inverted;
+            }
+        }
+        return;
+    }
     /* check for the power argumment */
     if (fabsf(power - 1) < 0.001){
         /* fast calculation without power (default) */
@@ -105,6 +152,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                     outMap[index] = INVALID;
                     outMap[index + nXnY] = INVALID;
                     outMap[index + nXnY2] = INVALID;      
+                    if (jacobian){
+                        jacobianInvalid(outMap, index, nXnY);
+                    }
                 }
                 continue;
             }
@@ -114,10 +164,17 @@ void mexFunction( int nlhs, mxArray *plhs[],
 
             if (r2 > limit2) {
                factor = limit2 / r2;
+               if (jacobian){
+                   g = 2 * factor / r2;
+                   jacobianLinear(inMap, outMap, index, nXnY, factor - g * x * x, - g * x * y,
+                                  - g * x * y, factor - g * y * y);
+               }
                x *= factor;
                y *= factor;
                inverted= 1 - inverted;
-            }        
+            } else if (jacobian && returnsMap){
+               jacobianCopy(inMap, outMap, index, nXnY);
+            }
             outMap[index] = x;
             outMap[index + nXnY] = y;
             outMap[index + nXnY2] = inverted;
@@ -133,6 +190,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
                     outMap[index] = INVALID;
                     outMap[index + nXnY] = INVALID;
                     outMap[index + nXnY2] = INVALID;      
+                    if (jacobian){
+                        jacobianInvalid(outMap, index, nXnY);
+                    }
                 }
                 continue;
             }
@@ -142,10 +202,17 @@ void mexFunction( int nlhs, mxArray *plhs[],
 
             if (r2 > limit2) {
                factor = powf(limit2 / r2, power);
+               if (jacobian){
+                   g = 2 * power * factor / r2;
+                   jacobianLinear(inMap, outMap, index, nXnY, factor - g * x * x, - g * x * y,
+                                  - g * x * y, factor - g * y * y);
+               }
                x *= factor;
                y *= factor;
                inverted= 1 - inverted;
-            }        
+            } else if (jacobian && returnsMap){
+               jacobianCopy(inMap, outMap, index, nXnY);
+            }
             outMap[index] = x;
             outMap[index + nXnY] = y;
             outMap[index + nXnY2] = inverted;
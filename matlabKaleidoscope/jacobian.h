@@ -0,0 +1,97 @@
+/*==========================================================
+ * jacobian.h: carry the derivative of the map through the transforms
+ *
+ * a map may have 7 layers instead of 3, for each pixel (h,k):
+ *     map(h,k,0) = x, map(h,k,1) = y, map(h,k,2) = parity
+ *     map(h,k,3) = dx/du, map(h,k,4) = dy/du
+ *     map(h,k,5) = dx/dv, map(h,k,6) = dy/dv
+ * where u is the column index and v the row index of the pixel,
+ * createIdentityMap(mPixels, xMin, xMax, yMin, yMax, true) creates such a map
+ *
+ * each kernel multiplies the jacobian with the derivative of its transform
+ * at the pixel (chain rule), exact also at the borders of tiles
+ * and where the parity changes, finite differences of the finished map fail there
+ * use the jacobian for the footprint of the pixel in the input image,
+ * for instance sampleImage(inputImage, x, y, 'mip', jacobian)
+ *
+ * the columns (dx/du, dy/du) and (dx/dv, dy/dv) are tangent vectors,
+ * as complex numbers t = dx + i dy they transform as
+ *     t -> f'(z) * t            for holomorphic f(z)
+ *     t -> g'(conj(z)) * conj(t) for anti-holomorphic f(z) = g(conj(z))
+ *
+ *========================================================*/
+
+#ifndef JACOBIAN_H
+#define JACOBIAN_H
+
+#include <complex.h>
+#include <stdbool.h>
+#define JACOBIAN_LAYERS 7
+
+/* maps have 3 layers, or 7 with the jacobian*/
+static inline bool isMapLayers(mwSize layers)
+{
+    return (layers == 3) || (layers == JACOBIAN_LAYERS);
+}
+
+/* holomorphic transform with derivative f'(z) at the pixel*/
+static inline void jacobianHolomorphic(const float *inMap, float *outMap, int index, int nXnY,
+        float complex derivative)
+{
+    float complex t;
+    t = derivative * (inMap[index + 3 * nXnY] + I * inMap[index + 4 * nXnY]);
+    outMap[index + 3 * nXnY] = crealf(t);
+    outMap[index + 4 * nXnY] = cimagf(t);
+    t = derivative * (inMap[index + 5 * nXnY] + I * inMap[index + 6 * nXnY]);
+    outMap[index + 5 * nXnY] = crealf(t);
+    outMap[index + 6 * nXnY] = cimagf(t);
+}
+
+/* anti-holomorphic transform f(z) = g(conj(z)) with derivative g'(conj(z))*/
+static inline void jacobianAntiholomorphic(const float *inMap, float *outMap, int index, int nXnY,
+        float complex derivative)
+{
+    float complex t;
+    t = derivative * (inMap[index + 3 * nXnY] - I * inMap[index + 4 * nXnY]);
+    outMap[index + 3 * nXnY] = crealf(t);
+    outMap[index + 4 * nXnY] = cimagf(t);
+    t = derivative * (inMap[index + 5 * nXnY] - I * inMap[index + 6 * nXnY]);
+    outMap[index + 5 * nXnY] = crealf(t);
+    outMap[index + 6 * nXnY] = cimagf(t);
+}
+
+/* general transform with the real matrix of derivatives
+ * (dX/dx, dX/dy; dY/dx, dY/dy) = (a11, a12; a21, a22)*/
+static inline void jacobianLinear(const float *inMap, float *outMap, int index, int nXnY,
+        float a11, float a12, float a21, float a22)
+{
+    float p, q;
+    p = inMap[index + 3 * nXnY];
+    q = inMap[index + 4 * nXnY];
+    outMap[index + 3 * nXnY] = a11 * p + a12 * q;
+    outMap[index + 4 * nXnY] = a21 * p + a22 * q;
+    p = inMap[index + 5 * nXnY];
+    q = inMap[index + 6 * nXnY];
+    outMap[index + 5 * nXnY] = a11 * p + a12 * q;
+    outMap[index + 6 * nXnY] = a21 * p + a22 * q;
+}
+
+/* unchanged pixel, copy only into a new output map*/
+static inline void jacobianCopy(const float *inMap, float *outMap, int index, int nXnY)
+{
+    int layer;
+    for (layer = 3; layer < JACOBIAN_LAYERS; layer++){
+        outMap[index + layer * nXnY] = inMap[index + layer * nXnY];
+    }
+}
+
+/* invalid pixel of a new output map*/
+static inline void jacobianInvalid(float *outMap, int index, int nXnY)
+{
+    int layer;
+    for (layer = 3; layer < JACOBIAN_LAYERS; layer++){
+        outMap[index + layer * nXnY] = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,94 @@
+function map = moebiusChain(map, stages)
+% run a chain of map transforms, fusing runs of (anti-)Moebius transforms
+% each stage is a cell array {name, parameters...}, for example
+%   stages={{'scale',2,1},{'cayleyTransform'},{'moebiusTransformMap',[1 0 0 0 0 0 1 0]}};
+%   newMap=moebiusChain(map,stages);
+%
+% consecutive stages of these kinds are composed into one 2x2 complex
+% matrix plus a conjugation flag and done in a single pass of moebiusTransformMap:
+%   {'moebiusTransformMap', params}   z => (a*z+b)/(c*z+d)
+%   {'scale', inLength, outLength}    z => outLength/inLength*z
+%   {'cayleyTransform'}               z => (z-i)/(z+i)
+%   {'circleInversion', radius, centerX, centerY}
+%                                     inversion at the circle for all points,
+%                                     an anti-Moebius map, changes parity
+% all other stages, for example universalInversionMap (inverts only inside
+% or outside of the circle) and rescaleMap (factor depends on the map),
+% are done as they are with feval(name, map, parameters...)
+
+% matrix and conjugation flag of the current run of Moebius transforms
+matrix=eye(2);
+conjugate=false;
+isRun=false;
+for i=1:numel(stages)
+    stage=stages{i};
+    [stageMatrix,stageConjugate,isMoebius]=getMoebius(stage);
+    if isMoebius
+        % first the run, then this stage, an antiMoebius stage conjugates the run
+        if stageConjugate
+            matrix=conj(matrix);
+        end
+        matrix=stageMatrix*matrix;
+        % normalize to avoid overflow in the single precision kernel
+        determinant=det(matrix);
+        if determinant~=0
+            matrix=matrix/sqrt(determinant);
+        end
+        conjugate=xor(conjugate,stageConjugate);
+        isRun=true;
+    else
+        if isRun
+            map=runMoebius(map,matrix,conjugate);
+            matrix=eye(2);
+            conjugate=false;
+            isRun=false;
+        end
+        map=feval(stage{1},map,stage{2:end});
+    end
+end
+if isRun
+    map=runMoebius(map,matrix,conjugate);
+end
+end
+
+function map = runMoebius(map,matrix,conjugate)
+% one pass for the composed transform
+params=[real(matrix(1,1)),imag(matrix(1,1)),real(matrix(1,2)),imag(matrix(1,2)),...
+    real(matrix(2,1)),imag(matrix(2,1)),real(matrix(2,2)),imag(matrix(2,2)),conjugate];
+map=moebiusTransformMap(map,params);
+end
+
+function [matrix,conjugate,isMoebius] = getMoebius(stage)
+% the matrix [a b;c d] of z => (a*w+b)/(c*w+d), with w=conj(z) if conjugate
+matrix=eye(2);
+conjugate=false;
+isMoebius=true;
+switch stage{1}
+    case 'moebiusTransformMap'
+        % missing parameters are 0, as in moebiusTransformMap
+        params=zeros(1,9);
+        if numel(stage)>1
+            params(1:numel(stage{2}))=stage{2};
+        end
+        matrix=[params(1)+1i*params(2), params(3)+1i*params(4);...
+            params(5)+1i*params(6), params(7)+1i*params(8)];
+        conjugate=params(9)>0.5;
+    case 'scale'
+        % scale uses an integer input length
+        outLength=1;
+        if numel(stage)>2
+            outLength=stage{3};
+        end
+        matrix=[outLength/fix(stage{2}), 0; 0, 1];
+    case 'cayleyTransform'
+        matrix=[1, -1i; 1, 1i];
+    case 'circleInversion'
+        % z => center + radius^2/conj(z-center)
+        radius=stage{2};
+        center=stage{3}+1i*stage{4};
+        matrix=[center, radius^2-abs(center)^2; 1, -conj(center)];
+        conjugate=true;
+    otherwise
+        isMoebius=false;
+end
+end
@@ -7,6 +7,11 @@
  *
  * params=[re a, im a, re b, im b, re c, im c, re d, im d)
  *
+ * optional 9th parameter: conjugation flag (default 0)
+ *     if >0.5 does z => (a*conj(z)+b)/(c*conj(z)+d), an anti-Moebius map,
+ *     and changes the parity of the pixel
+ *     used by moebiusChain to run composed chains of transforms in one pass
+ *
  * moebiusTransformMap(map,params);
  *
  * default values for parameters are 0, as for now, can be changed
@@ -16,6 +21,12 @@
  * does not change the map and returns a modified map if used as  a function
  * newMap = moebiusTransformMap(map,params);
  *
+ * a map with 7 layers carries its jacobian (see jacobian.h),
+ * multiplied by the derivative (a*d-b*c)/(c*z+d)^2
+ *
+ * instead of an identity map takes a grid (see gridMap.h), returns a new map
+ * newMap = moebiusTransformMap(identityGrid(mPixels, xMin, xMax), params);
+ *
  *========================================================*/
 
 #include "mex.h"
@@ -23,6 +34,8 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include "jacobian.h"
+#include "gridMap.h"
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1000
@@ -31,12 +44,16 @@ void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     const mwSize *dims, *aDims;
+    mwSize gridDims[3];
+    grid inGrid;
+    bool isGridInput;
     float params[10];
     double *doubleParams;
     int i, nParams;
-    int nX, nY, nXnY, nXnY2, index;
-    float inverted;
-    float complex z, a, b , c , d;
+    int nX, nY, nXnY, nXnY2, index, column, row;
+    float inverted, x;
+    float complex z, a, b , c , d, denominator;
+    bool conjugate, jacobian;
     float *inMap, *outMap;
     /* default value for parameters a is 0 */
     for (i=0;i<10;i++){
@@ -48,24 +65,37 @@ void mexFunction( int nlhs, mxArray *plhs[],
     if(nrhs == 0) {
         mexErrMsgIdAndTxt("moebiusTransformMap:nrhs","A map input required.");
     }
-    /* check number of dimensions of the map*/
-    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
-        mexErrMsgIdAndTxt("moebiusTransformMap:mapDims","The map has to have three dimensions.");
-    }
-    dims = mxGetDimensions(prhs[0]);
-    if(dims[2] != 3) {
-        mexErrMsgIdAndTxt("moebiusTransformMap:map3rdDimension","The map's third dimension has to be three.");
+    isGridInput = isGrid(prhs[0]);
+    if (isGridInput) {
+        getGrid(prhs[0], &inGrid, gridDims);
+        dims = gridDims;
+        if (nlhs != 1) {
+            mexErrMsgIdAndTxt("moebiusTransformMap:nlhs","Returns a new map for a grid.");
+        }
+    } else {
+        /* check number of dimensions of the map*/
+        if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
+            mexErrMsgIdAndTxt("moebiusTransformMap:mapDims","The map has to have three dimensions.");
+        }
+        dims = mxGetDimensions(prhs[0]);
+        if(!isMapLayers(dims[2])) {
+            mexErrMsgIdAndTxt("moebiusTransformMap:map3rdDimension","The map's third dimension has to be three (or seven with jacobian).");
+        }
     }
+    jacobian = (dims[2] == JACOBIAN_LAYERS);
     /* check that no or one output is expected*/
     if (nlhs > 1) {
         mexErrMsgIdAndTxt("moebiusTransformMap:nlhs","Has zero or one return parameter.");
     }
     /* get the map*/
+    inMap = NULL;
+    if (!isGridInput) {
 #if MX_HAS_INTERLEAVED_COMPLEX
-    inMap = mxGetSingles(prhs[0]);
+        inMap = mxGetSingles(prhs[0]);
 #else
-    inMap = (float *) mxGetPr(prhs[0]);
+        inMap = (float *) mxGetPr(prhs[0]);
 #endif
+    }
         /* load the parameters, if present */
     if(nrhs > 1) {
         aDims = mxGetDimensions(prhs[1]);
@@ -89,6 +119,7 @@ void mexFunction( int nlhs, mxArray *plhs[],
     b = params[2] + I * params[3];
     c = params[4] + I * params[5];
     d = params[6] + I * params[7];     
+    conjugate = (params[8] > 0.5f);
     /* left hand side */
     if (nlhs == 0){
         outMap = inMap;
@@ -108,6 +139,25 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nY = dims[0];
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
+    if (isGridInput) {
+        /* all pixels of the grid are valid, parity 0*/
+        inverted = conjugate ? 1 : 0;
+        for (column = 0; column < nX; column++){
+            x = gridX(&inGrid, column);
+            for (row = 0; row < nY; row++){
+                index = row + nY * column;
+                z = x + I * gridY(&inGrid, row);
+                if (conjugate) {
+                    z = conjf(z);
+                }
+                z = (a * z + b) / (c * z + d);
+                outMap[index] = crealf(z);
+                outMap[index + nXnY] = cimagf(z);
+                outMap[index + nXnY2] = inverted;
+            }
+        }
+        return;
+    }
     for (index = 0; index < nXnY; index++){
         inverted = inMap[index + nXnY2];
         /* do only transform if pixel is valid*/
@@ -116,12 +166,27 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 /* set element only if new output map*/
                 outMap[index] = INVALID;
                 outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID;           }
+                outMap[index + nXnY2] = INVALID;
+                if (jacobian){
+                    jacobianInvalid(outMap, index, nXnY);
+                }
+            }
             continue;
         }
         z = inMap[index] + I * inMap[index + nXnY];
-        
-        z = (a * z + b) / (c * z + d);
+        if (conjugate) {
+            z = conjf(z);
+            inverted = 1 - inverted;
+        }
+        denominator = c * z + d;
+        if (jacobian){
+            if (conjugate){
+                jacobianAntiholomorphic(inMap, outMap, index, nXnY, (a * d - b * c) / (denominator * denominator));
+            } else {
+                jacobianHolomorphic(inMap, outMap, index, nXnY, (a * d - b * c) / (denominator * denominator));
+            }
+        }
+        z = (a * z + b) / denominator;
         
         outMap[index] = crealf(z);
         outMap[index + nXnY] = cimagf(z);
@@ -30,6 +30,9 @@
  * does not change the map and returns a modified map if used as  a function
  * newMap = transform(map, ....);
  *
+ * a map with 7 layers carries its jacobian (see jacobian.h),
+ * the map is anti-holomorphic: newX + i newY = i (periodX + i periodY) log(conj(z))
+ *
  *========================================================*/
 
 #include "mex.h"
@@ -37,6 +40,8 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include "fastMath.h"
+#include "jacobian.h"
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1000
@@ -51,7 +56,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
     double *doubleA;
     int i, nParams;
     float *inMap, *outMap;
-    float lnR, phi, periodX, periodY, x, y;
+    float lnR, phi, periodX, periodY, x, y, newX, newY;
+    bool invalid, jacobian;
+    float complex period;
     /* default value for parameters a is 0 */
     for (i=0;i<10;i++){
         a[i]=0;
@@ -67,9 +74,10 @@ void mexFunction( int nlhs, mxArray *plhs[],
         mexErrMsgIdAndTxt("mirrorsMap:mapDims","The map has to have three dimensions.");
     }
     dims = mxGetDimensions(prhs[0]);
-    if(dims[2] != 3) {
-        mexErrMsgIdAndTxt("mirrorsMap:map3rdDimension","The map's third dimension has to be three.");
+    if(!isMapLayers(dims[2])) {
+        mexErrMsgIdAndTxt("mirrorsMap:map3rdDimension","The map's third dimension has to be three (or seven with jacobian).");
     }
+    jacobian = (dims[2] == JACOBIAN_LAYERS);
     /* check that no or one output is expected*/
     if (nlhs > 1) {
         mexErrMsgIdAndTxt("mirrorsMap:nlhs","Has zero or one return parameter.");
@@ -133,26 +141,38 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nY = dims[0];
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
-    for (index = 0; index < nXnY; index++){
-        inverted = inMap[index + nXnY2];
-        /* do only transform if pixel is valid*/
-        if (inverted < -0.1f) {
-            if (returnsMap){
-                /* set element only if new output map*/
-                outMap[index] = INVALID;
-                outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID;      
+    /* the jacobian before the map changes, derivative i * period / conj(z)*/
+    if (jacobian){
+        period = periodX + I * periodY;
+        for (index = 0; index < nXnY; index++){
+            if (inMap[index + nXnY2] < -0.1f) {
+                if (returnsMap){
+                    jacobianInvalid(outMap, index, nXnY);
+                }
+                continue;
             }
-            continue;
+            jacobianAntiholomorphic(inMap, outMap, index, nXnY, I * period / (inMap[index] - I * inMap[index + nXnY]));
         }
+    }
+    /* without branches, vectorizes*/
+    for (index = 0; index < nXnY; index++){
+        inverted = inMap[index + nXnY2];
         x = inMap[index];
         y = inMap[index + nXnY];
-        phi = atan2f(y,x);
-        lnR = 0.5 * logf(x * x + y * y);
-        x = phi * periodX - lnR * periodY;
-        y = phi * periodY + lnR * periodX;
-        outMap[index] = x;
-        outMap[index + nXnY] = y;
-        outMap[index + nXnY2] = inverted;
+        phi = fastAtan2f(y,x);
+        lnR = 0.5f * fastLogf(x * x + y * y);
+        newX = phi * periodX - lnR * periodY;
+        newY = phi * periodY + lnR * periodX;
+        /* transform only valid pixels, invalid pixels of a new output map get INVALID*/
+        invalid = (inverted < -0.1f);
+        outMap[index] = invalid ? (returnsMap ? INVALID : x) : newX;
+        outMap[index + nXnY] = invalid ? (returnsMap ? INVALID : y) : newY;
+    }
+    /* the parities change only in a new output map*/
+    if (returnsMap){
+        for (index = 0; index < nXnY; index++){
+            inverted = inMap[index + nXnY2];
+            outMap[index + nXnY2] = (inverted < -0.1f) ? INVALID : inverted;
+        }
     }
 }
@@ -21,6 +21,9 @@
  * does not change the map and returns a modified map if used as  a function
  * newMap = transform(map, ....);
  *
+ * a map with 7 layers carries its jacobian (see jacobian.h),
+ * multiplied by the derivative of the polynom, from the same Horner scheme
+ *
  *========================================================*/
 
 #include "mex.h"
@@ -28,6 +31,7 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include "jacobian.h"
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1000
@@ -38,13 +42,14 @@ void mexFunction( int nlhs, mxArray *plhs[],
     const mwSize *dims,*aDims;
     int nX, nY, nXnY, nXnY2, index;
     float inverted;
-    float complex z, w;
+    float complex z, w, dw;
     int power, repower, impower,i;
     double *realA, *imA;
     float complex a[10];
     float reC, imC;
     float *inMap, *outMap;
     bool returnsMap = false;
+    bool jacobian;
     /* check for proper number of arguments (else crash)*/
     /* checking for presence of a map*/
     if(nrhs <2) {
@@ -55,9 +60,10 @@ void mexFunction( int nlhs, mxArray *plhs[],
         mexErrMsgIdAndTxt("polynomTransformMap:mapDims","The map has to have three dimensions.");
     }
     dims = mxGetDimensions(prhs[0]);
-    if(dims[2] != 3) {   
-        mexErrMsgIdAndTxt("polynomTransformMap:map3rdDimension","The map's third dimension has to be three.");
+    if(!isMapLayers(dims[2])) {
+        mexErrMsgIdAndTxt("polynomTransformMap:map3rdDimension","The map's third dimension has to be three (or seven with jacobian).");
     }
+    jacobian = (dims[2] == JACOBIAN_LAYERS);
     for (i=0;i<10;i++){
         a[i]=0;
     }
@@ -140,15 +146,29 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 /* set element only if new output map*/
                 outMap[index] = INVALID;
                 outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID;           }
+                outMap[index + nXnY2] = INVALID;
+                if (jacobian){
+                    jacobianInvalid(outMap, index, nXnY);
+                }
+            }
             continue;
         }
         z = inMap[index] + I * inMap[index + nXnY];
         /* do some transformation of z */
         /*=========================*/
         w =  a[power-1];
-        for (i=power-2;i>=0;i--){
-            w = w * z +a[i];
+        if (jacobian){
+            /* derivative together with the polynom*/
+            dw = 0;
+            for (i=power-2;i>=0;i--){
+                dw = dw * z + w;
+                w = w * z +a[i];
+            }
+            jacobianHolomorphic(inMap, outMap, index, nXnY, dw);
+        } else {
+            for (i=power-2;i>=0;i--){
+                w = w * z +a[i];
+            }
         }
         outMap[index] = crealf(w);
         outMap[index + nXnY] = cimagf(w);
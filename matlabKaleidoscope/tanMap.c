@@ -5,6 +5,9 @@
  *
  * optional parameter k default 1 (gives Bulatov band)
  *
+ * uses fastCtanf of fastMath.h, for |x| < FAST_TRIG_LIMIT (2048), if a valid pixel
+ * of the map has a larger |x| the map is done with ctanf of libm (slower)
+ *
  * modifies the map, returns nothing if used as a procedure
  * transform(map, ...);
  * does not change the map and returns a modified map if used as  a function
@@ -17,20 +20,43 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include "fastMath.h"
 #define PI 3.14159f
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1000
 
+/* transform the x and y layers, with fastCtanf or with ctanf of libm (useLibm)*/
+/* without branches, the loop vectorizes for each constant value of useLibm*/
+static inline void transformPixels(const float *inMap, float *outMap, int nXnY, float k, bool returnsMap, bool useLibm)
+{
+    int index;
+    int nXnY2 = 2 * nXnY;
+    float inverted, x, y;
+    float complex z;
+    bool invalid;
+    for (index = 0; index < nXnY; index++){
+        inverted = inMap[index + nXnY2];
+        x = inMap[index];
+        y = inMap[index + nXnY];
+        z = x + y * I;
+        z = k * (useLibm ? ctanf(z) : fastCtanf(z));
+        /* transform only valid pixels, invalid pixels of a new output map get INVALID*/
+        invalid = (inverted < -0.1f);
+        outMap[index] = invalid ? (returnsMap ? INVALID : x) : crealf(z);
+        outMap[index + nXnY] = invalid ? (returnsMap ? INVALID : y) : cimagf(z);
+    }
+}
+
 void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     const mwSize *dims;
     int nX, nY, nXnY, nXnY2, index;
     float inverted;
-    float complex z;
     float *inMap, *outMap, k;
     bool returnsMap = false;
+    int outside;
     /* check for proper number of arguments (else crash)*/
     /* checking for presence of a map*/
     if(nrhs == 0) {
@@ -77,22 +103,21 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nY = dims[0];
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
+    /* fastCtanf is wrong for |x| >= FAST_TRIG_LIMIT, libm has no limit*/
+    outside = 0;
     for (index = 0; index < nXnY; index++){
-        inverted = inMap[index + nXnY2];
-        /* do only transform if pixel is valid*/
-        if (inverted < -0.1f) {
-            if (returnsMap){
-                /* set element only if new output map*/
-                outMap[index] = INVALID;
-                outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID;
-            }
-            continue;
+        outside += (inMap[index + nXnY2] > -0.1f) & !(fabsf(inMap[index]) < FAST_TRIG_LIMIT);
+    }
+    if (outside > 0){
+        transformPixels(inMap, outMap, nXnY, k, returnsMap, true);
+    } else {
+        transformPixels(inMap, outMap, nXnY, k, returnsMap, false);
+    }
+    /* the parities change only in a new output map*/
+    if (returnsMap){
+        for (index = 0; index < nXnY; index++){
+            inverted = inMap[index + nXnY2];
+            outMap[index + nXnY2] = (inverted < -0.1f) ? INVALID : inverted;
         }
-        z = inMap[index]+ inMap[index + nXnY] * I;
-        z = k * tan(z);
-        outMap[index] = crealf(z);
-        outMap[index + nXnY] = cimagf(z);
-        outMap[index + nXnY2] = inverted;
     }
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+function testAdaptiveSupersample()
+% test of adaptiveSupersample
+% compares with full supersampling (16 times the pixels) and shows both images
+
+% needs the mex file basicKaleidoscope of matlabHerbst23 (or of matlabParketts),
+% basicKaleidoscope.m of this folder is a stub
+% runs in matlabHerbst23, the current folder comes before the path, whatever its order
+% the path and the folder are restored at the end, also after an error
+here=fileparts(mfilename('fullpath'));
+oldPath=path;
+addpath(here,fullfile(here,'..','matlabParketts'));
+oldFolder=cd(fullfile(here,'..','matlabHerbst23'));
+restore=onCleanup(@() restorePathAndFolder(oldPath,oldFolder));
+
+s = 1000;
+mPix=s*s/1e6;
+range=1;
+nSub=4;
+chain=@(m) basicKaleidoscope(m,7,3,2);
+colorize=@(m) createColorImage(m,'parity',[1 0.8 0.2;0.1 0.2 0.6]);
+
+% adaptive: edges only
+map=createIdentityMap(mPix,-range,range,-range,range);
+tic;
+[adaptiveImage,edges]=adaptiveSupersample(map,chain,colorize,nSub);
+adaptiveTime=toc
+edgeFraction=mean(edges(:))
+
+% full supersampling, nSub*nSub times the pixels, then averaged
+tic;
+bigMap=createIdentityMap(mPix*nSub*nSub,-range,range,-range,range);
+bigImage=colorize(chain(bigMap));
+fullImage=imresize(bigImage,size(map,[1,2]),'box');
+fullTime=toc
+
+% both should differ only by rounding and the grid of the subsamples
+meanDifference=mean(abs(single(adaptiveImage(:))-single(fullImage(:))))
+
+montage({adaptiveImage,fullImage,uint8(255*edges)},'Size',[1,3]);
+end
+
+function restorePathAndFolder(oldPath,oldFolder)
+path(oldPath);
+cd(oldFolder);
+end
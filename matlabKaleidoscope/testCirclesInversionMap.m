@@ -0,0 +1,26 @@
+function testCirclesInversionMap()
+% test of the inversions at many circles
+% a necklace of touching circles, each inverting inside out
+% and an enclosing circle inverting outside in
+% shows pattern of inversions
+
+s = 1000;
+mPix=s*s/1e6;
+range=1.5;
+map=createIdentityMap(mPix,-range,range,-range,range);
+
+% number of circles in the necklace
+n=60;
+% the circles touch their neighbours
+angles=2*pi*(0:n-1)'/n;
+radius=sin(pi/n);
+circles=[cos(angles), sin(angles), radius*ones(n,1), ones(n,1)];
+% enclosing circle, inverts outside in
+circles=[circles; 0, 0, 1.4, 0];
+
+circlesInversionMap(map,circles,200);
+
+im=createStructureImage(map);
+imshow(im);
+%imwrite(im,'image.jpg');
+end
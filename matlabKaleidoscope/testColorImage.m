@@ -0,0 +1,33 @@
+% creates map and tiles of the fractoscope
+% shows the colorings of createColorImage, RGB images without matlab processing
+
+% first compile createColorImage.c with compileFastMath.m
+
+function testColorImage()
+
+k=5;
+s = 1000;
+mPix=s*s/1e6;
+map=createIdentityMap(mPix,-1,1,-1,1);
+[map,tiles]=fractoscope(map,k,0,1);
+
+% parity, black and white as createStructureImage
+im=createColorImage(map,'parity');
+imshow(im);
+pause(1);
+% parity with own colors
+im=createColorImage(map,'parity',[0.9 0.8 0.5; 0.2 0.3 0.6]);
+imshow(im);
+pause(1);
+% phase through a colormap
+im=createColorImage(map,'phase',hsv(64));
+imshow(im);
+pause(1);
+% each tile its own color
+im=createColorImage(map,'tile',parula(16),tiles);
+imshow(im);
+pause(1);
+% colors from the number of reflections and inversions
+im=createColorImage(map,'count',jet(8),tiles);
+imshow(im);
+end
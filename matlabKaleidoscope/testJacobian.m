@@ -0,0 +1,49 @@
+function testJacobian()
+% test of the jacobian carried through the kernels (see jacobian.h)
+% compares it with centered differences of the finished map,
+% they agree inside the tiles and differ at their borders
+% shows the area distortion log(abs(det(jacobian)))
+
+% needs the mex file basicKaleidoscope of matlabHerbst23, only it carries the jacobian,
+% basicKaleidoscope.m of this folder is a stub, the one of matlabParketts rejects 7 layers
+% runs in matlabHerbst23, the current folder comes before the path, whatever its order
+% the path and the folder are restored at the end, also after an error
+here=fileparts(mfilename('fullpath'));
+oldPath=path;
+addpath(here,fullfile(here,'..','matlabParketts'));
+oldFolder=cd(fullfile(here,'..','matlabHerbst23'));
+restore=onCleanup(@() restorePathAndFolder(oldPath,oldFolder));
+
+s = 1000;
+mPix=s*s/1e6;
+range=0.95;
+% identity map with jacobian, 7 layers
+map=createIdentityMap(mPix,-range,range,-range,range,true);
+
+moebiusTransformMap(map,[1 0 0.2 0 0.2 0 1 0]);
+polynomTransformMap(map,[0 1 0 0.2]);
+basicKaleidoscope(map,7,3,2);
+
+valid=map(:,:,3)>-0.1;
+% centered differences along columns (u) and rows (v)
+dxdu=(map(:,[2:end end],1)-map(:,[1 1:end-1],1))/2;
+dydu=(map(:,[2:end end],2)-map(:,[1 1:end-1],2))/2;
+dxdv=(map([2:end end],:,1)-map([1 1:end-1],:,1))/2;
+dydv=(map([2:end end],:,2)-map([1 1:end-1],:,2))/2;
+difference=abs(map(:,:,4)-dxdu)+abs(map(:,:,5)-dydu)+abs(map(:,:,6)-dxdv)+abs(map(:,:,7)-dydv);
+magnitude=abs(map(:,:,4))+abs(map(:,:,5))+abs(map(:,:,6))+abs(map(:,:,7));
+relativeDifference=difference(valid)./magnitude(valid);
+medianRelativeDifference=median(relativeDifference)
+fractionAbove10Percent=mean(relativeDifference>0.1)
+
+areaDistortion=log(abs(map(:,:,4).*map(:,:,7)-map(:,:,5).*map(:,:,6)));
+areaDistortion(~valid)=NaN;
+imagesc(areaDistortion);
+axis image;
+colorbar;
+end
+
+function restorePathAndFolder(oldPath,oldFolder)
+path(oldPath);
+cd(oldFolder);
+end
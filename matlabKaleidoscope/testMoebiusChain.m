@@ -0,0 +1,40 @@
+function testMoebiusChain()
+% test of moebiusChain
+% the fused chain has to give the same map as doing the stages one by one
+% shows the image and the time of both ways
+
+s = 1000;
+mPix=s*s/1e6;
+range=1.5;
+map=createIdentityMap(mPix,-range,range,-range,range);
+
+stages={{'scale',2,1},...
+    {'moebiusTransformMap',[1 0 0.2 0.1 0 0 1 0]},...
+    {'circleInversion',0.8,0.1,0},...
+    {'universalInversionMap',0.5,0,0,1},...
+    {'moebiusTransformMap',[1 0 0 0 0.3 0 1 0]},...
+    {'scale',1,2}};
+
+tic;
+fusedMap=moebiusChain(map,stages);
+fusedTime=toc
+
+% the stages one by one, circleInversion done as moebiusTransformMap with conjugation
+tic;
+newMap=scale(map,2,1);
+newMap=moebiusTransformMap(newMap,[1 0 0.2 0.1 0 0 1 0]);
+c=0.1;
+newMap=moebiusTransformMap(newMap,[c 0 0.64-c*c 0 1 0 -c 0 1]);
+newMap=universalInversionMap(newMap,0.5,0,0,1);
+newMap=moebiusTransformMap(newMap,[1 0 0 0 0.3 0 1 0]);
+newMap=scale(newMap,1,2);
+stepsTime=toc
+
+valid=newMap(:,:,3)>-0.1;
+difference=abs(fusedMap(:,:,1:2)-newMap(:,:,1:2));
+maxDifference=max(difference(repmat(valid,1,1,2)))
+sameParity=isequal(fusedMap(:,:,3),newMap(:,:,3))
+
+im=createStructureImage(fusedMap);
+imshow(im);
+end
@@ -0,0 +1,133 @@
+/*==========================================================
+ * bakeMap: bake the input image coordinates of a fitted map into
+ * fixed point, for sampling many images of the same size (see bakedMap.h)
+ *
+ * baked = bakeMap(x, y);
+ * baked = bakeMap(x, y, parity);
+ *
+ * Input:
+ * x, y: matrices of the same size, single or double,
+ *     matlab pixel coordinates in the input image as for interp2,
+ *     as from vm2NaNNorm2 or the fit of makeOutputImageFitMapToInput
+ * parity: optional, map(:,:,3) of the map, pixels with parity < 0 are invalid
+ *
+ * pixels with NaN coordinates, x < 1 or y < 1, or beyond 65536 are invalid
+ * the coordinates are rounded to 1/256 pixel
+ *
+ * returns the baked map, a uint8 array of size (6, nY, nX), 6 bytes per pixel
+ * use with sampleBakedMap(inputImage, baked), save it to reuse the geometry:
+ *     x = scale * map(:,:,1) + offsetX; y = scale * map(:,:,2) + offsetY;
+ *     baked = bakeMap(x, y, map(:,:,3));
+ *     outputImage = sampleBakedMap(inputImage, baked);
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bakedMap.h"
+#define PARALLEL_MIN 10000
+
+/* matlab coordinate as zero based 16.8 fixed point, BAKED_INVALID if not possible*/
+static inline uint32_t toFixedPoint(double coordinate)
+{
+    double fixed;
+    fixed = floor((coordinate - 1) * BAKED_ONE + 0.5);
+    /* NaN fails the comparisons*/
+    if (!((fixed >= 0) && (fixed < BAKED_INVALID))) {
+        return BAKED_INVALID;
+    }
+    return (uint32_t) fixed;
+}
+
+/* element of a single or double matrix*/
+static inline double getValue(const float *singles, const double *doubles, ptrdiff_t index)
+{
+    return (singles != NULL) ? (double) singles[index] : doubles[index];
+}
+
+/* single or double data of a matrix, the other pointer is NULL*/
+static void getData(const mxArray *a, float **singles, double **doubles)
+{
+    *singles = NULL;
+    *doubles = NULL;
+    if (mxIsSingle(a)) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        *singles = mxGetSingles(a);
+#else
+        *singles = (float *) mxGetData(a);
+#endif
+    } else {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        *doubles = mxGetDoubles(a);
+#else
+        *doubles = mxGetPr(a);
+#endif
+    }
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *xDims;
+    mwSize bakedDims[3];
+    mwSize nX, nY, nXnY;
+    ptrdiff_t index;
+    int i;
+    uint32_t u, v;
+    float *xSingles, *ySingles, *paritySingles = NULL;
+    double *xDoubles, *yDoubles, *parityDoubles = NULL;
+    uint8_t *baked;
+    bool hasParity;
+    /* check for proper number of arguments (else crash)*/
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("bakeMap:nrhs","The coordinates x and y required.");
+    }
+    for (i = 0; i < nrhs; i++){
+        if ((!mxIsSingle(prhs[i]) && !mxIsDouble(prhs[i])) || mxIsComplex(prhs[i])) {
+            mexErrMsgIdAndTxt("bakeMap:class","x, y and parity have to be real single or double.");
+        }
+    }
+    xDims = mxGetDimensions(prhs[0]);
+    nY = xDims[0];
+    nX = mxGetNumberOfElements(prhs[0]) / ((nY > 0) ? nY : 1);
+    nXnY = nX * nY;
+    hasParity = (nrhs > 2);
+    for (i = 1; i < (hasParity ? 3 : 2); i++){
+        if ((mxGetDimensions(prhs[i])[0] != nY) || (mxGetNumberOfElements(prhs[i]) != nXnY)) {
+            mexErrMsgIdAndTxt("bakeMap:size","x, y and parity have to be of the same size.");
+        }
+    }
+    /* check that output is possible*/
+    if (nlhs != 1) {
+        mexErrMsgIdAndTxt("bakeMap:nlhs","One output array for the baked map required.");
+    }
+    getData(prhs[0], &xSingles, &xDoubles);
+    getData(prhs[1], &ySingles, &yDoubles);
+    if (hasParity) {
+        getData(prhs[2], &paritySingles, &parityDoubles);
+    }
+    bakedDims[0] = BAKED_BYTES;
+    bakedDims[1] = nY;
+    bakedDims[2] = nX;
+    plhs[0] = mxCreateNumericArray(3, bakedDims, mxUINT8_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+    baked = mxGetUint8s(plhs[0]);
+#else
+    baked = (uint8_t *) mxGetData(plhs[0]);
+#endif
+    /* do the baked map*/
+    /* row first order*/
+#pragma omp parallel for private(u, v) if (nXnY > PARALLEL_MIN)
+    for (index = 0; index < (ptrdiff_t) nXnY; index++){
+        u = toFixedPoint(getValue(xSingles, xDoubles, index));
+        v = toFixedPoint(getValue(ySingles, yDoubles, index));
+        if ((v == BAKED_INVALID)
+                || (hasParity && (getValue(paritySingles, parityDoubles, index) < -0.1))) {
+            u = BAKED_INVALID;
+        }
+        bakePixel(baked + (size_t) BAKED_BYTES * index, u, v);
+    }
+}
@@ -0,0 +1,50 @@
+/*==========================================================
+ * bakedMap.h: the format of baked maps, see bakeMap and sampleBakedMap
+ *
+ * a baked map has for each output pixel the position in the input image,
+ * as fixed point numbers, no float map is needed to sample another image
+ * of the same size
+ *
+ * it is a uint8 array of size (6, nY, nX), 6 bytes per pixel:
+ *     48 bits little endian, bits 0-23 column u, bits 24-47 row v
+ *     u and v are zero based (u = x - 1, v = y - 1), unsigned 16.8 fixed point:
+ *     256 * pixel position, 1/256 pixel, up to 65535 pixels
+ *     u = 0xFFFFFF marks invalid pixels (black)
+ * with 8 fraction bits bilinear interpolation of uint8 images is
+ * exact up to rounding, fewer bits give visible errors at sharp edges
+ *
+ *========================================================*/
+
+#ifndef BAKED_MAP_H
+#define BAKED_MAP_H
+
+#include <stdint.h>
+#define BAKED_BYTES 6
+#define BAKED_FRACTION_BITS 8
+#define BAKED_ONE 256
+#define BAKED_FRACTION_MASK 255
+#define BAKED_COORDINATE_BITS 24
+#define BAKED_INVALID 0xFFFFFF
+
+/* write the record of a pixel*/
+static inline void bakePixel(uint8_t *record, uint32_t u, uint32_t v)
+{
+    uint64_t bits;
+    int i;
+    bits = (uint64_t) u | ((uint64_t) v << BAKED_COORDINATE_BITS);
+    for (i = 0; i < BAKED_BYTES; i++){
+        record[i] = (uint8_t) (bits >> (8 * i));
+    }
+}
+
+/* read the record of a pixel*/
+static inline void unbakePixel(const uint8_t *record, uint32_t *u, uint32_t *v)
+{
+    uint64_t bits;
+    bits = (uint64_t) record[0] | ((uint64_t) record[1] << 8) | ((uint64_t) record[2] << 16)
+            | ((uint64_t) record[3] << 24) | ((uint64_t) record[4] << 32) | ((uint64_t) record[5] << 40);
+    *u = (uint32_t) (bits & BAKED_INVALID);
+    *v = (uint32_t) (bits >> BAKED_COORDINATE_BITS);
+}
+
+#endif
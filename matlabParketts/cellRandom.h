@@ -0,0 +1,75 @@
+/*==========================================================
+ * cellRandom.h: random numbers for the cells of tilings
+ *
+ * counter based: the random number of a cell depends only on its
+ * integer indices (i,j) and a seed, not on the order of the pixels.
+ * thus it does not change with threads, with the map or the platform,
+ * and all pixels of a cell get the same random choice.
+ *
+ * cellRandomBits(i, j, seed) gives 32 random bits
+ * cellRandomUniform(i, j, seed) gives a float in [0,1)
+ * cellRandomChoice(i, j, seed, p) is true with probability p
+ *
+ * use different seeds (or seed + k) for independent random choices in the same cell
+ *
+ * the tiles of the *442 tilings (tiling442.c and randomTiling442.c):
+ * hashInt(hash, value) adds an integer to a FNV-1a hash, starting with HASH_START
+ * mirrorsCrossed(x, y, size, sizeHalf) is the length of the word of the tile
+ *
+ *========================================================*/
+
+#ifndef CELL_RANDOM_H
+#define CELL_RANDOM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#define HASH_START 2166136261u
+#define HASH_PRIME 16777619u
+
+/* mixing of 32 bits, each input bit changes about half of the output bits*/
+/* (the "lowbias32" integer hash)*/
+static inline uint32_t cellRandomMix(uint32_t x){
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static inline uint32_t cellRandomBits(int i, int j, uint32_t seed){
+    uint32_t h;
+    h = cellRandomMix(seed ^ 0x9e3779b9u);
+    h = cellRandomMix(h ^ (uint32_t) i);
+    h = cellRandomMix(h ^ ((uint32_t) j * 0x85ebca6bu));
+    return h;
+}
+
+static inline float cellRandomUniform(int i, int j, uint32_t seed){
+    /* the upper 24 bits fit exactly into a float*/
+    return (cellRandomBits(i, j, seed) >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline bool cellRandomChoice(int i, int j, uint32_t seed, float p){
+    return cellRandomUniform(i, j, seed) < p;
+}
+
+/* FNV-1a hash of the bytes of an integer*/
+static inline uint32_t hashInt(uint32_t hash, int value){
+    int i;
+    for (i = 0; i < 4; i++){
+        hash = (hash ^ (uint32_t) (value & 0xff)) * HASH_PRIME;
+        value >>= 8;
+    }
+    return hash;
+}
+
+/* number of mirror lines of the *442 tiling between (x,y) and the basic triangle 0<=y<=x<=sizeHalf*/
+static inline uint32_t mirrorsCrossed(float x, float y, float size, float sizeHalf){
+    return abs((int) floorf(x / sizeHalf)) + abs((int) floorf(y / sizeHalf))
+            + abs((int) floorf((x - y) / size)) + abs((int) floorf((x + y) / size));
+}
+
+#endif
@@ -12,8 +12,21 @@ mex basicKaleidoscope.c
 %mex poincarePlaneToDisc.c
 mex createStructureImage.c
 mex getRangeMap.c
-mex tiling442.c
-mex randomTiling442.c
+% with openMP for using all cores
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' tiling442.c
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' randomTiling442.c
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' sampleImage.c
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' bakeMap.c
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' sampleBakedMap.c
+% with zlib for the compression of PNG and TIFF
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' imageWriter.c -lz
+% maps in files larger than the memory, for linux and macOS
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' mappedMap.c
+% lossless packed maps, with zlib
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' packMap.c -lz
+mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' unpackMap.c -lz
+% sockets of the render daemon, for linux and macOS
+mex jobSocket.c
 %mex polygonToCircle.c
 % takes some time, if ok shows 3 times:
 % Building with 'gcc'.
@@ -6,6 +6,7 @@
  * (c-indices, starting with 0, row index first, is y-axis)
  * inverts the y-axis for correct display of images
  *
+ * createIdentityMap(mPixels, xMin, xMax, yMin, yMax, jacobian);
  * createIdentityMap(mPixels, xMin, xMax, yMin, yMax);
  * createIdentityMap(mPixels, xMin, xMax, yMin);
  * createIdentityMap(mPixels, xMin, xMax);
@@ -20,6 +21,9 @@
  * yMin - lower Value of y-coordinates, default = xMin
  * yMax - upper Value of y-coordinates, default = -yMin
  * all are double precision scalar (Matlab default)
+ * jacobian - if true the map gets 4 more layers with the derivatives of (x,y)
+ *     with respect to column and row index: dx/du, dy/du, dx/dv, dy/dv (default false)
+ *     kernels that support it carry this jacobian through their transforms
  *
  * returns the map
  *
@@ -27,6 +31,7 @@
 
 #include "mex.h"
 #include <math.h>
+#include <stdbool.h>
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 
@@ -37,6 +42,7 @@ void mexFunction( int nlhs, mxArray *plhs[],
     int nX, nY, j, k, index, nXnY;
     float dx, dy, dxdy, x, y;
     float *map;
+    bool jacobian;
     static mwSize dims[3];
     /* check that output is possible*/
     if (nlhs != 1) {
@@ -69,6 +75,10 @@ void mexFunction( int nlhs, mxArray *plhs[],
     } else {
         yMax = - yMin;
     }
+    jacobian = false;
+    if (nrhs >= 6){
+        jacobian = (mxGetScalar(prhs[5]) > 0);
+    }
     /* get array dimensions*/
     dx = xMax - xMin;
     dy = yMax - yMin;
@@ -81,7 +91,7 @@ void mexFunction( int nlhs, mxArray *plhs[],
     /* attention: row first - corresponds to y dimension*/
     dims[0] = (mwSize) nY;
     dims[1] = (mwSize) nX;
-    dims[2] = (mwSize) 3;
+    dims[2] = (mwSize) (jacobian ? 7 : 3);
     plhs[0]=mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
 #if MX_HAS_INTERLEAVED_COMPLEX
     map = mxGetSingles(plhs[0]);
@@ -99,6 +109,13 @@ void mexFunction( int nlhs, mxArray *plhs[],
             map[index] = x;
             map[index + nXnY] = y;
             map[index + 2 * nXnY] = 0;
+            if (jacobian){
+                /* x increases with the column, y decreases with the row*/
+                map[index + 3 * nXnY] = dx;
+                map[index + 4 * nXnY] = 0;
+                map[index + 5 * nXnY] = 0;
+                map[index + 6 * nXnY] = -dy;
+            }
             index+=1;
             y -= dy;
         }
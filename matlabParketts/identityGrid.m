@@ -0,0 +1,44 @@
+% identityGrid: the grid of an identity map, without creating the map
+% grid = identityGrid(mPixels, xMin, xMax, yMin, yMax);
+% grid = identityGrid(mPixels, xMin, xMax, yMin);
+% grid = identityGrid(mPixels, xMin, xMax);
+% grid = identityGrid(mPixels, xMin);
+% grid = identityGrid(mPixels);
+% grid = identityGrid();
+%
+% same arguments and defaults as createIdentityMap, the same size, and the same
+% pixel coordinates up to the accumulated rounding of createIdentityMap (it adds dx
+% and dy pixel after pixel in single precision, up to some 0.1 * dx for large maps)
+% returns the double vector [nY, nX, xMin, dx, yMax, dy]
+% for pixel (k,j) x = xMin + (j - 0.5) * dx and y = yMax - (k - 0.5) * dy (matlab indices)
+%
+% mappedMap takes a grid, it writes the identity map into its file band by band,
+% without making the whole map in memory, for example
+% handle = mappedMap('create', 'large.map', identityGrid(2000, -1, 1));
+% see gridMap.h, the map kernels of this folder take maps, not grids
+
+function grid = identityGrid(mPixels, xMin, xMax, yMin, yMax)
+    if nargin < 1
+        mPixels = 1;
+    end
+    if nargin < 2
+        xMin = -1;
+    end
+    if nargin < 3
+        xMax = -xMin;
+    end
+    if nargin < 4
+        yMin = xMin;
+    end
+    if nargin < 5
+        yMax = -yMin;
+    end
+    % sizes as createIdentityMap, in single precision
+    nPixels = single(mPixels) * 1e6;
+    dx = single(xMax) - single(xMin);
+    dy = single(yMax) - single(yMin);
+    dxdy = dx / dy;
+    nX = floor(sqrt(nPixels * dxdy));
+    nY = floor(sqrt(nPixels / dxdy));
+    grid = double([nY, nX, xMin, dx / nX, yMax, dy / nY]);
+end
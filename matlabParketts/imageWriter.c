@@ -0,0 +1,668 @@
+/*==========================================================
+ * imageWriter: write large uint8 images as PNG or TIFF,
+ * row by row as they are rendered, the strips are compressed in parallel
+ *
+ * imageWriter(fileName, image);
+ *     writes the whole image at once, as imwrite(image, fileName)
+ *
+ * writer = imageWriter('open', fileName, height, width, channels);
+ * writer = imageWriter('open', fileName, height, width, channels, 'bigtiff');
+ * imageWriter('write', writer, rows);
+ * imageWriter('close', writer);
+ *     writes an image of size (height, width, channels) in parts,
+ *     rows is a uint8 array of size (nRows, width, channels) with the next rows,
+ *     the full image has never to be in memory, see writeLargeImage.m
+ *
+ * Input:
+ * fileName: ending with .png, .tif or .tiff
+ * channels: 1 (gray), 2 (gray and alpha), 3 (RGB) or 4 (RGB and alpha)
+ * 'bigtiff': write a BigTIFF file, done anyway if the image may exceed 4 GB
+ *
+ * returns for 'open' the handle of the writer, a number
+ *
+ * the rows are collected into strips of STRIP_ROWS rows,
+ * each strip is compressed on its own (deflate), all strips of a 'write' in parallel
+ *     PNG: the strips are parts of one deflate stream ending with a flush,
+ *          each row with the best of the filters none, sub, up and paeth
+ *     TIFF: a deflate compressed strip each, horizontal predictor
+ * rows missing at 'close' are black
+ *
+ * compile with zlib and openMP (see compile.m):
+ * mex CFLAGS='$CFLAGS -fopenmp' LDFLAGS='$LDFLAGS -fopenmp' imageWriter.c -lz
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <zlib.h>
+#define MAX_WRITERS 16
+#define STRIP_ROWS 64
+#define COMPRESSION_LEVEL 6
+/* larger images may exceed 4 GB, they are written as BigTIFF*/
+#define BIGTIFF_SIZE 3900000000.0
+
+enum fileFormat {PNG, TIFF};
+
+typedef struct {
+    bool isOpen;
+    FILE *file;
+    enum fileFormat format;
+    bool bigTiff;
+    int height, width, channels, rowBytes;
+    /* rows written to the file and rows waiting for a full strip*/
+    int rowsDone, rowsWaiting;
+    uint8_t *waiting;
+    /* PNG: the last row of the preceding strip for the filters, adler32 of all data*/
+    uint8_t *previousRow;
+    uLong adler;
+    /* TIFF: positions and lengths of the strips, position in the file*/
+    uint64_t *stripOffsets, *stripByteCounts;
+    int nStrips;
+    uint64_t position;
+} writer;
+
+static writer writers[MAX_WRITERS];
+static bool hasExitFunction = false;
+
+static void freeWriter(writer *w)
+{
+    if (w->isOpen) {
+        mexUnlock();
+    }
+    if (w->file != NULL) {
+        fclose(w->file);
+    }
+    if (w->waiting != NULL) {
+        mxFree(w->waiting);
+    }
+    if (w->previousRow != NULL) {
+        mxFree(w->previousRow);
+    }
+    if (w->stripOffsets != NULL) {
+        mxFree(w->stripOffsets);
+    }
+    if (w->stripByteCounts != NULL) {
+        mxFree(w->stripByteCounts);
+    }
+    memset(w, 0, sizeof(writer));
+}
+
+/* unfinished files are closed when matlab clears the mex file*/
+static void freeWriters(void)
+{
+    int i;
+    for (i = 0; i < MAX_WRITERS; i++){
+        if (writers[i].isOpen) {
+            freeWriter(&writers[i]);
+        }
+    }
+}
+
+static void *persistentMalloc(size_t size)
+{
+    void *memory = mxCalloc(size, 1);
+    mexMakeMemoryPersistent(memory);
+    return memory;
+}
+
+/* write bytes and keep track of the position*/
+static void writeBytes(writer *w, const void *bytes, size_t n)
+{
+    if (fwrite(bytes, 1, n, w->file) != n) {
+        freeWriter(w);
+        mexErrMsgIdAndTxt("imageWriter:write","Could not write the file.");
+    }
+    w->position += n;
+}
+
+static void putBigEndian32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t) (value >> 24);
+    bytes[1] = (uint8_t) (value >> 16);
+    bytes[2] = (uint8_t) (value >> 8);
+    bytes[3] = (uint8_t) value;
+}
+
+static void putLittleEndian(uint8_t *bytes, uint64_t value, int n)
+{
+    int i;
+    for (i = 0; i < n; i++){
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/* PNG chunk: length, type, data, crc of type and data*/
+static void writeChunk(writer *w, const char *type, const uint8_t *data, uint32_t length)
+{
+    uint8_t bytes[4];
+    uLong crc;
+    putBigEndian32(bytes, length);
+    writeBytes(w, bytes, 4);
+    writeBytes(w, type, 4);
+    crc = crc32(0, (const Bytef *) type, 4);
+    /* crc32 of NULL is the initial value, not the crc*/
+    if (length > 0) {
+        writeBytes(w, data, length);
+        crc = crc32(crc, data, length);
+    }
+    putBigEndian32(bytes, (uint32_t) crc);
+    writeBytes(w, bytes, 4);
+}
+
+static uint8_t paeth(int a, int b, int c)
+{
+    int p, pa, pb, pc;
+    p = a + b - c;
+    pa = abs(p - a);
+    pb = abs(p - b);
+    pc = abs(p - c);
+    return (uint8_t) (((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c);
+}
+
+/* PNG: filter a row into filtered (filter type byte and the row),
+ * chooses the filter with the smallest sum of absolute values, as libpng*/
+static void filterRow(const uint8_t *row, const uint8_t *previous, int rowBytes, int bpp, uint8_t *filtered, uint8_t *candidate)
+{
+    int type, i, best;
+    long sum, bestSum;
+    uint8_t left, up, upLeft, value;
+    bestSum = -1;
+    best = 0;
+    for (type = 0; type < 5; type++){
+        /* the average filter rarely wins*/
+        if (type == 3) {
+            continue;
+        }
+        sum = 0;
+        for (i = 0; i < rowBytes; i++){
+            left = (i >= bpp) ? row[i - bpp] : 0;
+            up = previous[i];
+            upLeft = (i >= bpp) ? previous[i - bpp] : 0;
+            switch (type) {
+                case 0:
+                    value = row[i];
+                    break;
+                case 1:
+                    value = row[i] - left;
+                    break;
+                case 2:
+                    value = row[i] - up;
+                    break;
+                default:
+                    value = row[i] - paeth(left, up, upLeft);
+                    break;
+            }
+            candidate[i] = value;
+            sum += (value < 128) ? value : 256 - value;
+        }
+        if ((bestSum < 0) || (sum < bestSum)) {
+            bestSum = sum;
+            best = type;
+            memcpy(filtered + 1, candidate, rowBytes);
+        }
+    }
+    filtered[0] = (uint8_t) best;
+}
+
+/* TIFF: horizontal predictor, differences to the pixel on the left*/
+static void predictRow(uint8_t *row, int rowBytes, int bpp)
+{
+    int i;
+    for (i = rowBytes - 1; i >= bpp; i--){
+        row[i] -= row[i - bpp];
+    }
+}
+
+/* compress a strip, PNG: raw deflate with a flush at the end, TIFF: a zlib stream
+ * returns the length of the compressed strip, 0 for failure*/
+static uLong compressStrip(const uint8_t *data, uLong length, uint8_t *compressed, uLong bound, bool isPng)
+{
+    z_stream stream;
+    uLong n;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED, isPng ? -15 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+    stream.next_in = (Bytef *) data;
+    stream.avail_in = (uInt) length;
+    stream.next_out = compressed;
+    stream.avail_out = (uInt) bound;
+    if (deflate(&stream, isPng ? Z_SYNC_FLUSH : Z_FINISH) == Z_STREAM_ERROR) {
+        deflateEnd(&stream);
+        return 0;
+    }
+    n = bound - stream.avail_out;
+    deflateEnd(&stream);
+    return (stream.avail_in == 0) ? n : 0;
+}
+
+/* compress and write the first nRows of rows, row major and interleaved*/
+static void writeStrips(writer *w, uint8_t *rows, int nRows)
+{
+    int nStrips, strip, row, first, stripRows, bpp;
+    bool isPng, failed;
+    uLong *lengths, *compressedLengths, *adlers, bound;
+    uint8_t **stripData, **compressed, *candidate;
+    if (nRows <= 0) {
+        return;
+    }
+    isPng = (w->format == PNG);
+    bpp = w->channels;
+    nStrips = (nRows + STRIP_ROWS - 1) / STRIP_ROWS;
+    lengths = (uLong *) mxMalloc(nStrips * sizeof(uLong));
+    compressedLengths = (uLong *) mxMalloc(nStrips * sizeof(uLong));
+    adlers = (uLong *) mxMalloc(nStrips * sizeof(uLong));
+    stripData = (uint8_t **) mxMalloc(nStrips * sizeof(uint8_t *));
+    compressed = (uint8_t **) mxMalloc(nStrips * sizeof(uint8_t *));
+    /* matlab memory is not thread safe, get it before*/
+    for (strip = 0; strip < nStrips; strip++){
+        stripRows = ((strip + 1) * STRIP_ROWS <= nRows) ? STRIP_ROWS : nRows - strip * STRIP_ROWS;
+        lengths[strip] = (uLong) stripRows * (w->rowBytes + (isPng ? 1 : 0));
+        bound = compressBound(lengths[strip]) + 64;
+        stripData[strip] = isPng ? (uint8_t *) mxMalloc(lengths[strip]) : rows + (size_t) strip * STRIP_ROWS * w->rowBytes;
+        compressed[strip] = (uint8_t *) mxMalloc(bound);
+    }
+    candidate = (uint8_t *) mxMalloc((size_t) nStrips * w->rowBytes);
+    failed = false;
+#pragma omp parallel for private(stripRows, first, row, bound) schedule(dynamic)
+    for (strip = 0; strip < nStrips; strip++){
+        first = strip * STRIP_ROWS;
+        stripRows = ((strip + 1) * STRIP_ROWS <= nRows) ? STRIP_ROWS : nRows - first;
+        for (row = first; row < first + stripRows; row++){
+            if (isPng) {
+                filterRow(rows + (size_t) row * w->rowBytes,
+                        (row > 0) ? rows + (size_t) (row - 1) * w->rowBytes : w->previousRow,
+                        w->rowBytes, bpp, stripData[strip] + (size_t) (row - first) * (w->rowBytes + 1),
+                        candidate + (size_t) strip * w->rowBytes);
+            }
+        }
+        if (isPng) {
+            adlers[strip] = adler32(adler32(0, NULL, 0), stripData[strip], (uInt) lengths[strip]);
+        } else {
+            /* the predictor works in place, rows are a copy*/
+            for (row = first; row < first + stripRows; row++){
+                predictRow(rows + (size_t) row * w->rowBytes, w->rowBytes, bpp);
+            }
+        }
+        bound = compressBound(lengths[strip]) + 64;
+        compressedLengths[strip] = compressStrip(stripData[strip], lengths[strip], compressed[strip], bound, isPng);
+        if (compressedLengths[strip] == 0) {
+            failed = true;
+        }
+    }
+    if (!failed) {
+        /* write the strips in order*/
+        for (strip = 0; strip < nStrips; strip++){
+            if (isPng) {
+                writeChunk(w, "IDAT", compressed[strip], (uint32_t) compressedLengths[strip]);
+                w->adler = adler32_combine(w->adler, adlers[strip], (z_off_t) lengths[strip]);
+            } else {
+                w->stripOffsets[w->nStrips] = w->position;
+                w->stripByteCounts[w->nStrips] = compressedLengths[strip];
+                w->nStrips++;
+                writeBytes(w, compressed[strip], compressedLengths[strip]);
+            }
+        }
+        if (isPng) {
+            memcpy(w->previousRow, rows + (size_t) (nRows - 1) * w->rowBytes, w->rowBytes);
+        }
+        w->rowsDone += nRows;
+    }
+    for (strip = 0; strip < nStrips; strip++){
+        if (isPng) {
+            mxFree(stripData[strip]);
+        }
+        mxFree(compressed[strip]);
+    }
+    mxFree(candidate);
+    mxFree(stripData);
+    mxFree(compressed);
+    mxFree(lengths);
+    mxFree(compressedLengths);
+    mxFree(adlers);
+    if (failed) {
+        freeWriter(w);
+        mexErrMsgIdAndTxt("imageWriter:compress","Compression failed.");
+    }
+}
+
+/* append rows of a matlab array (nRows, width, channels), writes all full strips*/
+static void addRows(writer *w, const uint8_t *image, int nRows)
+{
+    int nAll, nFull, row, column, channel, k;
+    uint8_t *rows, *target;
+    const uint8_t *source;
+    int planeSize = nRows * w->width;
+    if (w->rowsDone + w->rowsWaiting + nRows > w->height) {
+        mexErrMsgIdAndTxt("imageWriter:rows","More rows than the height of the image.");
+    }
+    nAll = w->rowsWaiting + nRows;
+    /* the last strip may be shorter*/
+    nFull = (w->rowsDone + nAll == w->height) ? nAll : (nAll / STRIP_ROWS) * STRIP_ROWS;
+    rows = (uint8_t *) mxMalloc((size_t) nAll * w->rowBytes);
+    memcpy(rows, w->waiting, (size_t) w->rowsWaiting * w->rowBytes);
+    /* interleave, matlab images are column first*/
+#pragma omp parallel for private(column, channel, k, target, source) if (nRows * w->width > 100000)
+    for (row = 0; row < nRows; row++){
+        target = rows + (size_t) (w->rowsWaiting + row) * w->rowBytes;
+        for (channel = 0; channel < w->channels; channel++){
+            source = image + row + (size_t) channel * planeSize;
+            for (column = 0, k = channel; column < w->width; column++, k += w->channels){
+                target[k] = source[(size_t) column * nRows];
+            }
+        }
+    }
+    writeStrips(w, rows, nFull);
+    w->rowsWaiting = nAll - nFull;
+    memcpy(w->waiting, rows + (size_t) nFull * w->rowBytes, (size_t) w->rowsWaiting * w->rowBytes);
+    mxFree(rows);
+}
+
+static bool endsWith(const char *name, const char *ending)
+{
+    size_t n = strlen(name), m = strlen(ending);
+    return (n >= m) && (strcmp(name + n - m, ending) == 0);
+}
+
+/* open the file and write the header, returns the handle*/
+static int openWriter(const char *fileName, int height, int width, int channels, bool bigTiff)
+{
+    int handle, maxStrips;
+    writer *w;
+    uint8_t header[16];
+    if (!hasExitFunction) {
+        mexAtExit(freeWriters);
+        hasExitFunction = true;
+    }
+    if ((height < 1) || (width < 1) || (channels < 1) || (channels > 4)) {
+        mexErrMsgIdAndTxt("imageWriter:size","Height and width have to be positive, channels 1 to 4.");
+    }
+    for (handle = 0; handle < MAX_WRITERS; handle++){
+        if (!writers[handle].isOpen) {
+            break;
+        }
+    }
+    if (handle == MAX_WRITERS) {
+        mexErrMsgIdAndTxt("imageWriter:open","Too many open writers, maximum 16.");
+    }
+    w = &writers[handle];
+    memset(w, 0, sizeof(writer));
+    if (endsWith(fileName, ".png") || endsWith(fileName, ".PNG")) {
+        w->format = PNG;
+    } else if (endsWith(fileName, ".tif") || endsWith(fileName, ".tiff") || endsWith(fileName, ".TIF") || endsWith(fileName, ".TIFF")) {
+        w->format = TIFF;
+    } else {
+        mexErrMsgIdAndTxt("imageWriter:fileName","The file name has to end with .png, .tif or .tiff.");
+    }
+    w->file = fopen(fileName, "wb");
+    if (w->file == NULL) {
+        mexErrMsgIdAndTxt("imageWriter:open","Could not open the file.");
+    }
+    /* clear imageWriter does not lose open writers*/
+    mexLock();
+    w->isOpen = true;
+    w->height = height;
+    w->width = width;
+    w->channels = channels;
+    w->rowBytes = width * channels;
+    w->waiting = (uint8_t *) persistentMalloc((size_t) STRIP_ROWS * w->rowBytes);
+    if (w->format == PNG) {
+        static const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+        static const uint8_t colorTypes[5] = {0, 0, 4, 2, 6};
+        /* the zlib header of the deflate stream, it goes on in the IDAT chunks of the strips*/
+        static const uint8_t zlibHeader[2] = {0x78, 0x9C};
+        w->previousRow = (uint8_t *) persistentMalloc(w->rowBytes);
+        w->adler = adler32(0, NULL, 0);
+        writeBytes(w, signature, 8);
+        putBigEndian32(header, width);
+        putBigEndian32(header + 4, height);
+        header[8] = 8;
+        header[9] = colorTypes[channels];
+        header[10] = 0;
+        header[11] = 0;
+        header[12] = 0;
+        writeChunk(w, "IHDR", header, 13);
+        writeChunk(w, "IDAT", zlibHeader, 2);
+    } else {
+        w->bigTiff = bigTiff || ((double) height * w->rowBytes > BIGTIFF_SIZE);
+        maxStrips = (height + STRIP_ROWS - 1) / STRIP_ROWS;
+        w->stripOffsets = (uint64_t *) persistentMalloc(maxStrips * sizeof(uint64_t));
+        w->stripByteCounts = (uint64_t *) persistentMalloc(maxStrips * sizeof(uint64_t));
+        /* little endian, the offset of the directory follows at 'close'*/
+        memset(header, 0, sizeof(header));
+        header[0] = 'I';
+        header[1] = 'I';
+        if (w->bigTiff) {
+            header[2] = 43;
+            header[4] = 8;
+            writeBytes(w, header, 16);
+        } else {
+            header[2] = 42;
+            writeBytes(w, header, 8);
+        }
+    }
+    return handle;
+}
+
+/* TIFF: one entry of the image file directory, values that fit are in the entry*/
+static int putEntry(uint8_t *entry, bool bigTiff, int tag, int type, uint64_t count, uint64_t value)
+{
+    int valueBytes = bigTiff ? 8 : 4;
+    putLittleEndian(entry, tag, 2);
+    putLittleEndian(entry + 2, type, 2);
+    putLittleEndian(entry + 4, count, valueBytes);
+    memset(entry + 4 + valueBytes, 0, valueBytes);
+    /* SHORT values are left justified*/
+    if ((type == 3) && (count == 1)) {
+        putLittleEndian(entry + 4 + valueBytes, value, 2);
+    } else {
+        putLittleEndian(entry + 4 + valueBytes, value, valueBytes);
+    }
+    return 4 + 2 * valueBytes;
+}
+
+/* TIFF: write the strip tables and the directory, then its offset into the header*/
+static void writeDirectory(writer *w)
+{
+    uint8_t *bytes, directory[20 * 12 + 32];
+    uint64_t offsetsPosition, countsPosition, bitsPosition, directoryPosition;
+    int i, n, nEntries, offsetType, valueBytes;
+    bool big = w->bigTiff;
+    /* the strip tables, LONG8 (16) for BigTIFF, LONG (4) for TIFF*/
+    valueBytes = big ? 8 : 4;
+    offsetType = big ? 16 : 4;
+    if (!big && (w->position > 0xFFFFFFF0u)) {
+        freeWriter(w);
+        mexErrMsgIdAndTxt("imageWriter:size","The file exceeds 4 GB, use 'bigtiff'.");
+    }
+    if ((w->position & 1) != 0) {
+        /* word boundary*/
+        writeBytes(w, "", 1);
+    }
+    bytes = (uint8_t *) mxMalloc((size_t) w->nStrips * valueBytes + 8);
+    offsetsPosition = w->position;
+    for (i = 0; i < w->nStrips; i++){
+        putLittleEndian(bytes + i * valueBytes, w->stripOffsets[i], valueBytes);
+    }
+    writeBytes(w, bytes, (size_t) w->nStrips * valueBytes);
+    countsPosition = w->position;
+    for (i = 0; i < w->nStrips; i++){
+        putLittleEndian(bytes + i * valueBytes, w->stripByteCounts[i], valueBytes);
+    }
+    writeBytes(w, bytes, (size_t) w->nStrips * valueBytes);
+    mxFree(bytes);
+    bitsPosition = w->position;
+    for (i = 0; i < w->channels; i++){
+        putLittleEndian(directory + 2 * i, 8, 2);
+    }
+    writeBytes(w, directory, 2 * w->channels);
+    if ((w->position & 1) != 0) {
+        writeBytes(w, "", 1);
+    }
+    directoryPosition = w->position;
+    /* entries sorted by tag, a single strip has its offset and count in the entry*/
+    nEntries = (w->channels == 2) || (w->channels == 4) ? 12 : 11;
+    n = big ? 8 : 2;
+    putLittleEndian(directory, nEntries, n);
+    n += putEntry(directory + n, big, 256, 4, 1, w->width);
+    n += putEntry(directory + n, big, 257, 4, 1, w->height);
+    if (w->channels == 1) {
+        n += putEntry(directory + n, big, 258, 3, 1, 8);
+    } else if (2 * w->channels <= valueBytes) {
+        n += putEntry(directory + n, big, 258, 3, w->channels, 0x0008000800080008ull);
+    } else {
+        n += putEntry(directory + n, big, 258, 3, w->channels, bitsPosition);
+    }
+    n += putEntry(directory + n, big, 259, 3, 1, 8);
+    n += putEntry(directory + n, big, 262, 3, 1, (w->channels >= 3) ? 2 : 1);
+    n += putEntry(directory + n, big, 273, offsetType, w->nStrips, (w->nStrips == 1) ? w->stripOffsets[0] : offsetsPosition);
+    n += putEntry(directory + n, big, 277, 3, 1, w->channels);
+    n += putEntry(directory + n, big, 278, 4, 1, STRIP_ROWS);
+    n += putEntry(directory + n, big, 279, offsetType, w->nStrips, (w->nStrips == 1) ? w->stripByteCounts[0] : countsPosition);
+    n += putEntry(directory + n, big, 284, 3, 1, 1);
+    n += putEntry(directory + n, big, 317, 3, 1, 2);
+    if ((w->channels == 2) || (w->channels == 4)) {
+        /* unassociated alpha*/
+        n += putEntry(directory + n, big, 338, 3, 1, 2);
+    }
+    /* no next directory*/
+    memset(directory + n, 0, valueBytes);
+    n += valueBytes;
+    writeBytes(w, directory, n);
+    /* the offset of the directory into the header*/
+    putLittleEndian(directory, directoryPosition, valueBytes);
+    if ((fseek(w->file, big ? 8 : 4, SEEK_SET) != 0) || (fwrite(directory, 1, valueBytes, w->file) != (size_t) valueBytes)) {
+        freeWriter(w);
+        mexErrMsgIdAndTxt("imageWriter:write","Could not write the file.");
+    }
+}
+
+/* write missing rows and the end of the file*/
+static void closeWriter(writer *w)
+{
+    uint8_t *black, end[6];
+    int nRows;
+    /* missing rows are black*/
+    if (w->rowsDone + w->rowsWaiting < w->height) {
+        mexWarnMsgIdAndTxt("imageWriter:rows","Only %d of %d rows written, the rest is black.",
+                w->rowsDone + w->rowsWaiting, w->height);
+        nRows = w->height - w->rowsDone - w->rowsWaiting;
+        black = (uint8_t *) mxCalloc((size_t) nRows * w->rowBytes, 1);
+        addRows(w, black, nRows);
+        mxFree(black);
+    }
+    if (w->format == PNG) {
+        /* an empty final block ends the deflate stream, then adler32 of the data*/
+        end[0] = 0x03;
+        end[1] = 0x00;
+        putBigEndian32(end + 2, (uint32_t) w->adler);
+        writeChunk(w, "IDAT", end, 6);
+        writeChunk(w, "IEND", NULL, 0);
+    } else {
+        writeDirectory(w);
+    }
+    if (fclose(w->file) != 0) {
+        w->file = NULL;
+        freeWriter(w);
+        mexErrMsgIdAndTxt("imageWriter:write","Could not write the file.");
+    }
+    w->file = NULL;
+    freeWriter(w);
+}
+
+/* check the rows for the writer*/
+static void checkRows(const writer *w, const mxArray *rows)
+{
+    const mwSize *dims = mxGetDimensions(rows);
+    int channels = (mxGetNumberOfDimensions(rows) > 2) ? dims[2] : 1;
+    if (!mxIsUint8(rows) || (mxGetNumberOfDimensions(rows) > 3) || ((int) dims[1] != w->width) || (channels != w->channels)) {
+        mexErrMsgIdAndTxt("imageWriter:rows","The rows have to be uint8 of size (nRows, width, channels).");
+    }
+}
+
+static writer *getWriter(const mxArray *handle)
+{
+    int i = (int) mxGetScalar(handle) - 1;
+    if ((i < 0) || (i >= MAX_WRITERS) || !writers[i].isOpen) {
+        mexErrMsgIdAndTxt("imageWriter:handle","This writer is not open.");
+    }
+    return &writers[i];
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    char command[16], fileName[4096], option[16];
+    const mwSize *dims;
+    int handle, channels;
+    bool bigTiff;
+    writer *w;
+    uint8_t *image;
+    /* check for proper number of arguments (else crash)*/
+    if ((nrhs < 2) || !mxIsChar(prhs[0])) {
+        mexErrMsgIdAndTxt("imageWriter:nrhs","A file name and an image, or a command 'open', 'write' or 'close' required.");
+    }
+    if (mxGetString(prhs[0], command, sizeof(command)) != 0) {
+        strcpy(command, "");
+    }
+    if (strcmp(command, "open") == 0) {
+        if ((nrhs < 5) || !mxIsChar(prhs[1]) || (mxGetString(prhs[1], fileName, sizeof(fileName)) != 0)) {
+            mexErrMsgIdAndTxt("imageWriter:nrhs","'open' needs a file name, height, width and channels.");
+        }
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("imageWriter:nlhs","'open' returns one writer.");
+        }
+        bigTiff = false;
+        if (nrhs > 5) {
+            bigTiff = mxIsChar(prhs[5]) && (mxGetString(prhs[5], option, sizeof(option)) == 0) && (strcmp(option, "bigtiff") == 0);
+        }
+        handle = openWriter(fileName, (int) mxGetScalar(prhs[2]), (int) mxGetScalar(prhs[3]), (int) mxGetScalar(prhs[4]), bigTiff);
+        plhs[0] = mxCreateDoubleScalar(handle + 1);
+    } else if (strcmp(command, "write") == 0) {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("imageWriter:nrhs","'write' needs a writer and rows.");
+        }
+        if (nlhs > 0) {
+            mexErrMsgIdAndTxt("imageWriter:nlhs","'write' returns nothing.");
+        }
+        w = getWriter(prhs[1]);
+        checkRows(w, prhs[2]);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        image = mxGetUint8s(prhs[2]);
+#else
+        image = (uint8_t *) mxGetData(prhs[2]);
+#endif
+        addRows(w, image, mxGetDimensions(prhs[2])[0]);
+    } else if (strcmp(command, "close") == 0) {
+        if (nlhs > 0) {
+            mexErrMsgIdAndTxt("imageWriter:nlhs","'close' returns nothing.");
+        }
+        closeWriter(getWriter(prhs[1]));
+    } else {
+        /* the whole image at once*/
+        if (nlhs > 0) {
+            mexErrMsgIdAndTxt("imageWriter:nlhs","Writing an image returns nothing.");
+        }
+        if (mxGetString(prhs[0], fileName, sizeof(fileName)) != 0) {
+            mexErrMsgIdAndTxt("imageWriter:fileName","The file name is too long.");
+        }
+        if (!mxIsUint8(prhs[1]) || (mxGetNumberOfDimensions(prhs[1]) > 3)) {
+            mexErrMsgIdAndTxt("imageWriter:image","The image has to be uint8 of size (height, width, channels).");
+        }
+        dims = mxGetDimensions(prhs[1]);
+        channels = (mxGetNumberOfDimensions(prhs[1]) > 2) ? dims[2] : 1;
+        handle = openWriter(fileName, dims[0], dims[1], channels, false);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        image = mxGetUint8s(prhs[1]);
+#else
+        image = (uint8_t *) mxGetData(prhs[1]);
+#endif
+        addRows(&writers[handle], image, dims[0]);
+        closeWriter(&writers[handle]);
+    }
+}
@@ -0,0 +1,310 @@
+/*==========================================================
+ * jobSocket: local unix domain sockets for the render daemon,
+ * jobs as lines of JSON, results as a line of JSON and raw bytes
+ *
+ * server = jobSocket('listen', socketPath);
+ *     the socket file is only for this user (mode 0600)
+ * client = jobSocket('accept', server, timeout);
+ *     waits at most timeout seconds for a connection, client = 0 if none
+ * client = jobSocket('connect', socketPath);
+ * line = jobSocket('receive', client);
+ *     a line of text without the newline, waits at most RECEIVE_TIMEOUT seconds
+ * bytes = jobSocket('receive', client, nBytes);
+ *     nBytes bytes as uint8 column vector
+ * jobSocket('send', client, data);
+ *     data: char (sent as is, add newline for lines) or uint8 of any size
+ * jobSocket('close', handle);
+ *     closes a server (and removes the socket file) or a client
+ *
+ * handles are numbers, open sockets keep the mex file in memory
+ * see renderDaemon.m and renderRequest.m
+ *
+ * for linux and macOS
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#define MAX_SOCKETS 64
+#define MAX_LINE 1048576
+#define RECEIVE_TIMEOUT 60
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct {
+    bool isOpen, isServer;
+    int socket;
+    char path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+} jobSocketSlot;
+
+static jobSocketSlot sockets[MAX_SOCKETS];
+static bool hasExitFunction = false;
+
+static void freeSocket(jobSocketSlot *s)
+{
+    if (!s->isOpen) {
+        return;
+    }
+    close(s->socket);
+    if (s->isServer) {
+        unlink(s->path);
+    }
+    s->isOpen = false;
+    mexUnlock();
+}
+
+/* open sockets are closed when matlab clears the mex file*/
+static void freeSockets(void)
+{
+    int i;
+    for (i = 0; i < MAX_SOCKETS; i++){
+        freeSocket(&sockets[i]);
+    }
+}
+
+/* a slot for a new socket, returns the handle (1 ...)*/
+static int newSocket(int socket, bool isServer, const char *path)
+{
+    int i;
+    if (!hasExitFunction) {
+        mexAtExit(freeSockets);
+        hasExitFunction = true;
+    }
+    for (i = 0; i < MAX_SOCKETS; i++){
+        if (!sockets[i].isOpen) {
+            break;
+        }
+    }
+    if (i == MAX_SOCKETS) {
+        close(socket);
+        mexErrMsgIdAndTxt("jobSocket:open","Too many open sockets, maximum 64.");
+    }
+    sockets[i].isOpen = true;
+    sockets[i].isServer = isServer;
+    sockets[i].socket = socket;
+    strcpy(sockets[i].path, path);
+    /* clear jobSocket does not lose open sockets*/
+    mexLock();
+    return i + 1;
+}
+
+static jobSocketSlot *getSocket(const mxArray *handle, bool isServer)
+{
+    int i = (int) mxGetScalar(handle) - 1;
+    if ((i < 0) || (i >= MAX_SOCKETS) || !sockets[i].isOpen || (sockets[i].isServer != isServer)) {
+        mexErrMsgIdAndTxt("jobSocket:handle", isServer ? "This server is not open." : "This client is not open.");
+    }
+    return &sockets[i];
+}
+
+/* the address of a socket file*/
+static void getAddress(const mxArray *path, struct sockaddr_un *address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (!mxIsChar(path) || (mxGetString(path, address->sun_path, sizeof(address->sun_path)) != 0)) {
+        mexErrMsgIdAndTxt("jobSocket:path","The socket path has to be a string of less than %d characters.",
+                (int) sizeof(address->sun_path));
+    }
+}
+
+/* wait until data can be read, false at timeout*/
+static bool waitForInput(int socket, int seconds)
+{
+    struct pollfd p;
+    int result;
+    p.fd = socket;
+    p.events = POLLIN;
+    do {
+        result = poll(&p, 1, 1000 * seconds);
+    } while ((result < 0) && (errno == EINTR));
+    return result > 0;
+}
+
+/* read n bytes, false if the connection ends or at timeout*/
+static bool receiveBytes(int socket, uint8_t *bytes, size_t n)
+{
+    ssize_t got;
+    while (n > 0) {
+        if (!waitForInput(socket, RECEIVE_TIMEOUT)) {
+            return false;
+        }
+        got = recv(socket, bytes, n, 0);
+        if (got <= 0) {
+            if ((got < 0) && (errno == EINTR)) {
+                continue;
+            }
+            return false;
+        }
+        bytes += got;
+        n -= got;
+    }
+    return true;
+}
+
+static bool sendBytes(int socket, const uint8_t *bytes, size_t n)
+{
+    ssize_t sent;
+    while (n > 0) {
+        sent = send(socket, bytes, n, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += sent;
+        n -= sent;
+    }
+    return true;
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    char command[16], *line, *text;
+    struct sockaddr_un address;
+    int s, client, length;
+    size_t n;
+    jobSocketSlot *slot;
+    uint8_t *bytes;
+    /* check for proper number of arguments (else crash)*/
+    if ((nrhs < 2) || !mxIsChar(prhs[0]) || (mxGetString(prhs[0], command, sizeof(command)) != 0)) {
+        mexErrMsgIdAndTxt("jobSocket:nrhs","A command 'listen', 'accept', 'connect', 'receive', 'send' or 'close' and its arguments required.");
+    }
+    if (strcmp(command, "listen") == 0) {
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("jobSocket:nlhs","'listen' returns one socket.");
+        }
+        getAddress(prhs[1], &address);
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s < 0) {
+            mexErrMsgIdAndTxt("jobSocket:listen","Could not make a socket.");
+        }
+        /* a socket file left by a daemon that did not stop*/
+        unlink(address.sun_path);
+        if ((bind(s, (struct sockaddr *) &address, sizeof(address)) != 0)
+                || (chmod(address.sun_path, S_IRUSR | S_IWUSR) != 0) || (listen(s, 8) != 0)) {
+            close(s);
+            mexErrMsgIdAndTxt("jobSocket:listen","Could not listen at %s.", address.sun_path);
+        }
+        plhs[0] = mxCreateDoubleScalar(newSocket(s, true, address.sun_path));
+    } else if (strcmp(command, "accept") == 0) {
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("jobSocket:nlhs","'accept' returns one client.");
+        }
+        slot = getSocket(prhs[1], true);
+        client = 0;
+        if (waitForInput(slot->socket, (nrhs > 2) ? (int) mxGetScalar(prhs[2]) : 0)) {
+            s = accept(slot->socket, NULL, NULL);
+            if (s >= 0) {
+                client = newSocket(s, false, "");
+            }
+        }
+        plhs[0] = mxCreateDoubleScalar(client);
+    } else if (strcmp(command, "connect") == 0) {
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("jobSocket:nlhs","'connect' returns one socket.");
+        }
+        getAddress(prhs[1], &address);
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((s < 0) || (connect(s, (struct sockaddr *) &address, sizeof(address)) != 0)) {
+            if (s >= 0) {
+                close(s);
+            }
+            mexErrMsgIdAndTxt("jobSocket:connect","Could not connect to %s, is the daemon running?", address.sun_path);
+        }
+        plhs[0] = mxCreateDoubleScalar(newSocket(s, false, ""));
+    } else if (strcmp(command, "receive") == 0) {
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("jobSocket:nlhs","'receive' returns one line or array of bytes.");
+        }
+        slot = getSocket(prhs[1], false);
+        if (nrhs > 2) {
+            n = (size_t) mxGetScalar(prhs[2]);
+            plhs[0] = mxCreateNumericMatrix(n, 1, mxUINT8_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+            bytes = mxGetUint8s(plhs[0]);
+#else
+            bytes = (uint8_t *) mxGetData(plhs[0]);
+#endif
+            if (!receiveBytes(slot->socket, bytes, n)) {
+                mexErrMsgIdAndTxt("jobSocket:receive","The connection ended before %.0f bytes.", (double) n);
+            }
+        } else {
+            /* lines are short, read byte by byte not to read beyond the line*/
+            line = (char *) mxMalloc(MAX_LINE + 1);
+            length = 0;
+            while (true) {
+                if (length == MAX_LINE) {
+                    mxFree(line);
+                    mexErrMsgIdAndTxt("jobSocket:receive","The line is too long.");
+                }
+                if (!receiveBytes(slot->socket, (uint8_t *) line + length, 1)) {
+                    mxFree(line);
+                    mexErrMsgIdAndTxt("jobSocket:receive","The connection ended before the end of the line.");
+                }
+                if (line[length] == '\n') {
+                    break;
+                }
+                length++;
+            }
+            line[length] = 0;
+            plhs[0] = mxCreateString(line);
+            mxFree(line);
+        }
+    } else if (strcmp(command, "send") == 0) {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("jobSocket:nrhs","'send' needs a client and data.");
+        }
+        if (nlhs > 0) {
+            mexErrMsgIdAndTxt("jobSocket:nlhs","'send' returns nothing.");
+        }
+        slot = getSocket(prhs[1], false);
+        text = NULL;
+        bytes = NULL;
+        n = 0;
+        if (mxIsChar(prhs[2])) {
+            text = mxArrayToString(prhs[2]);
+            n = strlen(text);
+            bytes = (uint8_t *) text;
+        } else if (mxIsUint8(prhs[2])) {
+            n = mxGetNumberOfElements(prhs[2]);
+#if MX_HAS_INTERLEAVED_COMPLEX
+            bytes = mxGetUint8s(prhs[2]);
+#else
+            bytes = (uint8_t *) mxGetData(prhs[2]);
+#endif
+        } else {
+            mexErrMsgIdAndTxt("jobSocket:send","The data has to be char or uint8.");
+        }
+        if (!sendBytes(slot->socket, bytes, n)) {
+            if (text != NULL) {
+                mxFree(text);
+            }
+            mexErrMsgIdAndTxt("jobSocket:send","Could not send, the connection has ended.");
+        }
+        if (text != NULL) {
+            mxFree(text);
+        }
+    } else if (strcmp(command, "close") == 0) {
+        if (nlhs > 0) {
+            mexErrMsgIdAndTxt("jobSocket:nlhs","'close' returns nothing.");
+        }
+        s = (int) mxGetScalar(prhs[1]) - 1;
+        if ((s >= 0) && (s < MAX_SOCKETS)) {
+            freeSocket(&sockets[s]);
+        }
+    } else {
+        mexErrMsgIdAndTxt("jobSocket:command","Unknown command, use 'listen', 'accept', 'connect', 'receive', 'send' or 'close'.");
+    }
+}
@@ -0,0 +1,14 @@
+% loadMap: load a map saved by saveMap
+% map = loadMap(fileName);
+%
+% returns exactly the map given to saveMap
+
+function map = loadMap(fileName)
+    file = fopen(fileName, 'r');
+    if file < 0
+        error('loadMap:open', 'Could not open %s.', fileName);
+    end
+    packed = fread(file, Inf, '*uint8');
+    fclose(file);
+    map = unpackMap(packed);
+end
@@ -1,5 +1,6 @@
 % makeOutputImageFitMapToInput: create an image using a map and an input image
 % outputImage = makeOutputImageFitMapToInput(map, inputImage);
+% outputImage = makeOutputImageFitMapToInput(map, inputImage, filter);
 % invalid pixels will have black color
 % use imshow(outputImage) to show the image
 % use imwrite(outputImage,'imageName.jpg'); to save the image in the
@@ -8,9 +9,14 @@
 % the (x,y)-coordinates of the map are shifted and scaled 
 % to fit closely the input image
 
+% optional filter for sampleImage: 'linear', 'mip' or 'aniso'
+% 'mip' and 'aniso' avoid aliasing where the map compresses the input image,
+% without filter interp2 is used
+% a map with jacobian (7 layers) gives the exact footprint for 'mip' and 'aniso'
+
 % the map remains unchanged
 
-function outputImage = makeOutputImageFitMapToInput(map,inputImage)
+function outputImage = makeOutputImageFitMapToInput(map,inputImage,filter)
     % determine input image sizes
     [inputHeight, inputWidth, imageLayers] = size(inputImage);
     % size of the output image: same as the map
@@ -32,6 +38,14 @@ function outputImage = makeOutputImageFitMapToInput(map,inputImage)
     x = scale * x + offsetX;
     y = scale * y + offsetY;       
     % create the output image
+    if nargin > 2
+        if size(map, 3) == 7
+            outputImage = sampleImage(inputImage, x, y, filter, scale * map(:,:,4:7));
+        else
+            outputImage = sampleImage(inputImage, x, y, filter);
+        end
+        return
+    end
     outputImage = zeros(outputHeight, outputWidth, imageLayers, 'uint8');
     for k = 1:imageLayers 
         outputImage(:,:,k) = uint8(interp2(single(inputImage(:,:,k)), x, y, 'linear', 0)); 
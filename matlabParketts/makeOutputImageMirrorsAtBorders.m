@@ -1,29 +1,28 @@
 % makeOutputImageFitMapToInput: create an image using a map and an input image
 % outputImage = makeOutputImageMirrorsAtBorders(map, inputImage);
+% outputImage = makeOutputImageMirrorsAtBorders(map, inputImage, filter);
 % invalid pixels will have black color
 % use imshow(outputImage) to show the image
 % use imwrite(outputImage,'imageName.jpg'); to save the image in the
 % current folder
 
 % the (x,y)-coordinates of the map are mirrored to stay inside the
-% input image: 1 <= x < width of input image, 1 <= y < height of input image
+% input image: 1 <= x <= width of input image, 1 <= y <= height of input image
+% sampleImage mirrors while it reads the pixels, no extra pass with mirrorsMap
+% filter: 'linear' (default), 'mip' or 'aniso', see sampleImage
 
 % the map remains unchanged
 
-function outputImage = makeOutputImageMirrorsAtBorders(map,inputImage)
-    % determine input image sizes
-    [inputHeight, inputWidth, imageLayers] = size(inputImage);
-    % size of the output image: same as the map
-    [outputHeight, outputWidth] = size(map, [1, 2]);
-    % create the limited map
-    limitedMap = mirrorsMap(map, inputWidth - 2, inputHeight - 2);
+function outputImage = makeOutputImageMirrorsAtBorders(map,inputImage,filter)
+    if nargin < 3
+        filter = 'linear';
+    end
     % get the (x,y) coordinates of the map
     % add 1 because of matlab indexing
-    x = limitedMap(:,:,1) + 1; 
-    y = limitedMap(:,:,2) + 1;    
+    x = map(:,:,1) + 1;
+    y = map(:,:,2) + 1;
+    % invalid pixels are black
+    x(map(:,:,3) < -0.1) = NaN;
     % create the output image
-    outputImage = zeros(outputHeight, outputWidth, imageLayers, 'uint8');
-    for k = 1:imageLayers 
-        outputImage(:,:,k) = uint8(interp2(single(inputImage(:,:,k)), x, y, 'linear', 0)); 
-    end     
-end
\ No newline at end of file
+    outputImage = sampleImage(inputImage, x, y, filter, [], 'mirror');
+end
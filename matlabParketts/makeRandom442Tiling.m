@@ -25,7 +25,9 @@ y=y*metaStrength;
 numberOfCells=8;
 %======================
 size=2/numberOfCells;
-randomTiling442(tilingMap,size);
+% the seed selects the pattern of random flips, same seed gives same image
+seed=0;
+randomTiling442(tilingMap,size,seed);
 
 % add the modifying map to the tiling map
 tilingMap(:,:,1)=tilingMap(:,:,1)+x(:,:);
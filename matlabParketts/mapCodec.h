@@ -0,0 +1,68 @@
+/*==========================================================
+ * mapCodec.h: the format of packed maps, see packMap and unpackMap
+ *
+ * lossless, unpackMap(packMap(map)) is equal to the map bit by bit
+ *
+ * each layer of the map is cut into blocks of blockColumns columns,
+ * the blocks are packed and unpacked in parallel, each on its own:
+ *     coordinate layers (x, y, and more, as the jacobian):
+ *         the float bits as ordered integers, predicted by linear extrapolation
+ *         of the two values above in the column, the zigzag of the residual
+ *         is split into 4 byte planes, the high bytes are mostly zero
+ *     parity layer (the third): run length coded, (length, float bits) pairs
+ *     then both deflate (zlib)
+ *
+ * a packed map is a uint8 column vector, little endian uint32:
+ *     MAP_CODEC_MAGIC, nY, nX, layers, blockColumns, nBlocks
+ *     then nBlocks * layers sizes of the packed blocks, layer by layer
+ *     then the packed blocks: the length of the unpacked data, then the deflated data
+ *
+ *========================================================*/
+
+#ifndef MAP_CODEC_H
+#define MAP_CODEC_H
+
+#include <stdint.h>
+#include <zlib.h>
+#define MAP_CODEC_MAGIC 0x314B504D
+#define MAP_CODEC_HEADER 6
+/* about 256 k values in a block*/
+#define MAP_CODEC_BLOCK 262144
+#define MAP_CODEC_PARITY_LAYER 2
+#define MAP_CODEC_LEVEL 1
+
+/* float bits as unsigned integers in the order of the floats*/
+static inline uint32_t toOrdered(uint32_t bits)
+{
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+static inline uint32_t fromOrdered(uint32_t ordered)
+{
+    return (ordered & 0x80000000u) ? ordered & 0x7FFFFFFFu : ~ordered;
+}
+
+/* small positive and negative residuals become small unsigned numbers*/
+static inline uint32_t zigzag(uint32_t residual)
+{
+    return (residual << 1) ^ (uint32_t) ((int32_t) residual >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t z)
+{
+    return (z >> 1) ^ (uint32_t) -(int32_t) (z & 1);
+}
+
+/* prediction of the value in a row from the two values above it in the column,
+ * the first row from the first row of the column on the left*/
+static inline uint32_t predict(uint32_t above, uint32_t twoAbove, uint32_t left, int row)
+{
+    if (row == 0) {
+        return left;
+    } else if (row == 1) {
+        return above;
+    }
+    return 2 * above - twoAbove;
+}
+
+#endif
@@ -0,0 +1,380 @@
+/*==========================================================
+ * mappedMap: maps larger than the memory, in a file mapped into memory (mmap),
+ * processed band by band of rows by the usual kernels
+ *
+ * handle = mappedMap('create', fileName, grid);
+ * handle = mappedMap('create', fileName, grid, bandRows);
+ *     creates the file with the identity map of the grid (see identityGrid.m)
+ * handle = mappedMap('open', fileName);
+ *     opens an existing file
+ * sizes = mappedMap('size', handle);
+ *     sizes = [nY, nX, layers, bandRows, nBands]
+ * band = mappedMap('read', handle, b);
+ *     the map of band b (1 ... nBands), single of size (nRows, nX, layers)
+ * mappedMap('write', handle, b, band);
+ *     writes the (modified) map of band b back into the file
+ * mappedMap('close', handle);
+ *
+ * the kernels do not change, they work on each band as on a map:
+ *     handle = mappedMap('create', 'large.map', identityGrid(2000, -1, 1));
+ *     for b = 1:nBands
+ *         band = mappedMap('read', handle, b);
+ *         basicKaleidoscope(band, 7, 3, 2);
+ *         mappedMap('write', handle, b, band);
+ *     end
+ * see transformMappedMap.m and testMappedMap.m
+ *
+ * the file has a header of MAPPED_HEADER bytes, then the bands,
+ * each band is a map of bandRows rows (the last band may have fewer),
+ * layers as in matlab: x of all pixels, then y, then parity
+ * so a band is one contiguous block of the file, and going through the bands
+ * goes through the file from start to end, the kernel reads ahead,
+ * pages of bands done are dropped from memory (madvise)
+ *
+ * needs a 64 bit posix system (linux, macOS)
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gridMap.h"
+#define PARALLEL_MIN 10000
+#define MAX_MAPPED 16
+#define MAPPED_HEADER 64
+#define MAPPED_MAGIC 0x4650414D
+#define MAPPED_VERSION 1
+#define DEFAULT_BAND_ROWS 256
+
+typedef struct {
+    bool isOpen;
+    int file;
+    uint8_t *data;
+    size_t size;
+    int nY, nX, layers, bandRows, nBands;
+} mappedFile;
+
+/* the header, little endian on all usual systems*/
+typedef struct {
+    uint32_t magic, version, nY, nX, layers, bandRows;
+} mappedHeader;
+
+static mappedFile mappedFiles[MAX_MAPPED];
+static bool hasExitFunction = false;
+
+static void freeMapped(mappedFile *m)
+{
+    if (m->isOpen) {
+        mexUnlock();
+    }
+    if (m->data != NULL) {
+        munmap(m->data, m->size);
+    }
+    if (m->file >= 0) {
+        close(m->file);
+    }
+    memset(m, 0, sizeof(mappedFile));
+    m->file = -1;
+}
+
+/* open files are closed when matlab clears the mex file*/
+static void freeAllMapped(void)
+{
+    int i;
+    for (i = 0; i < MAX_MAPPED; i++){
+        if (mappedFiles[i].isOpen) {
+            freeMapped(&mappedFiles[i]);
+        }
+    }
+}
+
+static size_t pageSize(void)
+{
+    return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+/* first row of a band and its number of rows*/
+static void bandRows(const mappedFile *m, int band, int *firstRow, int *nRows)
+{
+    *firstRow = band * m->bandRows;
+    *nRows = (*firstRow + m->bandRows <= m->nY) ? m->bandRows : m->nY - *firstRow;
+}
+
+/* the band in the file, each row has nX * layers floats*/
+static float *bandData(const mappedFile *m, int band)
+{
+    return (float *) (m->data + MAPPED_HEADER + (size_t) band * m->bandRows * m->nX * m->layers * sizeof(float));
+}
+
+static size_t bandBytes(const mappedFile *m, int band)
+{
+    int firstRow, nRows;
+    bandRows(m, band, &firstRow, &nRows);
+    return (size_t) nRows * m->nX * m->layers * sizeof(float);
+}
+
+/* advice for the pages of a band, page aligned*/
+static void adviseBand(const mappedFile *m, int band, int advice)
+{
+    uint8_t *start, *end;
+    size_t page = pageSize();
+    if ((band < 0) || (band >= m->nBands)) {
+        return;
+    }
+    start = (uint8_t *) bandData(m, band);
+    end = start + bandBytes(m, band);
+    start = m->data + ((size_t) (start - m->data) / page) * page;
+    if (advice == MADV_DONTNEED) {
+        /* write the changes before dropping the pages*/
+        msync(start, end - start, MS_ASYNC);
+    }
+    madvise(start, end - start, advice);
+}
+
+/* map the file into memory, returns the handle*/
+static int mapFile(int file, const mappedHeader *header)
+{
+    int handle;
+    mappedFile *m;
+    if (!hasExitFunction) {
+        for (handle = 0; handle < MAX_MAPPED; handle++){
+            mappedFiles[handle].file = -1;
+        }
+        mexAtExit(freeAllMapped);
+        hasExitFunction = true;
+    }
+    for (handle = 0; handle < MAX_MAPPED; handle++){
+        if (!mappedFiles[handle].isOpen) {
+            break;
+        }
+    }
+    if (handle == MAX_MAPPED) {
+        close(file);
+        mexErrMsgIdAndTxt("mappedMap:open","Too many open mapped maps, maximum 16.");
+    }
+    m = &mappedFiles[handle];
+    m->file = file;
+    m->nY = header->nY;
+    m->nX = header->nX;
+    m->layers = header->layers;
+    m->bandRows = header->bandRows;
+    m->nBands = (m->nY + m->bandRows - 1) / m->bandRows;
+    m->size = MAPPED_HEADER + (size_t) m->nY * m->nX * m->layers * sizeof(float);
+    m->data = (uint8_t *) mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (m->data == MAP_FAILED) {
+        m->data = NULL;
+        close(file);
+        m->file = -1;
+        mexErrMsgIdAndTxt("mappedMap:mmap","Could not map the file into memory.");
+    }
+    /* the bands are processed in the order of the file*/
+    madvise(m->data, m->size, MADV_SEQUENTIAL);
+    /* clear mappedMap does not lose open maps*/
+    mexLock();
+    m->isOpen = true;
+    return handle;
+}
+
+static int createMapped(const char *fileName, const grid *g, int rowsPerBand)
+{
+    int file, handle, band, firstRow, nRows, nBandPixels, index, column;
+    float *x, *y, *parity, gy;
+    mappedHeader header;
+    mappedFile *m;
+    size_t size;
+    if (rowsPerBand < 1) {
+        mexErrMsgIdAndTxt("mappedMap:bandRows","A band needs at least one row.");
+    }
+    header.magic = MAPPED_MAGIC;
+    header.version = MAPPED_VERSION;
+    header.nY = g->nY;
+    header.nX = g->nX;
+    header.layers = 3;
+    header.bandRows = (rowsPerBand < g->nY) ? rowsPerBand : g->nY;
+    size = MAPPED_HEADER + (size_t) g->nY * g->nX * 3 * sizeof(float);
+    file = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        mexErrMsgIdAndTxt("mappedMap:open","Could not create the file.");
+    }
+    /* the file gets its size without writing, then the header*/
+    if ((ftruncate(file, (off_t) size) != 0) || (pwrite(file, &header, sizeof(header), 0) != sizeof(header))) {
+        close(file);
+        mexErrMsgIdAndTxt("mappedMap:open","Could not create a file of %.0f bytes.", (double) size);
+    }
+    handle = mapFile(file, &header);
+    m = &mappedFiles[handle];
+    /* the identity map, band by band*/
+    for (band = 0; band < m->nBands; band++){
+        bandRows(m, band, &firstRow, &nRows);
+        nBandPixels = nRows * m->nX;
+        x = bandData(m, band);
+        y = x + nBandPixels;
+        parity = y + nBandPixels;
+        /* row first order*/
+#pragma omp parallel for private(column, gy) if (nBandPixels > PARALLEL_MIN)
+        for (index = 0; index < nBandPixels; index++){
+            column = index / nRows;
+            gy = gridY(g, firstRow + index - column * nRows);
+            x[index] = gridX(g, column);
+            y[index] = gy;
+            parity[index] = 0;
+        }
+        adviseBand(m, band, MADV_DONTNEED);
+    }
+    return handle;
+}
+
+static int openMapped(const char *fileName)
+{
+    int file;
+    mappedHeader header;
+    struct stat status;
+    file = open(fileName, O_RDWR);
+    if (file < 0) {
+        mexErrMsgIdAndTxt("mappedMap:open","Could not open the file.");
+    }
+    if ((pread(file, &header, sizeof(header), 0) != sizeof(header)) || (header.magic != MAPPED_MAGIC)
+            || (header.version != MAPPED_VERSION) || (header.bandRows < 1) || (fstat(file, &status) != 0)
+            || ((size_t) status.st_size < MAPPED_HEADER + (size_t) header.nY * header.nX * header.layers * sizeof(float))) {
+        close(file);
+        mexErrMsgIdAndTxt("mappedMap:open","The file is not a map of mappedMap.");
+    }
+    return mapFile(file, &header);
+}
+
+static mappedFile *getMapped(const mxArray *handle)
+{
+    int i = (int) mxGetScalar(handle) - 1;
+    if ((i < 0) || (i >= MAX_MAPPED) || !mappedFiles[i].isOpen) {
+        mexErrMsgIdAndTxt("mappedMap:handle","This mapped map is not open.");
+    }
+    return &mappedFiles[i];
+}
+
+/* band number, from matlab (1 ... nBands) to c*/
+static int getBand(const mappedFile *m, const mxArray *b)
+{
+    int band = (int) mxGetScalar(b) - 1;
+    if ((band < 0) || (band >= m->nBands)) {
+        mexErrMsgIdAndTxt("mappedMap:band","The band has to be from 1 to %d.", m->nBands);
+    }
+    return band;
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    char command[16], fileName[4096];
+    const mwSize *dims;
+    mwSize bandDims[3];
+    int handle, band, firstRow, nRows;
+    grid g;
+    mwSize gridDims[3];
+    mappedFile *m;
+    double *sizes;
+    float *data;
+    /* check for proper number of arguments (else crash)*/
+    if ((nrhs < 2) || !mxIsChar(prhs[0]) || (mxGetString(prhs[0], command, sizeof(command)) != 0)) {
+        mexErrMsgIdAndTxt("mappedMap:nrhs","A command 'create', 'open', 'size', 'read', 'write' or 'close' and its arguments required.");
+    }
+    if (strcmp(command, "create") == 0) {
+        if ((nrhs < 3) || !mxIsChar(prhs[1]) || (mxGetString(prhs[1], fileName, sizeof(fileName)) != 0) || !isGrid(prhs[2])) {
+            mexErrMsgIdAndTxt("mappedMap:nrhs","'create' needs a file name and a grid [nY, nX, xMin, dx, yMax, dy].");
+        }
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("mappedMap:nlhs","'create' returns one handle.");
+        }
+        getGrid(prhs[2], &g, gridDims);
+        handle = createMapped(fileName, &g, (nrhs > 3) ? (int) mxGetScalar(prhs[3]) : DEFAULT_BAND_ROWS);
+        plhs[0] = mxCreateDoubleScalar(handle + 1);
+    } else if (strcmp(command, "open") == 0) {
+        if (!mxIsChar(prhs[1]) || (mxGetString(prhs[1], fileName, sizeof(fileName)) != 0)) {
+            mexErrMsgIdAndTxt("mappedMap:nrhs","'open' needs a file name.");
+        }
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("mappedMap:nlhs","'open' returns one handle.");
+        }
+        handle = openMapped(fileName);
+        plhs[0] = mxCreateDoubleScalar(handle + 1);
+    } else if (strcmp(command, "size") == 0) {
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("mappedMap:nlhs","'size' returns one vector of sizes.");
+        }
+        m = getMapped(prhs[1]);
+        plhs[0] = mxCreateDoubleMatrix(1, 5, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        sizes = mxGetDoubles(plhs[0]);
+#else
+        sizes = mxGetPr(plhs[0]);
+#endif
+        sizes[0] = m->nY;
+        sizes[1] = m->nX;
+        sizes[2] = m->layers;
+        sizes[3] = m->bandRows;
+        sizes[4] = m->nBands;
+    } else if (strcmp(command, "read") == 0) {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("mappedMap:nrhs","'read' needs a handle and a band.");
+        }
+        if (nlhs > 1) {
+            mexErrMsgIdAndTxt("mappedMap:nlhs","'read' returns one band.");
+        }
+        m = getMapped(prhs[1]);
+        band = getBand(m, prhs[2]);
+        bandRows(m, band, &firstRow, &nRows);
+        bandDims[0] = nRows;
+        bandDims[1] = m->nX;
+        bandDims[2] = m->layers;
+        plhs[0] = mxCreateNumericArray(3, bandDims, mxSINGLE_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        data = mxGetSingles(plhs[0]);
+#else
+        data = (float *) mxGetData(plhs[0]);
+#endif
+        /* read ahead the next band while the kernels work on this one*/
+        adviseBand(m, band + 1, MADV_WILLNEED);
+        memcpy(data, bandData(m, band), bandBytes(m, band));
+    } else if (strcmp(command, "write") == 0) {
+        if (nrhs < 4) {
+            mexErrMsgIdAndTxt("mappedMap:nrhs","'write' needs a handle, a band and its map.");
+        }
+        if (nlhs > 0) {
+            mexErrMsgIdAndTxt("mappedMap:nlhs","'write' returns nothing.");
+        }
+        m = getMapped(prhs[1]);
+        band = getBand(m, prhs[2]);
+        bandRows(m, band, &firstRow, &nRows);
+        dims = mxGetDimensions(prhs[3]);
+        if (!mxIsSingle(prhs[3]) || (mxGetNumberOfDimensions(prhs[3]) != 3) || ((int) dims[0] != nRows)
+                || ((int) dims[1] != m->nX) || ((int) dims[2] != m->layers)) {
+            mexErrMsgIdAndTxt("mappedMap:band","The map of band %d has to be single of size (%d, %d, %d).",
+                    band + 1, nRows, m->nX, m->layers);
+        }
+#if MX_HAS_INTERLEAVED_COMPLEX
+        data = mxGetSingles(prhs[3]);
+#else
+        data = (float *) mxGetData(prhs[3]);
+#endif
+        memcpy(bandData(m, band), data, bandBytes(m, band));
+        /* this band is done, its pages go to the file*/
+        adviseBand(m, band, MADV_DONTNEED);
+    } else if (strcmp(command, "close") == 0) {
+        if (nlhs > 0) {
+            mexErrMsgIdAndTxt("mappedMap:nlhs","'close' returns nothing.");
+        }
+        m = getMapped(prhs[1]);
+        if (msync(m->data, m->size, MS_SYNC) != 0) {
+            freeMapped(m);
+            mexErrMsgIdAndTxt("mappedMap:write","Could not write the file.");
+        }
+        freeMapped(m);
+    } else {
+        mexErrMsgIdAndTxt("mappedMap:command","Unknown command, use 'create', 'open', 'size', 'read', 'write' or 'close'.");
+    }
+}
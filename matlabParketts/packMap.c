@@ -0,0 +1,176 @@
+/*==========================================================
+ * packMap: lossless compression of a map, for storing maps (see mapCodec.h)
+ *
+ * packed = packMap(map);
+ *
+ * Input:
+ * map: single array of size (nY, nX, layers), as from createIdentityMap
+ *     and the kernels, any number of layers, the third is the parity
+ *
+ * returns the packed map, a uint8 column vector,
+ * map = unpackMap(packed) gives exactly the same map
+ * smooth maps shrink several times, save and load with saveMap and loadMap
+ *
+ * compile with zlib and openMP (see compile.m)
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <zlib.h>
+#include "mapCodec.h"
+
+/* residuals of a block of a coordinate layer, as 4 byte planes*/
+static void predictBlock(const uint32_t *bits, int nY, int nColumns, uint8_t *planes)
+{
+    int row, column, index, n;
+    uint32_t ordered, above, twoAbove, left, z;
+    n = nY * nColumns;
+    left = 0;
+    index = 0;
+    for (column = 0; column < nColumns; column++){
+        above = 0;
+        twoAbove = 0;
+        for (row = 0; row < nY; row++){
+            ordered = toOrdered(bits[index]);
+            z = zigzag(ordered - predict(above, twoAbove, left, row));
+            planes[index] = (uint8_t) z;
+            planes[index + n] = (uint8_t) (z >> 8);
+            planes[index + 2 * n] = (uint8_t) (z >> 16);
+            planes[index + 3 * n] = (uint8_t) (z >> 24);
+            if (row == 0) {
+                left = ordered;
+            }
+            twoAbove = above;
+            above = ordered;
+            index++;
+        }
+    }
+}
+
+/* runs of equal values of a block of the parity layer, returns the number of bytes*/
+static uint32_t runLengthBlock(const uint32_t *bits, int n, uint32_t *runs)
+{
+    int index, nRuns;
+    nRuns = 0;
+    for (index = 0; index < n; index++){
+        if ((nRuns > 0) && (runs[2 * nRuns - 1] == bits[index])) {
+            runs[2 * nRuns - 2]++;
+        } else {
+            runs[2 * nRuns] = 1;
+            runs[2 * nRuns + 1] = bits[index];
+            nRuns++;
+        }
+    }
+    return 8 * nRuns;
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *dims;
+    int nX, nY, nXnY, layers, blockColumns, nBlocks, nUnits, unit, layer, block, column0, nColumns, n;
+    size_t total, position;
+    uLongf packedLength;
+    uint32_t *header, *sizes, rawLength;
+    const uint32_t *map, *bits;
+    uint8_t **raw, **packed, *out;
+    bool failed;
+    /* check for proper number of arguments (else crash)*/
+    if (nrhs != 1) {
+        mexErrMsgIdAndTxt("packMap:nrhs","A map input required.");
+    }
+    if (!mxIsSingle(prhs[0]) || mxIsComplex(prhs[0]) || (mxGetNumberOfDimensions(prhs[0]) > 3)) {
+        mexErrMsgIdAndTxt("packMap:map","The map has to be a single array of size (nY, nX, layers).");
+    }
+    /* check that output is possible*/
+    if (nlhs != 1) {
+        mexErrMsgIdAndTxt("packMap:nlhs","One output array for the packed map required.");
+    }
+    dims = mxGetDimensions(prhs[0]);
+    nY = dims[0];
+    nX = dims[1];
+    layers = (mxGetNumberOfDimensions(prhs[0]) > 2) ? dims[2] : 1;
+    nXnY = nX * nY;
+#if MX_HAS_INTERLEAVED_COMPLEX
+    map = (const uint32_t *) mxGetSingles(prhs[0]);
+#else
+    map = (const uint32_t *) mxGetData(prhs[0]);
+#endif
+    /* blocks of whole columns*/
+    blockColumns = (nY > 0) ? MAP_CODEC_BLOCK / nY : 1;
+    blockColumns = (blockColumns < 1) ? 1 : blockColumns;
+    nBlocks = (nX + blockColumns - 1) / blockColumns;
+    nUnits = nBlocks * layers;
+    sizes = (uint32_t *) mxMalloc((nUnits + 1) * sizeof(uint32_t));
+    /* matlab memory is not thread safe, get it before*/
+    raw = (uint8_t **) mxMalloc((nUnits + 1) * sizeof(uint8_t *));
+    packed = (uint8_t **) mxMalloc((nUnits + 1) * sizeof(uint8_t *));
+    for (unit = 0; unit < nUnits; unit++){
+        block = unit % nBlocks;
+        nColumns = (block < nBlocks - 1) ? blockColumns : nX - block * blockColumns;
+        /* a run is 8 bytes, at most 2 times the parity block*/
+        n = ((unit / nBlocks == MAP_CODEC_PARITY_LAYER) ? 8 : 4) * nColumns * nY;
+        raw[unit] = (uint8_t *) mxMalloc(n);
+        packed[unit] = (uint8_t *) mxMalloc(compressBound(n) + 4);
+    }
+    failed = false;
+    /* do the blocks*/
+#pragma omp parallel for private(layer, block, column0, nColumns, n, bits, rawLength, packedLength) schedule(dynamic)
+    for (unit = 0; unit < nUnits; unit++){
+        layer = unit / nBlocks;
+        block = unit % nBlocks;
+        column0 = block * blockColumns;
+        nColumns = (block < nBlocks - 1) ? blockColumns : nX - column0;
+        n = nColumns * nY;
+        bits = map + (size_t) layer * nXnY + (size_t) column0 * nY;
+        if (layer == MAP_CODEC_PARITY_LAYER) {
+            rawLength = runLengthBlock(bits, n, (uint32_t *) raw[unit]);
+        } else {
+            predictBlock(bits, nY, nColumns, raw[unit]);
+            rawLength = 4 * n;
+        }
+        /* the length of the raw data, then deflated*/
+        memcpy(packed[unit], &rawLength, 4);
+        packedLength = compressBound(((layer == MAP_CODEC_PARITY_LAYER) ? 8 : 4) * (uLong) n);
+        if (compress2(packed[unit] + 4, &packedLength, raw[unit], rawLength, MAP_CODEC_LEVEL) != Z_OK) {
+            failed = true;
+        }
+        sizes[unit] = 4 + (uint32_t) packedLength;
+    }
+    if (failed) {
+        mexErrMsgIdAndTxt("packMap:compress","Compression failed.");
+    }
+    /* put the blocks together*/
+    total = (MAP_CODEC_HEADER + nUnits) * sizeof(uint32_t);
+    for (unit = 0; unit < nUnits; unit++){
+        total += sizes[unit];
+    }
+    plhs[0] = mxCreateNumericMatrix(total, 1, mxUINT8_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+    out = mxGetUint8s(plhs[0]);
+#else
+    out = (uint8_t *) mxGetData(plhs[0]);
+#endif
+    header = (uint32_t *) out;
+    header[0] = MAP_CODEC_MAGIC;
+    header[1] = nY;
+    header[2] = nX;
+    header[3] = layers;
+    header[4] = blockColumns;
+    header[5] = nBlocks;
+    memcpy(header + MAP_CODEC_HEADER, sizes, nUnits * sizeof(uint32_t));
+    position = (MAP_CODEC_HEADER + nUnits) * sizeof(uint32_t);
+    for (unit = 0; unit < nUnits; unit++){
+        memcpy(out + position, packed[unit], sizes[unit]);
+        position += sizes[unit];
+        mxFree(raw[unit]);
+        mxFree(packed[unit]);
+    }
+    mxFree(raw);
+    mxFree(packed);
+    mxFree(sizes);
+}
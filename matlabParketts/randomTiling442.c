@@ -6,6 +6,8 @@
  * simulates a kaleiddoscope with *442 orbifold
  *
  * chooses randomly between two positions of the input image part
+ * the choice is the same for all pixels of a cell, it depends only on the cell and the seed
+ * (see cellRandom.h), the cells are the squares (i*size...(i+1)*size, j*size...(j+1)*size)
  *
  * Input:
  * first the map. 
@@ -17,10 +19,23 @@
  * additional parameter:size
  *      simulates mirrors at x=0, x=size,y=0,y=size and x=y   
  *
+ * optional parameter: seed (integer from 0 to 2^32-1, default 0), different seeds give different random choices
+ *
  * modifies the map, returns nothing if used as a procedure
- * tiling442(map, size);
+ * randomTiling442(map, size);
+ * randomTiling442(map, size, seed);
  * does not change the map and returns a modified map if used as  a function
- * newMap = tiling442(map, size);
+ * newMap = randomTiling442(map, size);
+ * newMap = randomTiling442(map, size, seed);
+ *
+ * returns additionally the tiles as a uint32 array of size (nY, nX, 2) 
+ * [newMap, tiles] = randomTiling442(map, size);
+ *     tiles(h,k,1) = number of mirror lines between the point and the basic triangle 0<=y<=x<=size/2
+ *     tiles(h,k,2) = hash of the tile (cell and its mirror images), the same for each call
+ *     the random mirroring at the x-axis counts as one more reflection
+ *     invalid pixels have length 0 and hash 0
+ *
+ * compile with openMP to use all cores (see compile.m)
  *
  *========================================================*/
 
@@ -29,9 +44,13 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "cellRandom.h"
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1000
+#define PARALLEL_MIN 10000
 
 void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
@@ -40,11 +59,13 @@ void mexFunction( int nlhs, mxArray *plhs[],
     int nX, nY, nXnY, nXnY2, index;
     float inverted;
     float *inMap, *outMap;
+    uint32_t *tiles;
+    int flips;
     float size, sizeHalf, x, y, h;
     bool returnsMap = false;
-    int nHorCells, nVertCells, iCell, jCell, nCells;
-    float factor, factors[10000];
-    float xMin, yMin;
+    int iCell, jCell;
+    uint32_t seed;
+    double seedValue;
     /* check for proper number of arguments (else crash)*/
     /* checking for presence of a map*/
     if(nrhs < 2) {
@@ -58,9 +79,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
     if(dims[2] != 3) {
         mexErrMsgIdAndTxt("mirrorsMap:map3rdDimension","The map's third dimension has to be three.");
     }
-    /* check that no or one output is expected*/
-    if (nlhs > 1) {
-        mexErrMsgIdAndTxt("mirrorsMap:nlhs","Has zero or one return parameter.");
+    /* check that no, one or two outputs are expected*/
+    if (nlhs > 2) {
+        mexErrMsgIdAndTxt("mirrorsMap:nlhs","Has zero, one or two return parameters.");
     }
     /* get the map*/
 #if MX_HAS_INTERLEAVED_COMPLEX
@@ -78,10 +99,30 @@ void mexFunction( int nlhs, mxArray *plhs[],
         outMap = mxGetSingles(plhs[0]);
 #else
         outMap = (float *) mxGetPr(plhs[0]);
+#endif
+    }
+    /* create the tiles, initialized to zero (invalid)*/
+    tiles = NULL;
+    if (nlhs == 2){
+        mwSize tileDims[3] = {dims[0], dims[1], 2};
+        plhs[1] = mxCreateNumericArray(3, tileDims, mxUINT32_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        tiles = mxGetUint32s(plhs[1]);
+#else
+        tiles = (uint32_t *) mxGetData(plhs[1]);
 #endif
     }
     size = (float) mxGetScalar(prhs[1]);
     sizeHalf = size / 2;
+    seed = 0;
+    if (nrhs >= 3){
+        seedValue = mxGetScalar(prhs[2]);
+        /* the conversion to uint32_t is undefined for other values*/
+        if ((seedValue < 0) || (seedValue > UINT32_MAX) || (seedValue != floor(seedValue))){
+            mexErrMsgIdAndTxt("randomTiling442:seed","The seed has to be an integer from 0 to %u.", UINT32_MAX);
+        }
+        seed = (uint32_t) seedValue;
+    }
     
     /* do the map*/
     /* row first order*/
@@ -90,27 +131,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
     
-    /* input dimensions,assuming that all points are valid*/
-    /* bottom left corner at (0,nXnY)*/
-    /* top right corner at (nXnY-1,nXnY2-1)*/
-    /* INVERTED y-axis*/
-    xMin = inMap[0];
-    yMin = inMap[nXnY2 - 1];
-    PRINTF(xMin);
-    PRINTF(yMin);
-    nHorCells = (int) floorf((inMap[nXnY-1] - inMap[0]) / size) + 1;
-    nVertCells = (int) floorf((inMap[nXnY] - inMap[nXnY2 - 1]) / size) + 1;
-    PRINTI(nHorCells);
-    PRINTI(nVertCells);
-    nCells = nHorCells * nVertCells;
-    for (index = 0; index < nCells; index++){
-        if ((((float) rand())/ RAND_MAX) > 0.5){
-            factor =  1.0f;
-        } else {
-            factor = -1.0f;
-        }
-        factors[index] = factor;
-    }
+    /* the random choices are done for each pixel, they depend only on its cell*/
+    /* thus the pixels can be done in parallel*/
+    #pragma omp parallel for private(inverted, x, y, h, flips, iCell, jCell) if (nXnY > PARALLEL_MIN)
     for (index = 0; index < nXnY; index++){
         inverted = inMap[index + nXnY2];
         /* do only transform if pixel is valid*/
@@ -123,35 +146,47 @@ void mexFunction( int nlhs, mxArray *plhs[],
             }
             continue;
         }
-        // use shifted coordinates to get only positive iCell indices
-        x = inMap[index] - xMin;
+        x = inMap[index];
+        y = inMap[index + nXnY];
+        /* the tile is given by the cell, the mirrorings done in the cell and the random choice*/
+        flips = 0;
+        if (tiles != NULL){
+            tiles[index] = mirrorsCrossed(x, y, size, sizeHalf);
+        }
         iCell = (int) floorf(x / size);
         x = x - size * iCell;
         if (x > sizeHalf) {
             x = size - x;
             inverted = 1 - inverted;
+            flips += 1;
         }
-        y = inMap[index + nXnY] - yMin;
         jCell = (int) floorf(y / size);
         y = y - size * jCell;
 
         if (y > sizeHalf) {
             y = size - y;
             inverted = 1 - inverted;
+            flips += 2;
         }
         if (y > x){
             h = x;
             x = y;
             y = h;
             inverted = 1 - inverted;
+            flips += 4;
         }
         
-        if (factors[iCell + nHorCells * jCell] < 0){
+        if (cellRandomChoice(iCell, jCell, seed, 0.5f)){
             inverted = 1 - inverted;
             y = - y;
+            flips += 8;
+            if (tiles != NULL){
+                tiles[index] += 1;
+            }
+        }
+        if (tiles != NULL){
+            tiles[index + nXnY] = hashInt(hashInt(hashInt(HASH_START, iCell), jCell), flips);
         }
-        
-        
         outMap[index] = x;
         outMap[index + nXnY] = y;
         outMap[index + nXnY2] = inverted;
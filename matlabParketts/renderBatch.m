@@ -0,0 +1,136 @@
+% renderBatch: render all variations of a job file, for catalogues
+% renderBatch(jobFile);
+% renderBatch(jobFile, nWorkers);
+%
+% from the command line, without the desktop:
+% matlab -batch "renderBatch('catalogueJob.json')"
+%
+% jobFile: JSON file, as catalogueJob.json:
+%     inputs: list of input image files
+%     map: the initial map, fields mPixels and range [xMin xMax yMin yMax]
+%     chain: kernels as in renderJob.m, parameters may be names of the sweep
+%     sweep: for each name the list of its values, all combinations are done
+%     output: pattern of the output files, {input} is the name of the input
+%         image without extension, {name} the value of a parameter of the sweep
+%     manifest: optional csv file, one line for each image: file, input,
+%         values of the sweep, seconds and error (empty if ok)
+% nWorkers: optional, combinations in parallel with parfor (needs the
+%     parallel computing toolbox), default 0, each kernel uses all cores anyway
+%
+% maps are done once for each combination and used for all input images,
+% input images of the same size use the same baked map (see renderJob.m),
+% input images are decoded once (once for each worker with parfor)
+% names in the chain that are not in the sweep are an error
+
+function renderBatch(jobFile, nWorkers)
+    if nargin < 2
+        nWorkers = 0;
+    end
+    batch = jsondecode(fileread(jobFile));
+    inputs = cellstr(batch.inputs);
+    % all combinations of the sweep, one row each
+    names = fieldnames(batch.sweep);
+    values = cellfun(@(name) batch.sweep.(name)(:)', names, 'UniformOutput', false);
+    grids = cell(1, numel(names));
+    [grids{:}] = ndgrid(values{:});
+    combinations = cell2mat(cellfun(@(g) g(:), grids, 'UniformOutput', false));
+    checkNames(batch.chain, names);
+    nCombinations = size(combinations, 1);
+    fprintf('%d combinations of %d input images\n', nCombinations, numel(inputs));
+    results = cell(nCombinations, 1);
+    start = tic;
+    if nWorkers > 0
+        % each worker keeps its own cache of the input images
+        workerCache = parallel.pool.Constant(@() renderCache(numel(inputs)));
+        parfor (combination = 1:nCombinations, nWorkers)
+            results{combination} = renderCombination(batch, inputs, names, combinations(combination, :), workerCache.Value);
+        end
+    else
+        inputCache = renderCache(numel(inputs));
+        for combination = 1:nCombinations
+            results{combination} = renderCombination(batch, inputs, names, combinations(combination, :), inputCache);
+        end
+    end
+    results = [results{:}];
+    nFailed = sum(~cellfun(@isempty, {results.error}));
+    fprintf('%d images in %f s, %d failed\n', numel(results), toc(start), nFailed);
+    if isfield(batch, 'manifest')
+        writeManifest(batch.manifest, results, names);
+    end
+end
+
+% all input images for one combination of the sweep
+function results = renderCombination(batch, inputs, names, combination, inputCache)
+    % the decoded input images are shared by all combinations,
+    % caches for the map and the baked maps of this combination
+    caches.inputs = inputCache;
+    caches.maps = renderCache(1);
+    caches.baked = renderCache(numel(inputs));
+    job.map = batch.map;
+    job.chain = batch.chain;
+    % the parameters of the sweep in the chain
+    for step = 1:numel(job.chain)
+        parameters = job.chain(step).parameters;
+        if iscell(parameters)
+            for i = 1:numel(parameters)
+                if ischar(parameters{i})
+                    parameters{i} = combination(strcmp(parameters{i}, names));
+                end
+            end
+            parameters = cell2mat(parameters);
+        end
+        job.chain(step).parameters = parameters;
+    end
+    results = struct('file', {}, 'input', {}, 'values', {}, 'seconds', {}, 'error', {});
+    for i = 1:numel(inputs)
+        job.input = inputs{i};
+        [~, inputName] = fileparts(inputs{i});
+        file = strrep(batch.output, '{input}', inputName);
+        for n = 1:numel(names)
+            file = strrep(file, ['{', names{n}, '}'], num2str(combination(n)));
+        end
+        job.output.file = file;
+        folder = fileparts(file);
+        if ~isempty(folder) && ~isfolder(folder)
+            mkdir(folder);
+        end
+        result = struct('file', file, 'input', inputs{i}, 'values', combination, 'seconds', 0, 'error', '');
+        try
+            [~, info] = renderJob(job, caches);
+            result.seconds = info.seconds;
+        catch exception
+            result.error = exception.message;
+            fprintf('%s failed: %s\n', file, exception.message);
+        end
+        results(end + 1) = result;
+    end
+end
+
+% the names of parameters in the chain have to be in the sweep
+function checkNames(chain, names)
+    for step = 1:numel(chain)
+        parameters = chain(step).parameters;
+        if iscell(parameters)
+            for i = 1:numel(parameters)
+                if ischar(parameters{i}) && ~any(strcmp(parameters{i}, names))
+                    error('renderBatch:parameter', 'The parameter %s of step %d of the chain is not in the sweep.', ...
+                        parameters{i}, step);
+                end
+            end
+        end
+    end
+end
+
+function writeManifest(fileName, results, names)
+    file = fopen(fileName, 'w');
+    if file < 0
+        error('renderBatch:manifest', 'Could not open %s.', fileName);
+    end
+    fprintf(file, 'file,input,%s,seconds,error\n', strjoin(names', ','));
+    for result = results
+        fprintf(file, '"%s","%s",%s,%f,"%s"\n', result.file, result.input, ...
+            strjoin(arrayfun(@num2str, result.values, 'UniformOutput', false), ','), ...
+            result.seconds, strrep(result.error, '"', '""'));
+    end
+    fclose(file);
+end
@@ -0,0 +1,39 @@
+% renderCache: a cache of the render daemon, drops the least recently used
+% cache = renderCache(capacity);
+%     new cache for at most capacity values
+% [value, hit] = renderCache(cache, 'get', key);
+%     hit is false and value empty if the key is not in the cache
+% renderCache(cache, 'put', key, value);
+%
+% keys are strings, the cache is a handle (containers.Map),
+% changes are seen by all copies, see renderDaemon.m
+
+function [value, hit] = renderCache(cache, command, key, value)
+    if nargin == 1
+        value = struct('values', containers.Map(), 'used', containers.Map(), 'capacity', cache);
+        return
+    end
+    switch command
+        case 'get'
+            hit = isKey(cache.values, key);
+            if hit
+                value = cache.values(key);
+                cache.used(key) = tic;
+            else
+                value = [];
+            end
+        case 'put'
+            if ~isKey(cache.values, key) && (cache.values.Count >= cache.capacity)
+                % drop the least recently used
+                keys = cache.used.keys();
+                used = cell2mat(cache.used.values());
+                [~, oldest] = min(used);
+                remove(cache.values, keys{oldest});
+                remove(cache.used, keys{oldest});
+            end
+            cache.values(key) = value;
+            cache.used(key) = tic;
+        otherwise
+            error('renderCache:command', 'Unknown command %s, use ''get'' or ''put''.', command);
+    end
+end
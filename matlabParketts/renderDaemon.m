@@ -0,0 +1,70 @@
+% renderDaemon: a render service, keeps decoded input images, maps and
+% baked maps in memory, repeated variations of a job take only the sampling
+% renderDaemon();
+% renderDaemon(socketPath);
+% renderDaemon(socketPath, cacheSize);
+%
+% socketPath: unix domain socket, default /tmp/renderDaemon.sock
+% cacheSize: values in each cache, default 16
+%
+% a job is a line of JSON (see renderJob.m), for example
+% {"input":"1.jpg","map":{"mPixels":1,"range":[-1,1,-1,1]},
+%  "chain":[{"kernel":"basicKaleidoscope","parameters":[7,3,2]}],"output":{"file":"out.png"}}
+% the answer is a line of JSON, {"ok":true,...} with the cache hits and the time,
+% without output file it has the size and number of bytes of the image,
+% the raw uint8 image (matlab order: rows, columns, colors) follows
+% errors answer {"ok":false,"error":"..."}, the daemon goes on
+% the job {"command":"stop"} stops the daemon
+%
+% send jobs from another matlab with renderRequest.m, or any program,
+% the kernels use all cores with openMP
+
+function renderDaemon(socketPath, cacheSize)
+    if nargin < 1
+        socketPath = '/tmp/renderDaemon.sock';
+    end
+    if nargin < 2
+        cacheSize = 16;
+    end
+    caches.inputs = renderCache(cacheSize);
+    caches.maps = renderCache(cacheSize);
+    caches.baked = renderCache(cacheSize);
+    server = jobSocket('listen', socketPath);
+    closeServer = onCleanup(@() jobSocket('close', server));
+    fprintf('render daemon at %s\n', socketPath);
+    running = true;
+    while running
+        client = jobSocket('accept', server, 1);
+        if client == 0
+            continue
+        end
+        try
+            job = jsondecode(jobSocket('receive', client));
+            if isfield(job, 'command') && strcmp(job.command, 'stop')
+                running = false;
+                jobSocket('send', client, [jsonencode(struct('ok', true)), newline]);
+            else
+                [outputImage, info] = renderJob(job, caches);
+                info.ok = true;
+                if isfield(job, 'output') && isfield(job.output, 'file')
+                    jobSocket('send', client, [jsonencode(info), newline]);
+                else
+                    % stream the image back
+                    info.size = size(outputImage, [1, 2, 3]);
+                    info.bytes = numel(outputImage);
+                    jobSocket('send', client, [jsonencode(info), newline]);
+                    jobSocket('send', client, outputImage);
+                end
+                fprintf('job done in %f s\n', info.seconds);
+            end
+        catch exception
+            fprintf('job failed: %s\n', exception.message);
+            try
+                jobSocket('send', client, [jsonencode(struct('ok', false, 'error', exception.message)), newline]);
+            catch
+                % the client is gone
+            end
+        end
+        jobSocket('close', client);
+    end
+end
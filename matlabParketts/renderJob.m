@@ -0,0 +1,72 @@
+% renderJob: render a job of the render daemon, with its caches
+% [outputImage, info] = renderJob(job, caches);
+%
+% job: struct, as decoded from the JSON of a job:
+%     job.input: file name of the input image
+%     job.map: the initial map, fields mPixels and range [xMin xMax yMin yMax]
+%     job.chain: the kernels applied to the map, struct array with fields
+%         kernel: 'basicKaleidoscope', 'tiling442' or 'randomTiling442'
+%         parameters: vector of the parameters of the kernel after the map
+%     job.output: optional, output.file writes the image (imageWriter or imwrite)
+% caches: struct with the caches inputs, maps and baked of renderCache
+%
+% the map is fitted to the input image and baked (bakeMap),
+% variations of the same job only sample the baked map,
+% new input images of the same size reuse the baked map,
+% new input sizes reuse the map
+%
+% info: struct with the cache hits and the time
+
+function [outputImage, info] = renderJob(job, caches)
+    kernels = {'basicKaleidoscope', 'tiling442', 'randomTiling442'};
+    start = tic;
+    % the decoded input image, again if the file changed
+    file = dir(job.input);
+    if isempty(file)
+        error('renderJob:input', 'No input image %s.', job.input);
+    end
+    inputKey = sprintf('%s %f', job.input, file.datenum);
+    [inputImage, info.inputHit] = renderCache(caches.inputs, 'get', inputKey);
+    if ~info.inputHit
+        inputImage = imread(job.input);
+        renderCache(caches.inputs, 'put', inputKey, inputImage);
+    end
+    [inputHeight, inputWidth, ~] = size(inputImage);
+    % the baked map for this geometry and input size
+    mapKey = jsonencode(struct('map', job.map, 'chain', job.chain));
+    bakedKey = sprintf('%s %d %d', mapKey, inputHeight, inputWidth);
+    [baked, info.bakedHit] = renderCache(caches.baked, 'get', bakedKey);
+    info.mapHit = false;
+    if ~info.bakedHit
+        [map, info.mapHit] = renderCache(caches.maps, 'get', mapKey);
+        if ~info.mapHit
+            range = job.map.range;
+            map = createIdentityMap(job.map.mPixels, range(1), range(2), range(3), range(4));
+            for step = reshape(job.chain, 1, [])
+                if ~any(strcmp(step.kernel, kernels))
+                    error('renderJob:kernel', 'Unknown kernel %s.', step.kernel);
+                end
+                parameters = num2cell(step.parameters);
+                map = feval(step.kernel, map, parameters{:});
+            end
+            renderCache(caches.maps, 'put', mapKey, map);
+        end
+        % fit into the input image, as makeOutputImageFitMapToInput
+        [xMin,xMax,yMin,yMax]  = getRangeMap(map);
+        scale = single(min((inputWidth - 2) / (xMax - xMin), (inputHeight - 2) / (yMax - yMin)));
+        x = scale * map(:,:,1) + 1 - scale * xMin;
+        y = scale * map(:,:,2) + 1 - scale * yMin;
+        baked = bakeMap(x, y, map(:,:,3));
+        renderCache(caches.baked, 'put', bakedKey, baked);
+    end
+    outputImage = sampleBakedMap(inputImage, baked);
+    if isfield(job, 'output') && isfield(job.output, 'file')
+        [~, ~, extension] = fileparts(job.output.file);
+        if any(strcmpi(extension, {'.png', '.tif', '.tiff'}))
+            imageWriter(job.output.file, outputImage);
+        else
+            imwrite(outputImage, job.output.file);
+        end
+    end
+    info.seconds = toc(start);
+end
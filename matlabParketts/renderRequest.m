@@ -0,0 +1,35 @@
+% renderRequest: send a job to the render daemon and get the result
+% [outputImage, info] = renderRequest(job);
+% [outputImage, info] = renderRequest(job, socketPath);
+%
+% job: struct as described in renderJob.m, or its JSON
+% socketPath: of the daemon, default /tmp/renderDaemon.sock
+%
+% returns the image if the job has no output file, else []
+% info: the answer of the daemon, cache hits and time
+%
+% example, with renderDaemon() running in another matlab:
+% job.input = '1.jpg';
+% job.map = struct('mPixels', 1, 'range', [-1, 1, -1, 1]);
+% job.chain = struct('kernel', 'basicKaleidoscope', 'parameters', [7, 3, 2]);
+% imshow(renderRequest(job));
+
+function [outputImage, info] = renderRequest(job, socketPath)
+    if nargin < 2
+        socketPath = '/tmp/renderDaemon.sock';
+    end
+    if ~ischar(job)
+        job = jsonencode(job);
+    end
+    client = jobSocket('connect', socketPath);
+    closeClient = onCleanup(@() jobSocket('close', client));
+    jobSocket('send', client, [job, newline]);
+    info = jsondecode(jobSocket('receive', client));
+    outputImage = [];
+    if ~info.ok
+        error('renderRequest:job', 'The daemon could not render the job: %s', info.error);
+    end
+    if isfield(info, 'bytes')
+        outputImage = reshape(jobSocket('receive', client, info.bytes), info.size');
+    end
+end
@@ -0,0 +1,145 @@
+/*==========================================================
+ * sampleBakedMap: the output image of an input image for a baked map,
+ * bilinear interpolation as interp2, only a gather of pixels
+ *
+ * outputImage = sampleBakedMap(inputImage, baked);
+ *
+ * Input:
+ * inputImage: uint8 or single image of size (height, width, layers)
+ * baked: the baked map of bakeMap, uint8 of size (6, nY, nX), see bakedMap.h
+ *
+ * the baked map is made once for a geometry and an input image size,
+ * then each photo of this size needs only this call,
+ * no float map, no range of the map and no scaling
+ *
+ * returns the output image of size (nY, nX, layers), same class as inputImage
+ * invalid pixels and pixels outside the input image are black (0)
+ * uint8 images are interpolated with integer weights (1/256 pixel),
+ * the result differs from interp2 by at most one gray level
+ *
+ * compile with openMP to use all cores (see compile.m)
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bakedMap.h"
+#define PARALLEL_MIN 10000
+/* sum of the integer bilinear weights, and its half for rounding*/
+#define WEIGHT_SHIFT (2 * BAKED_FRACTION_BITS)
+#define WEIGHT_HALF (1 << (WEIGHT_SHIFT - 1))
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *imageDims, *bakedDims;
+    mwSize outDims[3];
+    mwSize nX, nY, nXnY;
+    ptrdiff_t index, wh, i00, i01, i10, i11;
+    int width, height, layers, layer;
+    int c0, r0, c1, r1, fu, fv, w00, w01, w10, w11;
+    uint32_t u, v;
+    const uint8_t *baked;
+    uint8_t *inBytes = NULL, *outBytes = NULL;
+    float *inSingles = NULL, *outSingles = NULL;
+    float scale;
+    bool isBytes;
+    /* check for proper number of arguments (else crash)*/
+    if (nrhs != 2) {
+        mexErrMsgIdAndTxt("sampleBakedMap:nrhs","An input image and a baked map required.");
+    }
+    if (!mxIsUint8(prhs[0]) && !mxIsSingle(prhs[0])) {
+        mexErrMsgIdAndTxt("sampleBakedMap:inputImage","The input image has to be uint8 or single.");
+    }
+    if (!mxIsUint8(prhs[1]) || (mxGetNumberOfDimensions(prhs[1]) > 3)
+            || (mxGetDimensions(prhs[1])[0] != BAKED_BYTES)) {
+        mexErrMsgIdAndTxt("sampleBakedMap:baked","The baked map has to be a uint8 array of size (6, nY, nX) from bakeMap.");
+    }
+    /* check that output is possible*/
+    if (nlhs != 1) {
+        mexErrMsgIdAndTxt("sampleBakedMap:nlhs","One output array for the image required.");
+    }
+    imageDims = mxGetDimensions(prhs[0]);
+    height = imageDims[0];
+    width = imageDims[1];
+    layers = (mxGetNumberOfDimensions(prhs[0]) > 2) ? imageDims[2] : 1;
+    wh = (ptrdiff_t) width * height;
+    bakedDims = mxGetDimensions(prhs[1]);
+    nY = bakedDims[1];
+    nX = (mxGetNumberOfDimensions(prhs[1]) > 2) ? bakedDims[2] : 1;
+    nXnY = nX * nY;
+#if MX_HAS_INTERLEAVED_COMPLEX
+    baked = mxGetUint8s(prhs[1]);
+#else
+    baked = (uint8_t *) mxGetData(prhs[1]);
+#endif
+    isBytes = mxIsUint8(prhs[0]);
+    outDims[0] = nY;
+    outDims[1] = nX;
+    outDims[2] = layers;
+    plhs[0] = mxCreateNumericArray(3, outDims, isBytes ? mxUINT8_CLASS : mxSINGLE_CLASS, mxREAL);
+    if (isBytes) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        inBytes = mxGetUint8s(prhs[0]);
+        outBytes = mxGetUint8s(plhs[0]);
+#else
+        inBytes = (uint8_t *) mxGetData(prhs[0]);
+        outBytes = (uint8_t *) mxGetData(plhs[0]);
+#endif
+    } else {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        inSingles = mxGetSingles(prhs[0]);
+        outSingles = mxGetSingles(plhs[0]);
+#else
+        inSingles = (float *) mxGetData(prhs[0]);
+        outSingles = (float *) mxGetData(plhs[0]);
+#endif
+    }
+    scale = 1.0f / (1 << WEIGHT_SHIFT);
+    /* do the image*/
+    /* row first order, the output image is initialized to black*/
+#pragma omp parallel for private(u, v, c0, r0, c1, r1, fu, fv, w00, w01, w10, w11, i00, i01, i10, i11, layer) if (nXnY > PARALLEL_MIN)
+    for (index = 0; index < (ptrdiff_t) nXnY; index++){
+        unbakePixel(baked + (size_t) BAKED_BYTES * index, &u, &v);
+        /* invalid pixels have u = BAKED_INVALID, outside as interp2: black*/
+        if ((u > (uint32_t) (width - 1) << BAKED_FRACTION_BITS) || (v > (uint32_t) (height - 1) << BAKED_FRACTION_BITS)) {
+            continue;
+        }
+        c0 = u >> BAKED_FRACTION_BITS;
+        r0 = v >> BAKED_FRACTION_BITS;
+        fu = u & BAKED_FRACTION_MASK;
+        fv = v & BAKED_FRACTION_MASK;
+        c1 = (c0 + 1 < width) ? c0 + 1 : c0;
+        r1 = (r0 + 1 < height) ? r0 + 1 : r0;
+        w00 = (BAKED_ONE - fu) * (BAKED_ONE - fv);
+        w01 = fu * (BAKED_ONE - fv);
+        w10 = (BAKED_ONE - fu) * fv;
+        w11 = fu * fv;
+        i00 = r0 + (ptrdiff_t) height * c0;
+        i01 = r0 + (ptrdiff_t) height * c1;
+        i10 = r1 + (ptrdiff_t) height * c0;
+        i11 = r1 + (ptrdiff_t) height * c1;
+        if (isBytes) {
+            for (layer = 0; layer < layers; layer++){
+                outBytes[index + layer * nXnY] = (uint8_t) ((w00 * inBytes[i00] + w01 * inBytes[i01]
+                        + w10 * inBytes[i10] + w11 * inBytes[i11] + WEIGHT_HALF) >> WEIGHT_SHIFT);
+                i00 += wh;
+                i01 += wh;
+                i10 += wh;
+                i11 += wh;
+            }
+        } else {
+            for (layer = 0; layer < layers; layer++){
+                outSingles[index + layer * nXnY] = scale * (w00 * inSingles[i00] + w01 * inSingles[i01]
+                        + w10 * inSingles[i10] + w11 * inSingles[i11]);
+                i00 += wh;
+                i01 += wh;
+                i10 += wh;
+                i11 += wh;
+            }
+        }
+    }
+}
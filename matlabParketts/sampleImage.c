@@ -0,0 +1,542 @@
+/*==========================================================
+ * sampleImage: sample an input image at the coordinates of a map,
+ * replaces the interp2 loops of makeOutputImage...
+ *
+ * outputImage = sampleImage(inputImage, x, y);
+ * outputImage = sampleImage(inputImage, x, y, filter);
+ * outputImage = sampleImage(inputImage, x, y, filter, jacobian);
+ * outputImage = sampleImage(inputImage, x, y, filter, jacobian, addressMode);
+ * [outputImage, mirrorParity] = sampleImage(inputImage, x, y, filter, jacobian, 'mirror');
+ *
+ * Input:
+ * inputImage: uint8 or single image of size (height, width, layers)
+ * x, y: matrices of the same size, single or double,
+ *     matlab pixel coordinates as for interp2: 1 <= x <= width, 1 <= y <= height,
+ *     pixels outside (depending on the address mode) or with NaN coordinates get 0 (black)
+ * filter: string, default 'linear'
+ *     'linear': bilinear interpolation, same as
+ *               interp2(single(inputImage(:,:,k)), x, y, 'linear', 0)
+ *     'mip':    trilinear interpolation in a mip pyramid of the input image,
+ *               the level depends on the size of the footprint of the
+ *               output pixel in the input image, no aliasing where the map
+ *               compresses the input image (Poincare disc boundary, spirals, ...)
+ *     'aniso':  anisotropic, up to 8 trilinear samples along the long side
+ *               of the footprint, sharper than 'mip' for stretched footprints
+ *
+ * the footprint comes from the differences of x and y to neighbouring pixels,
+ * the smaller one of the two sides, to ignore jumps at borders of tiles
+ *
+ * jacobian: optional single array of size (size(x), 4), exact footprint
+ *     dx/du, dy/du, dx/dv, dy/dv in pixels of the input image,
+ *     u is the column and v the row index of the output image,
+ *     from the layers 4 to 7 of a map with jacobian, scaled as x and y
+ *     use [] if there is no jacobian but an address mode
+ *
+ * memory per call: the input image itself is sampled, it is not copied,
+ *     'mip' and 'aniso' add float levels, 4/3 bytes per texel and layer of the input image
+ *     see sampleImageBenchmark.m for the times
+ *
+ * addressMode: string, what to do with coordinates outside of the input image
+ *     'border': black (default, as interp2)
+ *     'clamp':  the nearest pixel at the border
+ *     'repeat': periodic continuation of the input image
+ *     'mirror': mirrored at the borders x = 1, x = width, y = 1, y = height,
+ *               as mirrorsMap, without an extra pass over the map
+ *     use [] for the default filter or jacobian
+ *
+ * returns the output image of size (size(x), layers), same class as inputImage
+ * and for 'mirror' the number of mirrorings modulo 2 as a single matrix,
+ * combine with the parity of the map: mod(map(:,:,3) + mirrorParity, 2)
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#define MAX_LEVELS 32
+#define MAX_LAYERS 4
+#define MAX_ANISOTROPY 8
+#define PARALLEL_MIN 10000
+
+enum filterType {LINEAR, MIP, ANISO};
+enum addressMode {BORDER, CLAMP, REPEAT, MIRROR};
+
+/* one level of the pyramid, texel t = row + height * column has its layers
+ * at t * texelStep + layer * layerStep in data, or in bytes for level 0 of uint8 images*/
+typedef struct {
+    float *data;
+    uint8_t *bytes;
+    int texelStep, layerStep;
+    int width, height;
+    /* level 0 is the input image itself, it is not copied*/
+    bool isInput;
+} level;
+
+typedef struct {
+    level levels[MAX_LEVELS];
+    int nLevels, layers;
+    /* size of level 0*/
+    float width, height;
+    enum addressMode mode;
+} pyramid;
+
+/* puts a zero based coordinate into 0 ... size - 1 for the address mode*/
+/* adds the number of mirrorings to flips*/
+static inline float fold(float u, float size, enum addressMode mode, int *flips)
+{
+    float last, k;
+    last = size - 1;
+    switch (mode) {
+        case REPEAT:
+            u -= size * floorf(u / size);
+            /* rounding may give size*/
+            return (u < size) ? u : 0.0f;
+        case MIRROR:
+            if (last <= 0) {
+                return 0.0f;
+            }
+            /* even k: u - k * last, odd k: mirrored*/
+            k = floorf(u / last);
+            u -= k * last;
+            if (fmodf(k, 2.0f) != 0) {
+                u = last - u;
+                *flips += 1;
+            }
+            return (u < 0.0f) ? 0.0f : (u > last) ? last : u;
+        default:
+            return (u < 0.0f) ? 0.0f : (u > last) ? last : u;
+    }
+}
+
+static inline int texel(const level *lev, int row, int column)
+{
+    return row + lev->height * column;
+}
+
+/* a layer of a texel as float*/
+static inline float texelValue(const level *lev, int t, int layer)
+{
+    int i = t * lev->texelStep + layer * lev->layerStep;
+    return (lev->bytes != NULL) ? (float) lev->bytes[i] : lev->data[i];
+}
+
+/* memory for a coarse level of given size, layers interleaved*/
+static void allocateLevel(level *lev, int width, int height, int layers)
+{
+    lev->width = width;
+    lev->height = height;
+    lev->texelStep = layers;
+    lev->layerStep = 1;
+    lev->isInput = false;
+    lev->bytes = NULL;
+    lev->data = (float *) mxMalloc((size_t) width * height * layers * sizeof(float));
+}
+
+/* level 0 is the input image, coarser levels are float, by averaging 2x2 texels*/
+static void buildPyramid(pyramid *p, const mxArray *image, int nLevels)
+{
+    const mwSize *dims;
+    int width, height, layers, row, column, layer, r0, r1, c0, c1;
+    level *fine, *coarse, *first;
+    dims = mxGetDimensions(image);
+    height = dims[0];
+    width = dims[1];
+    layers = (mxGetNumberOfDimensions(image) > 2) ? dims[2] : 1;
+    p->layers = layers;
+    p->width = width;
+    p->height = height;
+    /* matlab order, layer after layer*/
+    first = &p->levels[0];
+    first->width = width;
+    first->height = height;
+    first->texelStep = 1;
+    first->layerStep = width * height;
+    first->isInput = true;
+    first->data = NULL;
+    first->bytes = NULL;
+    if (mxIsUint8(image)) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        first->bytes = mxGetUint8s(image);
+#else
+        first->bytes = (uint8_t *) mxGetData(image);
+#endif
+    } else {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        first->data = mxGetSingles(image);
+#else
+        first->data = (float *) mxGetData(image);
+#endif
+    }
+    p->nLevels = 1;
+    while ((p->nLevels < nLevels) && ((width > 1) || (height > 1))) {
+        fine = &p->levels[p->nLevels - 1];
+        coarse = &p->levels[p->nLevels];
+        allocateLevel(coarse, (fine->width + 1) / 2, (fine->height + 1) / 2, layers);
+        for (column = 0; column < coarse->width; column++){
+            c0 = 2 * column;
+            c1 = (c0 + 1 < fine->width) ? c0 + 1 : c0;
+            for (row = 0; row < coarse->height; row++){
+                r0 = 2 * row;
+                r1 = (r0 + 1 < fine->height) ? r0 + 1 : r0;
+                for (layer = 0; layer < layers; layer++){
+                    coarse->data[texel(coarse, row, column) * layers + layer] = 0.25f * (
+                            texelValue(fine, texel(fine, r0, c0), layer)
+                            + texelValue(fine, texel(fine, r1, c0), layer)
+                            + texelValue(fine, texel(fine, r0, c1), layer)
+                            + texelValue(fine, texel(fine, r1, c1), layer));
+                }
+            }
+        }
+        width = coarse->width;
+        height = coarse->height;
+        p->nLevels++;
+    }
+}
+
+static void freePyramid(pyramid *p)
+{
+    int l;
+    for (l = 0; l < p->nLevels; l++){
+        if (!p->levels[l].isInput) {
+            mxFree(p->levels[l].data);
+            mxFree(p->levels[l].bytes);
+        }
+    }
+}
+
+/* add weight * bilinear interpolation at (u, v) of a level to color,
+ * u, v are zero based column and row of level 0*/
+static void addBilinear(const pyramid *p, int l, float u, float v, float weight, float *color)
+{
+    const level *lev = &p->levels[l];
+    float scale, fu, fv, w00, w01, w10, w11;
+    int c0, c1, r0, r1, layer, layers = p->layers, step;
+    int i00, i01, i10, i11;
+    const float *data;
+    const uint8_t *bytes;
+    /* texel centers of level l are at 2^l * t + (2^l - 1) / 2 in level 0*/
+    if (l > 0) {
+        scale = 1.0f / (float) (1 << l);
+        u = (u + 0.5f) * scale - 0.5f;
+        v = (v + 0.5f) * scale - 0.5f;
+    }
+    /* anisotropic probes may lie outside*/
+    /* periodic images interpolate between the last and the first texel*/
+    if (p->mode == REPEAT) {
+        u = (u < 0.0f) ? 0.0f : u;
+        v = (v < 0.0f) ? 0.0f : v;
+        c0 = (int) u;
+        r0 = (int) v;
+        c0 = (c0 < lev->width) ? c0 : lev->width - 1;
+        r0 = (r0 < lev->height) ? r0 : lev->height - 1;
+        c1 = (c0 + 1 < lev->width) ? c0 + 1 : 0;
+        r1 = (r0 + 1 < lev->height) ? r0 + 1 : 0;
+        u = (u < c0 + 1) ? u : c0 + 1;
+        v = (v < r0 + 1) ? v : r0 + 1;
+    } else {
+        u = (u < 0.0f) ? 0.0f : (u > lev->width - 1) ? lev->width - 1 : u;
+        v = (v < 0.0f) ? 0.0f : (v > lev->height - 1) ? lev->height - 1 : v;
+        c0 = (int) u;
+        r0 = (int) v;
+        c1 = (c0 + 1 < lev->width) ? c0 + 1 : c0;
+        r1 = (r0 + 1 < lev->height) ? r0 + 1 : r0;
+    }
+    fu = u - c0;
+    fv = v - r0;
+    w00 = weight * (1 - fu) * (1 - fv);
+    w01 = weight * fu * (1 - fv);
+    w10 = weight * (1 - fu) * fv;
+    w11 = weight * fu * fv;
+    i00 = texel(lev, r0, c0) * lev->texelStep;
+    i01 = texel(lev, r0, c1) * lev->texelStep;
+    i10 = texel(lev, r1, c0) * lev->texelStep;
+    i11 = texel(lev, r1, c1) * lev->texelStep;
+    step = lev->layerStep;
+    if (lev->bytes != NULL) {
+        bytes = lev->bytes;
+        for (layer = 0; layer < layers; layer++){
+            color[layer] += w00 * bytes[i00] + w01 * bytes[i01] + w10 * bytes[i10] + w11 * bytes[i11];
+            i00 += step;
+            i01 += step;
+            i10 += step;
+            i11 += step;
+        }
+        return;
+    }
+    data = lev->data;
+    for (layer = 0; layer < layers; layer++){
+        color[layer] += w00 * data[i00] + w01 * data[i01] + w10 * data[i10] + w11 * data[i11];
+        i00 += step;
+        i01 += step;
+        i10 += step;
+        i11 += step;
+    }
+}
+
+/* trilinear: between the two levels next to lod*/
+static void addTrilinear(const pyramid *p, float lod, float u, float v, float weight, float *color)
+{
+    int l, flips;
+    float t;
+    /* anisotropic probes may lie outside*/
+    if (p->mode != BORDER) {
+        flips = 0;
+        u = fold(u, p->width, p->mode, &flips);
+        v = fold(v, p->height, p->mode, &flips);
+    }
+    lod = (lod < 0.0f) ? 0.0f : (lod > p->nLevels - 1) ? p->nLevels - 1 : lod;
+    l = (int) lod;
+    t = lod - l;
+    if ((t > 0) && (l + 1 < p->nLevels)) {
+        addBilinear(p, l, u, v, weight * (1 - t), color);
+        addBilinear(p, l + 1, u, v, weight * t, color);
+    } else {
+        addBilinear(p, l, u, v, weight, color);
+    }
+}
+
+/* the derivative of a coordinate along rows or columns:
+ * the smaller of the one sided differences, ignores jumps and NaN*/
+static float derivative(const float *c, int index, int step, bool hasBefore, bool hasAfter)
+{
+    float before, after;
+    before = hasBefore ? c[index] - c[index - step] : NAN;
+    after = hasAfter ? c[index + step] - c[index] : NAN;
+    if (isnan(before)) {
+        return isnan(after) ? 0.0f : after;
+    }
+    if (isnan(after)) {
+        return before;
+    }
+    return (fabsf(before) < fabsf(after)) ? before : after;
+}
+
+/* the coordinates as float arrays, converted if double*/
+static float *getCoordinates(const mxArray *c, int n, bool *isCopy)
+{
+    double *doubles;
+    float *singles;
+    int i;
+    if (mxIsSingle(c)) {
+        *isCopy = false;
+#if MX_HAS_INTERLEAVED_COMPLEX
+        return mxGetSingles(c);
+#else
+        return (float *) mxGetData(c);
+#endif
+    }
+#if MX_HAS_INTERLEAVED_COMPLEX
+    doubles = mxGetDoubles(c);
+#else
+    doubles = mxGetPr(c);
+#endif
+    singles = (float *) mxMalloc(n * sizeof(float));
+    for (i = 0; i < n; i++){
+        singles[i] = (float) doubles[i];
+    }
+    *isCopy = true;
+    return singles;
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    const mwSize *dims, *xDims;
+    mwSize outDims[3];
+    int nX, nY, nXnY, index, row, column, layer, layers, i, nSamples;
+    enum filterType filter = LINEAR;
+    char filterName[16], modeName[16];
+    enum addressMode mode = BORDER;
+    int flips;
+    float *mirrorParity = NULL;
+    float *x, *y, *jacobian = NULL, *outSingles = NULL;
+    uint8_t *outBytes = NULL;
+    bool xIsCopy, yIsCopy, isBytes, inside;
+    float u, v, uFolded, vFolded, dxdu, dydu, dxdv, dydv, lengthU, lengthV, major, minor, lod, t, value;
+    float color[MAX_LAYERS];
+    pyramid p;
+    /* check for proper number of arguments (else crash)*/
+    if(nrhs < 3) {
+        mexErrMsgIdAndTxt("sampleImage:nrhs","An input image and x and y coordinates required.");
+    }
+    if (!mxIsUint8(prhs[0]) && !mxIsSingle(prhs[0])) {
+        mexErrMsgIdAndTxt("sampleImage:image","The input image has to be uint8 or single.");
+    }
+    dims = mxGetDimensions(prhs[0]);
+    layers = (mxGetNumberOfDimensions(prhs[0]) > 2) ? dims[2] : 1;
+    if ((mxGetNumberOfDimensions(prhs[0]) > 3) || (layers > MAX_LAYERS)) {
+        mexErrMsgIdAndTxt("sampleImage:image","The input image has to have at most 4 layers.");
+    }
+    xDims = mxGetDimensions(prhs[1]);
+    if ((mxGetNumberOfDimensions(prhs[1]) != 2) || (mxGetNumberOfDimensions(prhs[2]) != 2)
+            || (mxGetM(prhs[2]) != xDims[0]) || (mxGetN(prhs[2]) != xDims[1])) {
+        mexErrMsgIdAndTxt("sampleImage:coordinates","x and y have to be matrices of the same size.");
+    }
+    if ((!mxIsSingle(prhs[1]) && !mxIsDouble(prhs[1])) || (!mxIsSingle(prhs[2]) && !mxIsDouble(prhs[2]))) {
+        mexErrMsgIdAndTxt("sampleImage:coordinates","x and y have to be single or double.");
+    }
+    if ((nrhs > 3) && !mxIsEmpty(prhs[3])) {
+        if (!mxIsChar(prhs[3]) || (mxGetString(prhs[3], filterName, sizeof(filterName)) != 0)) {
+            mexErrMsgIdAndTxt("sampleImage:filter","The filter has to be 'linear', 'mip' or 'aniso'.");
+        }
+        if (strcmp(filterName, "linear") == 0) {
+            filter = LINEAR;
+        } else if (strcmp(filterName, "mip") == 0) {
+            filter = MIP;
+        } else if (strcmp(filterName, "aniso") == 0) {
+            filter = ANISO;
+        } else {
+            mexErrMsgIdAndTxt("sampleImage:filter","The filter has to be 'linear', 'mip' or 'aniso'.");
+        }
+    }
+    if ((nrhs > 4) && !mxIsEmpty(prhs[4])) {
+        if (!mxIsSingle(prhs[4]) || (mxGetNumberOfElements(prhs[4]) != 4 * mxGetNumberOfElements(prhs[1]))) {
+            mexErrMsgIdAndTxt("sampleImage:jacobian","The jacobian has to be a single array of size (size(x), 4).");
+        }
+#if MX_HAS_INTERLEAVED_COMPLEX
+        jacobian = mxGetSingles(prhs[4]);
+#else
+        jacobian = (float *) mxGetData(prhs[4]);
+#endif
+    }
+    if ((nrhs > 5) && !mxIsEmpty(prhs[5])) {
+        if (!mxIsChar(prhs[5]) || (mxGetString(prhs[5], modeName, sizeof(modeName)) != 0)) {
+            mexErrMsgIdAndTxt("sampleImage:addressMode","The address mode has to be 'border', 'clamp', 'repeat' or 'mirror'.");
+        }
+        if (strcmp(modeName, "border") == 0) {
+            mode = BORDER;
+        } else if (strcmp(modeName, "clamp") == 0) {
+            mode = CLAMP;
+        } else if (strcmp(modeName, "repeat") == 0) {
+            mode = REPEAT;
+        } else if (strcmp(modeName, "mirror") == 0) {
+            mode = MIRROR;
+        } else {
+            mexErrMsgIdAndTxt("sampleImage:addressMode","The address mode has to be 'border', 'clamp', 'repeat' or 'mirror'.");
+        }
+    }
+    /* check that output is possible*/
+    if ((nlhs > 2) || ((nlhs == 2) && (mode != MIRROR))) {
+        mexErrMsgIdAndTxt("sampleImage:nlhs","Has one return parameter, two for the address mode 'mirror'.");
+    }
+    nY = xDims[0];
+    nX = xDims[1];
+    nXnY = nX * nY;
+    x = getCoordinates(prhs[1], nXnY, &xIsCopy);
+    y = getCoordinates(prhs[2], nXnY, &yIsCopy);
+    buildPyramid(&p, prhs[0], (filter == LINEAR) ? 1 : MAX_LEVELS);
+    p.mode = mode;
+    isBytes = mxIsUint8(prhs[0]);
+    outDims[0] = nY;
+    outDims[1] = nX;
+    outDims[2] = layers;
+    plhs[0] = mxCreateNumericArray(3, outDims, isBytes ? mxUINT8_CLASS : mxSINGLE_CLASS, mxREAL);
+    if (isBytes) {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outBytes = mxGetUint8s(plhs[0]);
+#else
+        outBytes = (uint8_t *) mxGetData(plhs[0]);
+#endif
+    } else {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outSingles = mxGetSingles(plhs[0]);
+#else
+        outSingles = (float *) mxGetData(plhs[0]);
+#endif
+    }
+    if (nlhs == 2) {
+        plhs[1] = mxCreateNumericMatrix(nY, nX, mxSINGLE_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        mirrorParity = mxGetSingles(plhs[1]);
+#else
+        mirrorParity = (float *) mxGetData(plhs[1]);
+#endif
+    }
+    /* do the image*/
+    /* row first order*/
+#pragma omp parallel for private(row, index, u, v, uFolded, vFolded, flips, inside, dxdu, dydu, dxdv, dydv, lengthU, lengthV, major, minor, lod, t, value, color, layer, i, nSamples) if (nXnY > PARALLEL_MIN)
+    for (column = 0; column < nX; column++){
+        for (row = 0; row < nY; row++){
+            index = row + nY * column;
+            for (layer = 0; layer < layers; layer++){
+                color[layer] = 0;
+            }
+            /* zero based coordinates, outside as interp2: black, or folded inside*/
+            /* the anisotropic probes fold on their own, mirrors change their direction*/
+            u = x[index] - 1;
+            v = y[index] - 1;
+            uFolded = u;
+            vFolded = v;
+            if (mode == BORDER) {
+                inside = (u >= 0) && (u <= p.width - 1) && (v >= 0) && (v <= p.height - 1);
+            } else {
+                inside = isfinite(u) && isfinite(v);
+                if (inside) {
+                    flips = 0;
+                    uFolded = fold(u, p.width, mode, &flips);
+                    vFolded = fold(v, p.height, mode, &flips);
+                    if (mirrorParity != NULL) {
+                        mirrorParity[index] = flips & 1;
+                    }
+                }
+            }
+            if (inside) {
+                if (filter == LINEAR) {
+                    addBilinear(&p, 0, uFolded, vFolded, 1.0f, color);
+                } else {
+                    /* footprint: derivatives along the columns (u) and rows (v) of the output image*/
+                    if (jacobian != NULL) {
+                        dxdu = jacobian[index];
+                        dydu = jacobian[index + nXnY];
+                        dxdv = jacobian[index + 2 * nXnY];
+                        dydv = jacobian[index + 3 * nXnY];
+                    } else {
+                        dxdu = derivative(x, index, nY, column > 0, column < nX - 1);
+                        dydu = derivative(y, index, nY, column > 0, column < nX - 1);
+                        dxdv = derivative(x, index, 1, row > 0, row < nY - 1);
+                        dydv = derivative(y, index, 1, row > 0, row < nY - 1);
+                    }
+                    lengthU = sqrtf(dxdu * dxdu + dydu * dydu);
+                    lengthV = sqrtf(dxdv * dxdv + dydv * dydv);
+                    major = fmaxf(lengthU, lengthV);
+                    minor = fminf(lengthU, lengthV);
+                    if ((filter == MIP) || (major <= 1.0f)) {
+                        lod = log2f(fmaxf(major, 1.0f));
+                        addTrilinear(&p, lod, u, v, 1.0f, color);
+                    } else {
+                        /* samples along the major axis, level from the minor axis*/
+                        nSamples = (int) ceilf(major / fmaxf(minor, 1e-6f));
+                        nSamples = (nSamples > MAX_ANISOTROPY) ? MAX_ANISOTROPY : nSamples;
+                        lod = log2f(fmaxf(major / nSamples, 1.0f));
+                        if (lengthV > lengthU) {
+                            dxdu = dxdv;
+                            dydu = dydv;
+                        }
+                        for (i = 0; i < nSamples; i++){
+                            t = (i + 0.5f) / nSamples - 0.5f;
+                            addTrilinear(&p, lod, u + t * dxdu, v + t * dydu, 1.0f / nSamples, color);
+                        }
+                    }
+                }
+            }
+            for (layer = 0; layer < layers; layer++){
+                value = color[layer];
+                if (isBytes) {
+                    value = (value < 0.0f) ? 0.0f : (value > 254.5f) ? 255.0f : value + 0.5f;
+                    outBytes[index + layer * nXnY] = (uint8_t) value;
+                } else {
+                    outSingles[index + layer * nXnY] = value;
+                }
+            }
+        }
+    }
+    freePyramid(&p);
+    if (xIsCopy) {
+        mxFree(x);
+    }
+    if (yIsCopy) {
+        mxFree(y);
+    }
+}
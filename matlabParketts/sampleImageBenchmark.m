@@ -0,0 +1,40 @@
+% benchmark of sampleImage against interp2
+% sampleImageBenchmark(mPix, inputHeight)
+% mPix: size of the map in megapixels, default 25
+% inputHeight: the input image is scaled to this height, default 6000
+% (large photos do not fit into the cache, the map jumps around in them)
+% prints the times of interp2 and of sampleImage with the filters
+
+function sampleImageBenchmark(mPix, inputHeight)
+if nargin < 1
+    mPix = 25;
+end
+if nargin < 2
+    inputHeight = 6000;
+end
+% a kaleidoscope map, the tiles sample the input image in all directions
+map=createIdentityMap(mPix,-1,1,-1,1);
+basicKaleidoscope(map,7,3,2);
+inputImage = imread("1.jpg");
+inputImage = imresize(inputImage, inputHeight / size(inputImage, 1));
+[inputHeight, inputWidth, ~] = size(inputImage);
+% fit as in makeOutputImageFitMapToInput
+[xMin,xMax,yMin,yMax] = getRangeMap(map);
+scale = single(min((inputWidth - 2) / (xMax - xMin), (inputHeight - 2) / (yMax - yMin)));
+x = scale * map(:,:,1) + 1 - scale * xMin;
+y = scale * map(:,:,2) + 1 - scale * yMin;
+fprintf('map %d x %d, input image %d x %d\n', size(map, 1), size(map, 2), inputHeight, inputWidth);
+tic
+outputImage = zeros(size(x, 1), size(x, 2), 3, 'uint8');
+for k = 1:3
+    outputImage(:,:,k) = uint8(interp2(single(inputImage(:,:,k)), x, y, 'linear', 0));
+end
+fprintf('%-8s %8.3f s\n', 'interp2', toc);
+filters = {'linear', 'mip', 'aniso'};
+for i = 1:numel(filters)
+    tic
+    outputImage = sampleImage(inputImage, x, y, filters{i});
+    fprintf('%-8s %8.3f s\n', filters{i}, toc);
+end
+imshow(outputImage);
+end
@@ -0,0 +1,14 @@
+% saveMap: save a map packed into a file, lossless and several times smaller
+% saveMap(fileName, map);
+%
+% map: single array of size (nY, nX, layers)
+% load it with map = loadMap(fileName), see packMap.c and mapCodec.h
+
+function saveMap(fileName, map)
+    file = fopen(fileName, 'w');
+    if file < 0
+        error('saveMap:open', 'Could not open %s.', fileName);
+    end
+    fwrite(file, packMap(map), 'uint8');
+    fclose(file);
+end
@@ -0,0 +1,36 @@
+% bake the geometry of a kaleidoscope for one input image size
+% and render several photos of this size with it
+
+function testBakedMap()
+% make the initial map
+s = 1000;
+mPix=s*s/1e6;
+map=createIdentityMap(mPix,-1,1,-1,1);
+% transform the map into a kaleidoscope
+basicKaleidoscope(map,7,3,2);
+% read the input images, the second of the same size
+inputImage = imread("1.jpg");
+[inputHeight, inputWidth, ~] = size(inputImage);
+otherImage = imresize(imread("3.jpg"), [inputHeight, inputWidth]);
+% fit the map into the input image, as makeOutputImageFitMapToInput
+tic
+[xMin,xMax,yMin,yMax]  = getRangeMap(map);
+scale = single(min((inputWidth - 2) / (xMax - xMin), (inputHeight - 2) / (yMax - yMin)));
+x = scale * map(:,:,1) + 1 - scale * xMin;
+y = scale * map(:,:,2) + 1 - scale * yMin;
+% bake once, 6 bytes per pixel, save it with the size of the input image
+baked = bakeMap(x, y, map(:,:,3));
+fprintf('bake %f s\n', toc);
+% each photo is only a gather
+tic
+outputImage = sampleBakedMap(inputImage, baked);
+otherOutputImage = sampleBakedMap(otherImage, baked);
+fprintf('two baked images %f s\n', toc);
+tic
+reference = makeOutputImageFitMapToInput(map, inputImage);
+fprintf('makeOutputImageFitMapToInput %f s\n', toc);
+% the fixed point coordinates differ from interp2 by at most one gray level
+fprintf('maximum difference to interp2: %d\n', ...
+    max(abs(int16(outputImage(:)) - int16(reference(:)))));
+montage({outputImage, otherOutputImage}, 'Size', [1, 2]);
+end
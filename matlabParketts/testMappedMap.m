@@ -0,0 +1,27 @@
+% a kaleidoscope map of 2 gigapixels (24 GB) in a file,
+% larger than the memory, and its structure image as a PNG file
+% each step goes band by band through the map
+
+function testMappedMap()
+% the map file, on a disk with enough space
+mapFile = "large.map";
+mPix = 2000;
+tic
+handle = mappedMap('create', mapFile, identityGrid(mPix, -1, 1));
+fprintf('identity map %f s\n', toc);
+% transform the map into a kaleidoscope
+tic
+transformMappedMap(handle, @(map) basicKaleidoscope(map, 7, 3, 2));
+fprintf('kaleidoscope %f s\n', toc);
+% image of the structure, band by band into the PNG writer
+tic
+sizes = mappedMap('size', handle);
+writer = imageWriter('open', "largeStructure.png", sizes(1), sizes(2), 1);
+for band = 1:sizes(5)
+    map = mappedMap('read', handle, band);
+    imageWriter('write', writer, uint8(255 * createStructureImage(map)));
+end
+imageWriter('close', writer);
+mappedMap('close', handle);
+fprintf('structure image %f s\n', toc);
+end
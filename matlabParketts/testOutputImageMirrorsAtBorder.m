@@ -11,7 +11,21 @@ map=createIdentityMap(mPix,-range,range,0,2*range);
 % read an input image
 inputImage = imread("3.jpg");
 % fit map inside input image
+tic
 outputImage = makeOutputImageMirrorsAtBorders(map, inputImage);
+fprintf('mirror address mode %f s\n', toc);
+% the same with mirrorsMap and interp2, mirrors at x = width and y = height
+tic
+[inputHeight, inputWidth, imageLayers] = size(inputImage);
+limitedMap = mirrorsMap(map, inputWidth - 1, inputHeight - 1);
+referenceImage = zeros(size(outputImage), 'uint8');
+for k = 1:imageLayers
+    referenceImage(:,:,k) = uint8(interp2(single(inputImage(:,:,k)), ...
+        limitedMap(:,:,1) + 1, limitedMap(:,:,2) + 1, 'linear', 0));
+end
+fprintf('mirrorsMap and interp2 %f s\n', toc);
+fprintf('maximum difference: %d\n', ...
+    max(abs(int16(outputImage(:)) - int16(referenceImage(:)))));
 % show (and save) the image
 imshow(outputImage);
 %imwrite(outputImage,'imageName.jpg');
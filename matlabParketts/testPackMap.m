@@ -0,0 +1,23 @@
+% pack a kaleidoscope map, save it, load it and compare,
+% the map has to be exactly the same
+
+function testPackMap()
+% make the initial map
+s = 4000;
+mPix=s*s/1e6;
+map=createIdentityMap(mPix,-1,1,-1,1);
+% transform the map into a kaleidoscope
+basicKaleidoscope(map,7,3,2);
+tic
+packed = packMap(map);
+fprintf('pack %f s, %d bytes to %d bytes, %.1f times smaller\n', toc, ...
+    4 * numel(map), numel(packed), 4 * numel(map) / numel(packed));
+tic
+unpacked = unpackMap(packed);
+fprintf('unpack %f s\n', toc);
+fprintf('equal: %d\n', isequaln(map, unpacked));
+% through a file
+saveMap("kaleidoscope.map", map);
+loaded = loadMap("kaleidoscope.map");
+fprintf('equal after saving: %d\n', isequaln(map, loaded));
+end
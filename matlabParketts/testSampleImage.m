@@ -0,0 +1,30 @@
+% compare the filters of sampleImage with interp2
+% for a kaleidoscope that compresses the input image strongly
+% near the boundary of the Poincare disc
+
+function testSampleImage()
+% make the initial map
+s = 1000;
+mPix=s*s/1e6;
+map=createIdentityMap(mPix,-1,1,-1,1);
+% transform the map into a kaleidoscope
+basicKaleidoscope(map,7,3,2);
+% read an input image
+inputImage = imread("1.jpg");
+% interp2 and the filters of sampleImage
+tic
+interp2Image = makeOutputImageFitMapToInput(map, inputImage);
+fprintf('interp2 %f s\n', toc);
+filters = {'linear', 'mip', 'aniso'};
+images = cell(1, 3);
+for k = 1:3
+    tic
+    images{k} = makeOutputImageFitMapToInput(map, inputImage, filters{k});
+    fprintf('%s %f s\n', filters{k}, toc);
+end
+% 'linear' is the same as interp2, up to rounding
+fprintf('maximum difference linear - interp2: %d\n', ...
+    max(abs(int16(images{1}(:)) - int16(interp2Image(:)))));
+% show the images, the Moire patterns at the boundary disappear with 'mip'
+montage({interp2Image, images{2}, images{3}}, 'Size', [1, 3]);
+end
@@ -0,0 +1,19 @@
+% animate a square *442 tiling with a changing period
+% the new map is written into a preallocated destination
+% no allocation of maps inside the loop
+
+function testTiling442Animation()
+% make the initial map
+s = 1000;
+mPix=s*s/1e6;
+map=createIdentityMap(mPix,-1,1,-1,1);
+% the destination, the same size as the map, allocated once
+tilingMap=zeros(size(map),'single');
+for frame=1:100
+    period=0.1+0.4*frame/100;
+    tiling442(map,tilingMap,period);
+    im=createStructureImage(tilingMap);
+    imshow(im);
+    drawnow;
+end
+end
@@ -21,6 +21,26 @@
  * does not change the map and returns a modified map if used as  a function
  * newMap = tiling442(map, size);
  *
+ * returns additionally the tiles as a uint32 array of size (nY, nX, 2) 
+ * [newMap, tiles] = tiling442(map, size);
+ *     tiles(h,k,1) = number of mirror lines between the point and the basic triangle 0<=y<=x<=size/2
+ *     tiles(h,k,2) = hash of the tile (cell and its mirror images), the same for each call
+ *     invalid pixels have length 0 and hash 0
+ *
+ * stacks of maps and sizes, all frames are done in one call:
+ *  the map may be an array of size (nY, nX, 3, nFrames), a stack of maps
+ *  size may be a vector with a value for each frame, a scalar is used for all frames
+ *  for a single map and a vector of sizes a stack of new maps is returned:
+ *  newMaps = tiling442(map, [0.1 0.2 0.3]);
+ *  the tiles are then of size (nY, nX, 2, nFrames)
+ *
+ * writes the result into a destination map of the right size, for animations without allocation
+ *  tiling442(map, destination, size);
+ *  the destination is a single array with the rows and columns of the map (not a scalar size)
+ *  the destination is modified in place, it may be the map itself
+ *
+ * compile with openMP to use all cores (see compile.m)
+ *
  *========================================================*/
 
 #include "mex.h"
@@ -28,35 +48,84 @@
 #include <complex.h>
 #include <tgmath.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
+#include "cellRandom.h"
 #define PRINTI(n) printf(#n " = %d\n", n)
 #define PRINTF(n) printf(#n " = %f\n", n)
 #define INVALID -1000
+#define PARALLEL_MIN 10000
 
 void mexFunction( int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     const mwSize *dims;
-    int nX, nY, nXnY, nXnY2, index;
+    mwSize outDims[4], tileDims[4];
+    int nX, nY, nXnY, nXnY2, index, frame;
+    ptrdiff_t task, nTasks;
+    int nMapFrames, nSizes, nFrames;
     float inverted;
-    float *inMap, *outMap;
+    float *inMap, *outMap, *frameInMap, *frameOutMap;
+    double *sizes, scalarSize;
+    uint32_t *tiles, *frameTiles;
+    int iCellTile, jCellTile, flips;
     float size, sizeHalf, x, y, h;
     bool returnsMap = false;
+    bool hasDestination;
+    const mxArray *sizeArray;
     /* check for proper number of arguments (else crash)*/
     /* checking for presence of a map*/
     if(nrhs < 2) {
         mexErrMsgIdAndTxt("tiling442:nrhs","A map input and (scalar) size required.");
     }
-    /* check number of dimensions of the map*/
-    if(mxGetNumberOfDimensions(prhs[0]) !=3 ) {
-        mexErrMsgIdAndTxt("tiling442:mapDims","The map has to have three dimensions.");
+    /* check number of dimensions of the map, a stack of maps has four*/
+    if((mxGetNumberOfDimensions(prhs[0]) != 3) && (mxGetNumberOfDimensions(prhs[0]) != 4)) {
+        mexErrMsgIdAndTxt("tiling442:mapDims","The map has to have three or four dimensions.");
     }
     dims = mxGetDimensions(prhs[0]);
     if(dims[2] != 3) {
         mexErrMsgIdAndTxt("tiling442:map3rdDimension","The map's third dimension has to be three.");
     }
-    /* check that no or one output is expected*/
-    if (nlhs > 1) {
-        mexErrMsgIdAndTxt("tiling442:nlhs","Has zero or one return parameter.");
+    nMapFrames = (mxGetNumberOfDimensions(prhs[0]) == 4) ? dims[3] : 1;
+    /* a single array with the rows and columns of the map as second argument is the destination map*/
+    /* the size may be a single scalar*/
+    hasDestination = mxIsSingle(prhs[1]) && (mxGetNumberOfDimensions(prhs[1]) >= 3)
+            && (mxGetDimensions(prhs[1])[0] == dims[0]) && (mxGetDimensions(prhs[1])[1] == dims[1]);
+    if (hasDestination && (nrhs < 3)){
+        mexErrMsgIdAndTxt("tiling442:nrhs","A map input, a destination and (scalar) size required.");
+    }
+    sizeArray = hasDestination ? prhs[2] : prhs[1];
+    /* the size is a scalar of any class or a double vector with a value for each frame*/
+    nSizes = mxGetNumberOfElements(sizeArray);
+    if (nSizes < 1) {
+        mexErrMsgIdAndTxt("tiling442:size","The size is missing.");
+    }
+    if ((nSizes > 1) && !mxIsDouble(sizeArray)) {
+        mexErrMsgIdAndTxt("tiling442:sizeClass","Vectors of sizes have to be double.");
+    }
+    if ((nMapFrames > 1) && (nSizes > 1) && (nMapFrames != nSizes)){
+        mexErrMsgIdAndTxt("tiling442:frames","Need as many sizes as maps.");
+    }
+    nFrames = (nMapFrames > 1) ? nMapFrames : nSizes;
+    /* check that no, one or two outputs are expected*/
+    if (nlhs > 2) {
+        mexErrMsgIdAndTxt("tiling442:nlhs","Has zero, one or two return parameters.");
+    }
+    /* several sizes for one map make a stack of new maps*/
+    if ((nlhs == 0) && (nFrames > nMapFrames) && !hasDestination){
+        mexErrMsgIdAndTxt("tiling442:nlhs","Returns a stack of maps for a vector of sizes.");
+    }
+    if (hasDestination){
+        const mwSize *destinationDims = mxGetDimensions(prhs[1]);
+        if ((mxGetNumberOfDimensions(prhs[1]) < 3) || (destinationDims[0] != dims[0]) || (destinationDims[1] != dims[1]) 
+                || (destinationDims[2] != 3) || (mxGetNumberOfElements(prhs[1]) != 3 * dims[0] * dims[1] * nFrames)){
+            mexErrMsgIdAndTxt("tiling442:destination","The destination has to have the size of the new map.");
+        }
+        if (nlhs > 0){
+            mexErrMsgIdAndTxt("tiling442:nlhs","Returns nothing if there is a destination map.");
+        }
     }
     /* get the map*/
 #if MX_HAS_INTERLEAVED_COMPLEX
@@ -64,59 +133,120 @@ void mexFunction( int nlhs, mxArray *plhs[],
 #else
     inMap = (float *) mxGetPr(prhs[0]);
 #endif
-    if (nlhs == 0){
+    if (nSizes > 1){
+#if MX_HAS_INTERLEAVED_COMPLEX
+        sizes = mxGetDoubles(sizeArray);
+#else
+        sizes = mxGetPr(sizeArray);
+#endif
+    } else {
+        scalarSize = mxGetScalar(sizeArray);
+        sizes = &scalarSize;
+    }
+    if (hasDestination){
+        /* write into the destination, if it is the map itself this is the procedure*/
+#if MX_HAS_INTERLEAVED_COMPLEX
+        outMap = mxGetSingles(prhs[1]);
+#else
+        outMap = (float *) mxGetPr(prhs[1]);
+#endif
+        returnsMap = (outMap != inMap);
+    } else if (nlhs == 0){
         outMap = inMap;
     } else {
         /* create output map*/
         returnsMap = true;
-        plhs[0]=mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
+        outDims[0] = dims[0];
+        outDims[1] = dims[1];
+        outDims[2] = 3;
+        outDims[3] = nFrames;
+        plhs[0]=mxCreateNumericArray((nFrames > 1) ? 4 : 3, outDims, mxSINGLE_CLASS, mxREAL);
 #if MX_HAS_INTERLEAVED_COMPLEX
         outMap = mxGetSingles(plhs[0]);
 #else
         outMap = (float *) mxGetPr(plhs[0]);
 #endif
     }
-    size = (float) mxGetScalar(prhs[1]);
-    sizeHalf = size / 2;
+    /* create the tiles, initialized to zero (invalid)*/
+    tiles = NULL;
+    if (nlhs == 2){
+        tileDims[0] = dims[0];
+        tileDims[1] = dims[1];
+        tileDims[2] = 2;
+        tileDims[3] = nFrames;
+        plhs[1] = mxCreateNumericArray((nFrames > 1) ? 4 : 3, tileDims, mxUINT32_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+        tiles = mxGetUint32s(plhs[1]);
+#else
+        tiles = (uint32_t *) mxGetData(plhs[1]);
+#endif
+    }
     
     /* do the map*/
     /* row first order*/
+    /* indices inside a frame are int, offsets of frames are size_t*/
+    if ((double) dims[0] * dims[1] * 3 > INT_MAX){
+        mexErrMsgIdAndTxt("tiling442:mapSize","A single map can have at most %d elements.", INT_MAX);
+    }
     nX = dims[1];
     nY = dims[0];
     nXnY = nX * nY;
     nXnY2 = 2 * nXnY;
-    for (index = 0; index < nXnY; index++){
-        inverted = inMap[index + nXnY2];
+    nTasks = (ptrdiff_t) nXnY * nFrames;
+    /* all pixels of all frames in parallel*/
+    #pragma omp parallel for private(index, frame, frameInMap, frameOutMap, frameTiles, size, sizeHalf, inverted, x, y, h, flips, iCellTile, jCellTile) if (nTasks > PARALLEL_MIN)
+    for (task = 0; task < nTasks; task++){
+        frame = (int) (task / nXnY);
+        index = (int) (task - (ptrdiff_t) frame * nXnY);
+        frameInMap = inMap + (size_t) ((nMapFrames > 1) ? frame : 0) * 3 * nXnY;
+        frameOutMap = outMap + (size_t) frame * 3 * nXnY;
+        frameTiles = (tiles == NULL) ? NULL : tiles + (size_t) frame * 2 * nXnY;
+        size = (float) sizes[(nSizes > 1) ? frame : 0];
+        sizeHalf = size / 2;
+        inverted = frameInMap[index + nXnY2];
         /* do only transform if pixel is valid*/
         if (inverted < -0.1f) {
             if (returnsMap){
                 /* set element only if new output map*/
-                outMap[index] = INVALID;
-                outMap[index + nXnY] = INVALID;
-                outMap[index + nXnY2] = INVALID;      
+                frameOutMap[index] = INVALID;
+                frameOutMap[index + nXnY] = INVALID;
+                frameOutMap[index + nXnY2] = INVALID;      
             }
             continue;
         }
-        x = inMap[index];
-        x = x - size * floorf(x / size);
+        x = frameInMap[index];
+        y = frameInMap[index + nXnY];
+        /* the tile is given by the cell and the mirrorings done in the cell*/
+        flips = 0;
+        if (frameTiles != NULL){
+            frameTiles[index] = mirrorsCrossed(x, y, size, sizeHalf);
+        }
+        iCellTile = (int) floorf(x / size);
+        x = x - size * iCellTile;
         if (x > sizeHalf) {
             x = size - x;
             inverted = 1 - inverted;
+            flips += 1;
         }
-        y = inMap[index + nXnY];
-        y = y - size * floorf(y / size);
+        jCellTile = (int) floorf(y / size);
+        y = y - size * jCellTile;
         if (y > sizeHalf) {
             y = size - y;
             inverted = 1 - inverted;
+            flips += 2;
         }
         if (y > x){
             h = x;
             x = y;
             y = h;
             inverted = 1 - inverted;
+            flips += 4;
+        }
+        if (frameTiles != NULL){
+            frameTiles[index + nXnY] = hashInt(hashInt(hashInt(HASH_START, iCellTile), jCellTile), flips);
         }
-        outMap[index] = x;
-        outMap[index + nXnY] = y;
-        outMap[index + nXnY2] = inverted;
+        frameOutMap[index] = x;
+        frameOutMap[index + nXnY] = y;
+        frameOutMap[index + nXnY2] = inverted;
     }
 }
@@ -0,0 +1,16 @@
+% transformMappedMap: apply a kernel to a map in a file, band by band
+% transformMappedMap(handle, transform);
+%
+% handle: of mappedMap('create', ...) or mappedMap('open', ...)
+% transform: function of a map returning the new map, for example
+%     transformMappedMap(handle, @(map) basicKaleidoscope(map, 7, 3, 2));
+% only one band of rows is in memory, the file is read and written
+% from start to end, see mappedMap.c
+
+function transformMappedMap(handle, transform)
+    sizes = mappedMap('size', handle);
+    for band = 1:sizes(5)
+        map = mappedMap('read', handle, band);
+        mappedMap('write', handle, band, transform(map));
+    end
+end
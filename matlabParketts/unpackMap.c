@@ -0,0 +1,175 @@
+/*==========================================================
+ * unpackMap: the map of a packed map, inverse of packMap (see mapCodec.h)
+ *
+ * map = unpackMap(packed);
+ *
+ * Input:
+ * packed: the uint8 vector of packMap, or read from a file of saveMap
+ *
+ * returns the map, single array of size (nY, nX, layers),
+ * exactly the map given to packMap
+ *
+ * compile with zlib and openMP (see compile.m)
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <zlib.h>
+#include "mapCodec.h"
+
+/* the values of a block of a coordinate layer from the 4 byte planes*/
+static void unpredictBlock(const uint8_t *planes, int nY, int nColumns, uint32_t *bits)
+{
+    int row, column, index, n;
+    uint32_t ordered, above, twoAbove, left, z;
+    n = nY * nColumns;
+    left = 0;
+    index = 0;
+    for (column = 0; column < nColumns; column++){
+        above = 0;
+        twoAbove = 0;
+        for (row = 0; row < nY; row++){
+            z = (uint32_t) planes[index] | ((uint32_t) planes[index + n] << 8)
+                    | ((uint32_t) planes[index + 2 * n] << 16) | ((uint32_t) planes[index + 3 * n] << 24);
+            ordered = unzigzag(z) + predict(above, twoAbove, left, row);
+            bits[index] = fromOrdered(ordered);
+            if (row == 0) {
+                left = ordered;
+            }
+            twoAbove = above;
+            above = ordered;
+            index++;
+        }
+    }
+}
+
+/* the values of a block of the parity layer from the runs, false if they do not fit*/
+static bool unRunLengthBlock(const uint32_t *runs, int nRuns, int n, uint32_t *bits)
+{
+    int run, index;
+    uint32_t i;
+    index = 0;
+    for (run = 0; run < nRuns; run++){
+        if (runs[2 * run] > (uint32_t) (n - index)) {
+            return false;
+        }
+        for (i = 0; i < runs[2 * run]; i++){
+            bits[index++] = runs[2 * run + 1];
+        }
+    }
+    return index == n;
+}
+
+void mexFunction( int nlhs, mxArray *plhs[],
+        int nrhs, const mxArray *prhs[])
+{
+    mwSize dims[3];
+    int nX, nY, nXnY, layers, blockColumns, nBlocks, nUnits, unit, layer, block, column0, nColumns, n;
+    size_t length, position, *positions;
+    uLongf rawLength;
+    uint32_t header[MAP_CODEC_HEADER], *sizes, *map, expected;
+    const uint8_t *in;
+    uint8_t **raw;
+    bool failed;
+    /* check for proper number of arguments (else crash)*/
+    if (nrhs != 1) {
+        mexErrMsgIdAndTxt("unpackMap:nrhs","A packed map input required.");
+    }
+    if (!mxIsUint8(prhs[0])) {
+        mexErrMsgIdAndTxt("unpackMap:packed","The packed map has to be a uint8 array of packMap.");
+    }
+    /* check that output is possible*/
+    if (nlhs != 1) {
+        mexErrMsgIdAndTxt("unpackMap:nlhs","One output array for the map required.");
+    }
+#if MX_HAS_INTERLEAVED_COMPLEX
+    in = mxGetUint8s(prhs[0]);
+#else
+    in = (const uint8_t *) mxGetData(prhs[0]);
+#endif
+    length = mxGetNumberOfElements(prhs[0]);
+    if (length < sizeof(header)) {
+        mexErrMsgIdAndTxt("unpackMap:packed","Not a packed map, too short.");
+    }
+    memcpy(header, in, sizeof(header));
+    nY = header[1];
+    nX = header[2];
+    layers = header[3];
+    blockColumns = header[4];
+    nBlocks = header[5];
+    if ((header[0] != MAP_CODEC_MAGIC) || (blockColumns < 1) || (nBlocks != (nX + blockColumns - 1) / blockColumns)) {
+        mexErrMsgIdAndTxt("unpackMap:packed","Not a packed map of packMap.");
+    }
+    nXnY = nX * nY;
+    nUnits = nBlocks * layers;
+    position = (MAP_CODEC_HEADER + (size_t) nUnits) * sizeof(uint32_t);
+    if (length < position) {
+        mexErrMsgIdAndTxt("unpackMap:packed","The packed map is incomplete.");
+    }
+    sizes = (uint32_t *) mxMalloc((nUnits + 1) * sizeof(uint32_t));
+    memcpy(sizes, in + MAP_CODEC_HEADER * sizeof(uint32_t), nUnits * sizeof(uint32_t));
+    /* where the blocks are, and memory for their raw data (matlab memory is not thread safe)*/
+    positions = (size_t *) mxMalloc((nUnits + 1) * sizeof(size_t));
+    raw = (uint8_t **) mxMalloc((nUnits + 1) * sizeof(uint8_t *));
+    for (unit = 0; unit < nUnits; unit++){
+        if ((sizes[unit] < 4) || (length - position < sizes[unit])) {
+            mexErrMsgIdAndTxt("unpackMap:packed","The packed map is incomplete.");
+        }
+        positions[unit] = position;
+        position += sizes[unit];
+        block = unit % nBlocks;
+        nColumns = (block < nBlocks - 1) ? blockColumns : nX - block * blockColumns;
+        n = ((unit / nBlocks == MAP_CODEC_PARITY_LAYER) ? 8 : 4) * nColumns * nY;
+        raw[unit] = (uint8_t *) mxMalloc(n);
+    }
+    dims[0] = nY;
+    dims[1] = nX;
+    dims[2] = layers;
+    plhs[0] = mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
+#if MX_HAS_INTERLEAVED_COMPLEX
+    map = (uint32_t *) mxGetSingles(plhs[0]);
+#else
+    map = (uint32_t *) mxGetData(plhs[0]);
+#endif
+    failed = false;
+    /* do the blocks*/
+#pragma omp parallel for private(layer, block, column0, nColumns, n, rawLength, expected) schedule(dynamic)
+    for (unit = 0; unit < nUnits; unit++){
+        layer = unit / nBlocks;
+        block = unit % nBlocks;
+        column0 = block * blockColumns;
+        nColumns = (block < nBlocks - 1) ? blockColumns : nX - column0;
+        n = nColumns * nY;
+        memcpy(&expected, in + positions[unit], 4);
+        rawLength = ((layer == MAP_CODEC_PARITY_LAYER) ? 8 : 4) * (uLongf) n;
+        if ((expected > rawLength)
+                || (uncompress(raw[unit], &rawLength, in + positions[unit] + 4, sizes[unit] - 4) != Z_OK)
+                || (rawLength != expected)) {
+            failed = true;
+            continue;
+        }
+        if (layer == MAP_CODEC_PARITY_LAYER) {
+            if (((rawLength & 7) != 0)
+                    || !unRunLengthBlock((const uint32_t *) raw[unit], rawLength / 8, n, map + (size_t) layer * nXnY + (size_t) column0 * nY)) {
+                failed = true;
+            }
+        } else if (rawLength == 4 * (uLongf) n) {
+            unpredictBlock(raw[unit], nY, nColumns, map + (size_t) layer * nXnY + (size_t) column0 * nY);
+        } else {
+            failed = true;
+        }
+    }
+    for (unit = 0; unit < nUnits; unit++){
+        mxFree(raw[unit]);
+    }
+    mxFree(raw);
+    mxFree(positions);
+    mxFree(sizes);
+    if (failed) {
+        mexErrMsgIdAndTxt("unpackMap:packed","The packed map is damaged.");
+    }
+}
@@ -0,0 +1,33 @@
+% write a large structure image of a kaleidoscope to a file
+% band by band of rows, the full image and map are never in memory
+% each band is compressed while the next one is not yet rendered
+% use a .tif file name for TIFF, images of more than 4 GB become BigTIFF
+
+function writeLargeImage(fileName)
+if nargin < 1
+    fileName = "largeKaleidoscope.png";
+end
+% size of the output image and of the bands
+width = 20000;
+height = 20000;
+bandRows = 512;
+% the map covers x from -1 to 1, y proportional, pixel centers as createIdentityMap
+dx = 2 / width;
+yMax = dx * height / 2;
+x = single(-1 + ((1:width) - 0.5) * dx);
+tic
+writer = imageWriter('open', fileName, height, width, 1);
+for firstRow = 1:bandRows:height
+    rows = firstRow:min(firstRow + bandRows - 1, height);
+    % the identity map of the band, the y-axis is inverted
+    y = single(yMax - (rows' - 0.5) * dx);
+    map = cat(3, repmat(x, numel(rows), 1), repmat(y, 1, width), zeros(numel(rows), width, 'single'));
+    % transform the map into a kaleidoscope
+    basicKaleidoscope(map, 7, 3, 2);
+    % image of the band, black, white and grey
+    band = uint8(255 * createStructureImage(map));
+    imageWriter('write', writer, band);
+end
+imageWriter('close', writer);
+fprintf('%d x %d image written in %f s\n', height, width, toc);
+end
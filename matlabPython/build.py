@@ -0,0 +1,55 @@
+# build.py: compile the mex kernels as shared libraries for python
+# python3 build.py
+# python3 build.py matlabParketts
+#
+# each kernel with its mexFunction becomes lib/<folder>/<kernel>.so,
+# compiled unchanged with mex.h and mex.c of this folder instead of matlab
+# as compile.m: optimized, with openMP, zlib for the kernels that need it
+# use the kernels with mapKernels.py
+
+import os
+import subprocess
+import sys
+
+here = os.path.dirname(os.path.abspath(__file__))
+root = os.path.dirname(here)
+folders = ["matlabParketts", "matlabKaleidoscope", "matlabHerbst23"]
+compiler = os.environ.get("CC", "cc")
+flags = ["-O3", "-fno-trapping-math", "-fopenmp", "-fPIC", "-shared"]
+libraries = ["-lz", "-lm"]
+
+
+def kernels(folder):
+    """the c files of a folder with a mexFunction"""
+    path = os.path.join(root, folder)
+    for name in sorted(os.listdir(path)):
+        if name.endswith(".c"):
+            with open(os.path.join(path, name), errors="replace") as source:
+                if "mexFunction" in source.read():
+                    yield name[:-2]
+
+
+def build(folder):
+    """compile all kernels of a folder, returns the names that failed"""
+    os.makedirs(os.path.join(here, "lib", folder), exist_ok=True)
+    failed = []
+    for kernel in kernels(folder):
+        command = [compiler] + flags + ["-I", here, "-I", os.path.join(root, folder),
+                                        os.path.join(root, folder, kernel + ".c"), os.path.join(here, "mex.c"),
+                                        "-o", os.path.join(here, "lib", folder, kernel + ".so")] + libraries
+        result = subprocess.run(command, capture_output=True, text=True)
+        if result.returncode != 0:
+            failed.append(kernel)
+            print(f"{folder}/{kernel}: failed\n{result.stderr}")
+        else:
+            print(f"{folder}/{kernel}")
+    return failed
+
+
+if __name__ == "__main__":
+    failed = []
+    for folder in (sys.argv[1:] or folders):
+        failed += build(folder)
+    if failed:
+        print("failed:", ", ".join(failed))
+        sys.exit(1)
@@ -0,0 +1,181 @@
+# mapKernels.py: the mex kernels for python and numpy, without matlab
+#
+# build the libraries first: python3 build.py
+#
+# import mapKernels
+# parketts = mapKernels.Kernels("matlabParketts")
+# map = parketts.createIdentityMap(1, -1, 1, -1, 1)
+# parketts.basicKaleidoscope(map, 7, 3, 2, nout=0)       modifies the map
+# newMap = parketts.basicKaleidoscope(map, 7, 3, 2)      returns a new map
+# image = parketts.sampleImage(inputImage, x, y, "linear")
+#
+# arguments and results as in matlab, see the comments of the c files:
+#     numpy arrays in matlab order (map of shape (nY, nX, 3), Fortran order),
+#     the kernel works on their memory, no copy, as the mex functions in matlab
+#     arrays in C order (or not contiguous) are copied to Fortran order,
+#     and copied back after the call, in place changes are seen anyway
+#     numbers are double scalars, strings are char arrays, lists are double arrays
+# nout: number of results, as nargout in matlab, default 1,
+#     nout=0 calls the kernel as a procedure, it modifies the map in place
+# errors of the kernels raise MexError
+# the global interpreter lock is released during the calls (ctypes),
+# calls of the same kernel wait for each other, different kernels run in parallel
+
+import atexit
+import ctypes
+import os
+import threading
+import weakref
+
+import numpy as np
+
+MAX_DIMS = 8
+MESSAGE_LENGTH = 1024
+here = os.path.dirname(os.path.abspath(__file__))
+
+# mxClassID of mex.h and numpy types
+CHAR_CLASS = 4
+LOGICAL_CLASS = 3
+classes = {np.dtype(np.float64): 6, np.dtype(np.float32): 7, np.dtype(np.int8): 8, np.dtype(np.uint8): 9,
+           np.dtype(np.int16): 10, np.dtype(np.uint16): 11, np.dtype(np.int32): 12, np.dtype(np.uint32): 13,
+           np.dtype(np.int64): 14, np.dtype(np.uint64): 15}
+dtypes = {classID: dtype for dtype, classID in classes.items()}
+dtypes[LOGICAL_CLASS] = np.dtype(np.bool_)
+
+
+class MexError(Exception):
+    """error of a kernel, the message starts with its id, as kernel:reason"""
+
+
+class mxArray(ctypes.Structure):
+    _fields_ = [("classID", ctypes.c_int), ("nDims", ctypes.c_size_t), ("dims", ctypes.c_size_t * MAX_DIMS),
+                ("nElements", ctypes.c_size_t), ("data", ctypes.c_void_p), ("ownsData", ctypes.c_bool)]
+
+
+mxArrayPointer = ctypes.POINTER(mxArray)
+
+
+class Kernel:
+    """a kernel of a shared library, called as the mex function"""
+
+    def __init__(self, path):
+        self.library = ctypes.CDLL(path)
+        self.library.mexshimCall.argtypes = [ctypes.c_int, ctypes.POINTER(mxArrayPointer), ctypes.c_int,
+                                             ctypes.POINTER(mxArrayPointer), ctypes.c_char_p, ctypes.c_int]
+        self.library.mexshimWrap.argtypes = [ctypes.c_int, ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t),
+                                             ctypes.c_void_p]
+        self.library.mexshimWrap.restype = mxArrayPointer
+        self.library.mexshimFreeWrapped.argtypes = [mxArrayPointer]
+        self.library.mxDestroyArray.argtypes = [mxArrayPointer]
+        self.lock = threading.Lock()
+        atexit.register(self.library.mexshimExit)
+
+    def wrap(self, argument, keep):
+        """an mxArray of an argument, keep gets the objects that have to live during the call
+        returns the array and the pair (copy, original) if a copy has to be written back"""
+        writeBack = None
+        if isinstance(argument, str):
+            data = argument.encode()
+            buffer = ctypes.create_string_buffer(data)
+            keep.append(buffer)
+            dims = (ctypes.c_size_t * 2)(1, len(data))
+            return self.library.mexshimWrap(CHAR_CLASS, 2, dims, ctypes.addressof(buffer)), None
+        if isinstance(argument, np.ndarray):
+            array = argument
+            if array.dtype not in classes and array.dtype != np.bool_:
+                array = array.astype(np.float64)
+            if not array.flags.f_contiguous:
+                array = np.asfortranarray(array)
+                if argument.flags.writeable and argument.dtype == array.dtype:
+                    writeBack = (array, argument)
+        else:
+            array = np.asfortranarray(np.asarray(argument, dtype=np.float64))
+        keep.append(array)
+        classID = LOGICAL_CLASS if array.dtype == np.bool_ else classes[array.dtype]
+        shape = array.shape if array.ndim > 0 else (1, 1)
+        if len(shape) > MAX_DIMS:
+            raise MexError(f"mex:dims: At most {MAX_DIMS} dimensions.")
+        dims = (ctypes.c_size_t * max(len(shape), 1))(*shape)
+        return self.library.mexshimWrap(classID, len(shape), dims, array.ctypes.data), writeBack
+
+    def result(self, pointer):
+        """the numpy array of a returned mxArray, no copy, freed with the numpy array"""
+        a = pointer.contents
+        shape = tuple(a.dims[:a.nDims])
+        if a.classID == CHAR_CLASS:
+            text = ctypes.string_at(a.data, a.nElements).decode(errors="replace")
+            self.library.mxDestroyArray(pointer)
+            return text
+        dtype = dtypes.get(a.classID, np.dtype(np.uint8))
+        if a.nElements == 0:
+            self.library.mxDestroyArray(pointer)
+            return np.zeros(shape, dtype=dtype, order="F")
+        buffer = (ctypes.c_char * (a.nElements * dtype.itemsize)).from_address(a.data)
+        flat = np.frombuffer(buffer, dtype=dtype)
+        weakref.finalize(flat, self.library.mxDestroyArray, pointer)
+        return flat.reshape(shape, order="F")
+
+    def __call__(self, *arguments, nout=1):
+        keep = []
+        inputs = []
+        writeBacks = []
+        try:
+            for argument in arguments:
+                wrapped, writeBack = self.wrap(argument, keep)
+                inputs.append(wrapped)
+                if writeBack is not None:
+                    writeBacks.append(writeBack)
+            prhs = (mxArrayPointer * max(len(inputs), 1))(*inputs)
+            plhs = (mxArrayPointer * max(nout, 1))()
+            message = ctypes.create_string_buffer(MESSAGE_LENGTH)
+            with self.lock:
+                failed = self.library.mexshimCall(nout, plhs, len(inputs), prhs, message, MESSAGE_LENGTH)
+            if failed:
+                raise MexError(message.value.decode(errors="replace"))
+            for copy, original in writeBacks:
+                original[...] = copy
+            addresses = [ctypes.addressof(p.contents) for p in inputs]
+            results = []
+            for i in range(max(nout, 1)):
+                if not plhs[i]:
+                    results.append(None)
+                elif ctypes.addressof(plhs[i].contents) in addresses:
+                    # the kernel returned an argument (a destination map)
+                    results.append(arguments[addresses.index(ctypes.addressof(plhs[i].contents))])
+                else:
+                    results.append(self.result(plhs[i]))
+        finally:
+            for wrapped in inputs:
+                self.library.mexshimFreeWrapped(wrapped)
+        if nout == 0:
+            return None
+        return results[0] if nout == 1 else tuple(results)
+
+
+class Kernels:
+    """the kernels of a folder, as attributes, the libraries are loaded when used"""
+
+    def __init__(self, folder="matlabParketts", path=None):
+        self.path = path or os.path.join(here, "lib", folder)
+        if not os.path.isdir(self.path):
+            raise FileNotFoundError(f"No kernels at {self.path}, run build.py.")
+        self.kernels = {}
+
+    def names(self):
+        return sorted(name[:-3] for name in os.listdir(self.path) if name.endswith(".so"))
+
+    def __getattr__(self, name):
+        if name.startswith("_") or name in ("path", "kernels"):
+            raise AttributeError(name)
+        if name not in self.kernels:
+            library = os.path.join(self.path, name + ".so")
+            if not os.path.exists(library):
+                raise AttributeError(f"No kernel {name} in {self.path}.")
+            self.kernels[name] = Kernel(library)
+        return self.kernels[name]
+
+    def chain(self, map, steps):
+        """apply kernels to the map in place, steps: list of (kernel name, parameters ...)"""
+        for kernel, *parameters in steps:
+            getattr(self, kernel)(map, *parameters, nout=0)
+        return map
@@ -0,0 +1,400 @@
+/*==========================================================
+ * mex.c: the mex api of mex.h for the kernels as shared libraries
+ *
+ * compiled together with a kernel into one library, see build.py:
+ *     cc -shared -fPIC -fopenmp -I matlabPython kernel.c matlabPython/mex.c -o kernel.so
+ * python calls mexshimCall, it calls the mexFunction of the kernel
+ *
+ * the memory of mxMalloc and mxCreate... is a list of blocks, as matlab
+ * it is freed after the call, except for the returned arrays and persistent memory
+ * the kernels call mxMalloc only outside of parallel regions,
+ * calls of one library are serialized by mapKernels.py
+ *
+ *========================================================*/
+
+#include "mex.h"
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stddef.h>
+#include <setjmp.h>
+#define MESSAGE_LENGTH 1024
+
+/* the header of a block of memory, aligned as malloc*/
+typedef union blockHeader {
+    struct {
+        union blockHeader *next, *previous;
+        bool isTemporary;
+    } b;
+    max_align_t align;
+} blockHeader;
+
+/* the temporary blocks of the current call*/
+static blockHeader temporaries = {{&temporaries, &temporaries, false}};
+static jmp_buf errorJump;
+static bool inCall = false;
+static char errorMessage[MESSAGE_LENGTH];
+static void (*exitFunction)(void) = NULL;
+static int lockCount = 0;
+
+static void unlinkBlock(blockHeader *header)
+{
+    if (header->b.isTemporary) {
+        header->b.previous->b.next = header->b.next;
+        header->b.next->b.previous = header->b.previous;
+        header->b.isTemporary = false;
+    }
+}
+
+static void linkBlock(blockHeader *header)
+{
+    header->b.next = temporaries.b.next;
+    header->b.previous = &temporaries;
+    temporaries.b.next->b.previous = header;
+    temporaries.b.next = header;
+    header->b.isTemporary = true;
+}
+
+static blockHeader *getHeader(void *memory)
+{
+    return ((blockHeader *) memory) - 1;
+}
+
+void *mxMalloc(size_t size)
+{
+    blockHeader *header = (blockHeader *) malloc(sizeof(blockHeader) + size);
+    if (header == NULL) {
+        mexErrMsgIdAndTxt("mex:memory","Out of memory, %.0f bytes.", (double) size);
+    }
+    linkBlock(header);
+    return header + 1;
+}
+
+void *mxCalloc(size_t n, size_t size)
+{
+    void *memory = mxMalloc(n * size);
+    memset(memory, 0, n * size);
+    return memory;
+}
+
+void *mxRealloc(void *memory, size_t size)
+{
+    blockHeader *header;
+    bool isTemporary;
+    if (memory == NULL) {
+        return mxMalloc(size);
+    }
+    header = getHeader(memory);
+    isTemporary = header->b.isTemporary;
+    unlinkBlock(header);
+    header = (blockHeader *) realloc(header, sizeof(blockHeader) + size);
+    if (header == NULL) {
+        mexErrMsgIdAndTxt("mex:memory","Out of memory, %.0f bytes.", (double) size);
+    }
+    if (isTemporary) {
+        linkBlock(header);
+    }
+    return header + 1;
+}
+
+void mxFree(void *memory)
+{
+    blockHeader *header;
+    if (memory == NULL) {
+        return;
+    }
+    header = getHeader(memory);
+    unlinkBlock(header);
+    free(header);
+}
+
+void mexMakeMemoryPersistent(void *memory)
+{
+    unlinkBlock(getHeader(memory));
+}
+
+void mexMakeArrayPersistent(mxArray *a)
+{
+    mexMakeMemoryPersistent(a);
+    if (a->ownsData && (a->data != NULL)) {
+        mexMakeMemoryPersistent(a->data);
+    }
+}
+
+/* free all temporary blocks*/
+static void freeTemporaries(void)
+{
+    blockHeader *header;
+    while (temporaries.b.next != &temporaries) {
+        header = temporaries.b.next;
+        unlinkBlock(header);
+        free(header);
+    }
+}
+
+static size_t elementSize(mxClassID classID)
+{
+    switch (classID) {
+        case mxDOUBLE_CLASS:
+        case mxINT64_CLASS:
+        case mxUINT64_CLASS:
+            return 8;
+        case mxSINGLE_CLASS:
+        case mxINT32_CLASS:
+        case mxUINT32_CLASS:
+            return 4;
+        case mxINT16_CLASS:
+        case mxUINT16_CLASS:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+/* an array without data, matlab drops trailing singleton dimensions*/
+static mxArray *newArray(mxClassID classID, mwSize nDims, const mwSize *dims)
+{
+    mxArray *a;
+    mwSize i;
+    if (nDims > MEXSHIM_MAX_DIMS) {
+        mexErrMsgIdAndTxt("mex:dims","At most %d dimensions.", MEXSHIM_MAX_DIMS);
+    }
+    a = (mxArray *) mxMalloc(sizeof(mxArray));
+    memset(a, 0, sizeof(mxArray));
+    a->classID = classID;
+    a->nDims = (nDims < 2) ? 2 : nDims;
+    a->dims[0] = (nDims > 0) ? dims[0] : 1;
+    a->dims[1] = (nDims > 1) ? dims[1] : 1;
+    for (i = 2; i < nDims; i++){
+        a->dims[i] = dims[i];
+    }
+    while ((a->nDims > 2) && (a->dims[a->nDims - 1] == 1)) {
+        a->nDims--;
+    }
+    a->nElements = 1;
+    for (i = 0; i < a->nDims; i++){
+        a->nElements *= a->dims[i];
+    }
+    return a;
+}
+
+mxArray *mxCreateNumericArray(mwSize nDims, const mwSize *dims, mxClassID classID, mxComplexity complexity)
+{
+    mxArray *a = newArray(classID, nDims, dims);
+    (void) complexity;
+    a->data = mxCalloc(a->nElements > 0 ? a->nElements : 1, elementSize(classID));
+    a->ownsData = true;
+    return a;
+}
+
+mxArray *mxCreateNumericMatrix(mwSize m, mwSize n, mxClassID classID, mxComplexity complexity)
+{
+    mwSize dims[2];
+    dims[0] = m;
+    dims[1] = n;
+    return mxCreateNumericArray(2, dims, classID, complexity);
+}
+
+mxArray *mxCreateDoubleMatrix(mwSize m, mwSize n, mxComplexity complexity)
+{
+    return mxCreateNumericMatrix(m, n, mxDOUBLE_CLASS, complexity);
+}
+
+mxArray *mxCreateDoubleScalar(double value)
+{
+    mxArray *a = mxCreateDoubleMatrix(1, 1, mxREAL);
+    *((double *) a->data) = value;
+    return a;
+}
+
+/* strings are bytes, not utf16 as in matlab*/
+mxArray *mxCreateString(const char *string)
+{
+    mwSize dims[2];
+    mxArray *a;
+    dims[0] = 1;
+    dims[1] = strlen(string);
+    a = mxCreateNumericArray(2, dims, mxCHAR_CLASS, mxREAL);
+    memcpy(a->data, string, dims[1]);
+    return a;
+}
+
+void mxDestroyArray(mxArray *a)
+{
+    if (a == NULL) {
+        return;
+    }
+    if (a->ownsData) {
+        mxFree(a->data);
+    }
+    mxFree(a);
+}
+
+double mxGetScalar(const mxArray *a)
+{
+    if (a->nElements == 0) {
+        return 0;
+    }
+    switch (a->classID) {
+        case mxDOUBLE_CLASS:
+            return ((double *) a->data)[0];
+        case mxSINGLE_CLASS:
+            return ((float *) a->data)[0];
+        case mxINT8_CLASS:
+            return ((int8_t *) a->data)[0];
+        case mxINT16_CLASS:
+            return ((int16_t *) a->data)[0];
+        case mxUINT16_CLASS:
+            return ((uint16_t *) a->data)[0];
+        case mxINT32_CLASS:
+            return ((int32_t *) a->data)[0];
+        case mxUINT32_CLASS:
+            return ((uint32_t *) a->data)[0];
+        case mxINT64_CLASS:
+            return (double) ((int64_t *) a->data)[0];
+        case mxUINT64_CLASS:
+            return (double) ((uint64_t *) a->data)[0];
+        default:
+            return ((uint8_t *) a->data)[0];
+    }
+}
+
+/* as matlab: returns 1 if it is not a string or it is too long*/
+int mxGetString(const mxArray *a, char *buffer, mwSize length)
+{
+    mwSize n;
+    if (length == 0) {
+        return 1;
+    }
+    if (a->classID != mxCHAR_CLASS) {
+        buffer[0] = 0;
+        return 1;
+    }
+    n = (a->nElements < length - 1) ? a->nElements : length - 1;
+    memcpy(buffer, a->data, n);
+    buffer[n] = 0;
+    return (n < a->nElements) ? 1 : 0;
+}
+
+char *mxArrayToString(const mxArray *a)
+{
+    char *string;
+    if (a->classID != mxCHAR_CLASS) {
+        return NULL;
+    }
+    string = (char *) mxMalloc(a->nElements + 1);
+    memcpy(string, a->data, a->nElements);
+    string[a->nElements] = 0;
+    return string;
+}
+
+void mexErrMsgIdAndTxt(const char *id, const char *format, ...)
+{
+    va_list arguments;
+    int n;
+    n = snprintf(errorMessage, MESSAGE_LENGTH, "%s: ", id);
+    va_start(arguments, format);
+    vsnprintf(errorMessage + n, MESSAGE_LENGTH - n, format, arguments);
+    va_end(arguments);
+    if (!inCall) {
+        fprintf(stderr, "%s\n", errorMessage);
+        abort();
+    }
+    longjmp(errorJump, 1);
+}
+
+void mexWarnMsgIdAndTxt(const char *id, const char *format, ...)
+{
+    va_list arguments;
+    fprintf(stderr, "Warning %s: ", id);
+    va_start(arguments, format);
+    vfprintf(stderr, format, arguments);
+    va_end(arguments);
+    fprintf(stderr, "\n");
+}
+
+int mexAtExit(void (*function)(void))
+{
+    exitFunction = function;
+    return 0;
+}
+
+void mexLock(void)
+{
+    lockCount++;
+}
+
+void mexUnlock(void)
+{
+    if (lockCount > 0) {
+        lockCount--;
+    }
+}
+
+bool mexIsLocked(void)
+{
+    return lockCount > 0;
+}
+
+/* call the kernel, returns 0 and the arrays in plhs, or 1 and the error message
+ * the returned arrays are freed with mxDestroyArray*/
+int mexshimCall(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[], char *message, int length)
+{
+    int i, nOut;
+    nOut = (nlhs > 0) ? nlhs : 1;
+    for (i = 0; i < nOut; i++){
+        plhs[i] = NULL;
+    }
+    if (setjmp(errorJump) != 0) {
+        inCall = false;
+        freeTemporaries();
+        for (i = 0; i < nOut; i++){
+            plhs[i] = NULL;
+        }
+        snprintf(message, length, "%s", errorMessage);
+        return 1;
+    }
+    inCall = true;
+    mexFunction(nlhs, (mxArray **) plhs, nrhs, prhs);
+    inCall = false;
+    /* keep the returned arrays, if not arrays of python*/
+    for (i = 0; i < nOut; i++){
+        if ((plhs[i] != NULL) && getHeader(plhs[i])->b.isTemporary) {
+            mexMakeArrayPersistent(plhs[i]);
+        }
+    }
+    freeTemporaries();
+    return 0;
+}
+
+/* an array for the memory of a numpy array, no copy*/
+mxArray *mexshimWrap(mxClassID classID, mwSize nDims, const mwSize *dims, void *data)
+{
+    mxArray *a;
+    blockHeader *header;
+    bool wasInCall = inCall;
+    /* errors here abort, there is no call*/
+    inCall = false;
+    a = newArray(classID, nDims, dims);
+    inCall = wasInCall;
+    /* it is not freed with the temporaries of the next call*/
+    header = getHeader(a);
+    unlinkBlock(header);
+    a->data = data;
+    a->ownsData = false;
+    return a;
+}
+
+void mexshimFreeWrapped(mxArray *a)
+{
+    mxFree(a);
+}
+
+/* as clear: close files and free persistent memory of the kernel*/
+void mexshimExit(void)
+{
+    if (exitFunction != NULL) {
+        exitFunction();
+        exitFunction = NULL;
+    }
+}
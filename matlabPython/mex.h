@@ -0,0 +1,101 @@
+/*==========================================================
+ * mex.h: the part of the matlab mex api used by the kernels,
+ * to compile them unchanged as shared libraries for python (see mapKernels.py)
+ *
+ * arrays are in matlab order (column first, layers last), as numpy arrays
+ * in Fortran order, arrays from python use their memory, no copy
+ * mexErrMsgIdAndTxt returns to mexshimCall with the message
+ * memory of mxMalloc and arrays not returned are freed after each call,
+ * as in matlab, except for persistent memory
+ *
+ *========================================================*/
+
+#ifndef MEX_SHIM_H
+#define MEX_SHIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define MX_HAS_INTERLEAVED_COMPLEX 1
+#define MEXSHIM_MAX_DIMS 8
+
+typedef size_t mwSize;
+typedef size_t mwIndex;
+
+typedef enum {
+    mxUNKNOWN_CLASS, mxCELL_CLASS, mxSTRUCT_CLASS, mxLOGICAL_CLASS, mxCHAR_CLASS, mxVOID_CLASS,
+    mxDOUBLE_CLASS, mxSINGLE_CLASS, mxINT8_CLASS, mxUINT8_CLASS, mxINT16_CLASS, mxUINT16_CLASS,
+    mxINT32_CLASS, mxUINT32_CLASS, mxINT64_CLASS, mxUINT64_CLASS
+} mxClassID;
+
+typedef enum {mxREAL, mxCOMPLEX} mxComplexity;
+
+typedef struct mxArray_tag {
+    mxClassID classID;
+    mwSize nDims;
+    mwSize dims[MEXSHIM_MAX_DIMS];
+    mwSize nElements;
+    void *data;
+    /* false for the memory of numpy arrays*/
+    bool ownsData;
+} mxArray;
+
+/* arrays*/
+mxArray *mxCreateNumericArray(mwSize nDims, const mwSize *dims, mxClassID classID, mxComplexity complexity);
+mxArray *mxCreateNumericMatrix(mwSize m, mwSize n, mxClassID classID, mxComplexity complexity);
+mxArray *mxCreateDoubleMatrix(mwSize m, mwSize n, mxComplexity complexity);
+mxArray *mxCreateDoubleScalar(double value);
+mxArray *mxCreateString(const char *string);
+void mxDestroyArray(mxArray *a);
+
+static inline float *mxGetSingles(const mxArray *a) {return (float *) a->data;}
+static inline double *mxGetDoubles(const mxArray *a) {return (double *) a->data;}
+static inline uint8_t *mxGetUint8s(const mxArray *a) {return (uint8_t *) a->data;}
+static inline uint32_t *mxGetUint32s(const mxArray *a) {return (uint32_t *) a->data;}
+static inline int32_t *mxGetInt32s(const mxArray *a) {return (int32_t *) a->data;}
+static inline double *mxGetPr(const mxArray *a) {return (double *) a->data;}
+static inline void *mxGetData(const mxArray *a) {return a->data;}
+static inline mwSize mxGetNumberOfDimensions(const mxArray *a) {return a->nDims;}
+static inline const mwSize *mxGetDimensions(const mxArray *a) {return a->dims;}
+static inline mwSize mxGetNumberOfElements(const mxArray *a) {return a->nElements;}
+static inline mwSize mxGetM(const mxArray *a) {return a->dims[0];}
+static inline mwSize mxGetN(const mxArray *a) {return (a->dims[0] > 0) ? a->nElements / a->dims[0] : 0;}
+static inline mxClassID mxGetClassID(const mxArray *a) {return a->classID;}
+static inline bool mxIsSingle(const mxArray *a) {return a->classID == mxSINGLE_CLASS;}
+static inline bool mxIsDouble(const mxArray *a) {return a->classID == mxDOUBLE_CLASS;}
+static inline bool mxIsUint8(const mxArray *a) {return a->classID == mxUINT8_CLASS;}
+static inline bool mxIsUint32(const mxArray *a) {return a->classID == mxUINT32_CLASS;}
+static inline bool mxIsChar(const mxArray *a) {return a->classID == mxCHAR_CLASS;}
+static inline bool mxIsEmpty(const mxArray *a) {return a->nElements == 0;}
+static inline bool mxIsComplex(const mxArray *a) {(void) a; return false;}
+double mxGetScalar(const mxArray *a);
+int mxGetString(const mxArray *a, char *buffer, mwSize length);
+char *mxArrayToString(const mxArray *a);
+
+/* memory*/
+void *mxMalloc(size_t size);
+void *mxCalloc(size_t n, size_t size);
+void *mxRealloc(void *memory, size_t size);
+void mxFree(void *memory);
+void mexMakeMemoryPersistent(void *memory);
+void mexMakeArrayPersistent(mxArray *a);
+
+/* the mex file*/
+void mexErrMsgIdAndTxt(const char *id, const char *format, ...);
+void mexWarnMsgIdAndTxt(const char *id, const char *format, ...);
+#define mexPrintf printf
+int mexAtExit(void (*function)(void));
+void mexLock(void);
+void mexUnlock(void);
+bool mexIsLocked(void);
+
+/* the kernel, and the interface for python*/
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+int mexshimCall(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[], char *message, int length);
+mxArray *mexshimWrap(mxClassID classID, mwSize nDims, const mwSize *dims, void *data);
+void mexshimFreeWrapped(mxArray *a);
+void mexshimExit(void);
+
+#endif
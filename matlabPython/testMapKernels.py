@@ -0,0 +1,87 @@
+# testMapKernels.py: the kernels from python, compare procedure and function calls,
+# C order and Fortran order maps, errors, memory of repeated calls,
+# calls from python threads, and the time of a kernel threaded with openMP
+# python3 build.py matlabParketts
+# python3 testMapKernels.py
+
+import resource
+import threading
+import time
+
+import numpy as np
+
+import mapKernels
+
+parketts = mapKernels.Kernels("matlabParketts")
+# make the initial map, a Fortran order array (nY, nX, 3) as in matlab
+map = parketts.createIdentityMap(1, -1, 1, -1, 1)
+print("identity map", map.shape, map.dtype, "Fortran order:", map.flags.f_contiguous)
+# transform into a kaleidoscope, as function and in place
+newMap = parketts.basicKaleidoscope(map, 7, 3, 2)
+inPlace = map.copy(order="F")
+address = inPlace.ctypes.data
+parketts.basicKaleidoscope(inPlace, 7, 3, 2, nout=0)
+print("in place equal to new map:", np.array_equal(newMap, inPlace), ", same memory:", address == inPlace.ctypes.data)
+# C order maps are copied and written back
+cOrder = np.ascontiguousarray(map)
+parketts.basicKaleidoscope(cOrder, 7, 3, 2, nout=0)
+print("C order equal:", np.array_equal(newMap, cOrder))
+# chain of kernels
+chained = parketts.chain(map.copy(order="F"), [("basicKaleidoscope", 7, 3, 2), ("tiling442", 0.5)])
+tiled = inPlace.copy(order="F")
+parketts.tiling442(tiled, 0.5, nout=0)
+print("chain equal:", np.array_equal(chained, tiled))
+# the structure image
+image = parketts.createStructureImage(newMap)
+print("structure image", image.shape, image.dtype, "values", np.unique(image))
+# several results, as [tiledMap, tiles] = tiling442(map, 0.5)
+tiledMap, tiles = parketts.tiling442(newMap, 0.5, nout=2)
+print("tiles", tiles.shape, tiles.dtype)
+# errors of the kernels are exceptions
+try:
+    parketts.basicKaleidoscope(map)
+except mapKernels.MexError as error:
+    print("error:", error)
+# sample an image, uint8 with 3 layers
+inputImage = (np.arange(400 * 600 * 3) % 251).astype(np.uint8).reshape((400, 600, 3), order="F")
+x = 1 + 598 * (newMap[:, :, 0] - newMap[:, :, 0].min()) / np.ptp(newMap[:, :, 0])
+y = 1 + 398 * (newMap[:, :, 1] - newMap[:, :, 1].min()) / np.ptp(newMap[:, :, 1])
+start = time.time()
+output = parketts.sampleImage(inputImage, x.astype(np.float32), y.astype(np.float32), "linear")
+print("sampleImage", output.shape, output.dtype, f"{time.time() - start:.3f} s")
+baked = parketts.bakeMap(x, y, newMap[:, :, 2])
+bakedOutput = parketts.sampleBakedMap(inputImage, baked)
+valid = newMap[:, :, 2] >= 0
+print("baked differs by at most", np.abs(bakedOutput.astype(int) - output.astype(int))[valid].max())
+# repeated calls with results and errors do not grow the memory (peak resident size)
+before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+for i in range(200):
+    repeated = parketts.basicKaleidoscope(map, 7, 3, 2)
+    try:
+        parketts.basicKaleidoscope(map)
+    except mapKernels.MexError:
+        pass
+growth = (resource.getrusage(resource.RUSAGE_SELF).ru_maxrss - before) / 1024
+print(f"memory growth of 200 calls {growth:.1f} MB, a map is {map.nbytes / 2**20:.1f} MB")
+# calls from python threads, the same kernel waits, different kernels run at the same time
+results = [None] * 4
+
+
+def work(i):
+    if i % 2 == 0:
+        results[i] = parketts.basicKaleidoscope(map, 7, 3, 2)
+    else:
+        results[i] = parketts.tiling442(newMap, 0.5)
+
+
+threads = [threading.Thread(target=work, args=(i,)) for i in range(len(results))]
+for thread in threads:
+    thread.start()
+for thread in threads:
+    thread.join()
+reference = [newMap, tiledMap]
+print("threaded calls equal:", all(np.array_equal(result, reference[i % 2]) for i, result in enumerate(results)))
+# time of a kernel with openMP threads, set OMP_NUM_THREADS to compare
+start = time.time()
+parketts.basicKaleidoscope(map, 7, 3, 2)
+print(f"basicKaleidoscope {map.shape[0]} x {map.shape[1]}: {time.time() - start:.3f} s")